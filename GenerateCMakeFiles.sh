@@ -47,7 +47,13 @@ CMAKE_VERBOSE_OVERWRITE="0" # set to "0" - do not generate cmake verbose makefil
 UPP_SRC_BASE="ultimatepp"
 UPP_SRC_DIR="${UPP_SRC_BASE}/uppsrc"
 
-PROJECT_NAME="app/PxView/PxView.upp"
+# PROJECT_NAME="app/PxViewCli/PxViewCli.upp" ./GenerateCMakeFiles.sh - the command line tools
+PROJECT_NAME="${PROJECT_NAME:-app/PxView/PxView.upp}"
+if [ "$(basename "${PROJECT_NAME}")" == "PxViewCli.upp" ]; then
+  PROJECT_GUI=""
+else
+  PROJECT_GUI="-DflagGUI "
+fi
 
 PROJECT_EXTRA_INCLUDE_DIR=""
 PROJECT_EXTRA_INCLUDE_SUBDIRS=""
@@ -56,10 +62,10 @@ PROJECT_EXTRA_LINK_FLAGS=""
 
 if [ $# -lt 1 ]; then
   echo "# POSIX build"
-  PROJECT_FLAGS="-DflagGUI -DflagMT -DflagGCC -DflagLINUX -DflagPOSIX -DflagSHARED"
+  PROJECT_FLAGS="${PROJECT_GUI}-DflagMT -DflagGCC -DflagLINUX -DflagPOSIX -DflagSHARED"
 else
   echo "# WINDOWS build"
-  PROJECT_FLAGS="-DflagGUI -DflagMT -DflagGCC -DflagPOSIX"
+  PROJECT_FLAGS="${PROJECT_GUI}-DflagMT -DflagGCC -DflagPOSIX"
 fi
 
 generate_main_cmake_file "${PROJECT_NAME}" "${PROJECT_FLAGS}"
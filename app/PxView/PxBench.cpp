@@ -0,0 +1,272 @@
+#include "PxBench.h"
+#include "PxExport.h"
+#include "PxFilter.h"
+
+using namespace Upp;
+
+static const char *Password = "benchmark";
+static const int BlockSizes[] = {2, 16};      // NOLINT: kB
+static const int Fragmentations[] = {0, 50}; // NOLINT: percent
+
+// xorshift64*, the tables do not depend on the random generator of the platform
+static dword sRandom(uint64 &state) {
+    state ^= state >> 12; // NOLINT: xorshift
+    state ^= state << 25; // NOLINT: xorshift
+    state ^= state >> 27; // NOLINT: xorshift
+    return dword((state * 2685821657736338717ULL) >> 32); // NOLINT: xorshift
+}
+
+static String sText(uint64 &state, int minlen, int maxlen) {
+    int len = minlen + int(sRandom(state) % (maxlen - minlen + 1));
+    String s;
+    for (int i = 0; i < len; ++i) {
+        dword r = sRandom(state) % 32; // NOLINT: letters and spaces
+        s.Cat(r < 26 ? 'a' + r : ' '); // NOLINT: letters
+    }
+    return s;
+}
+
+ParadoxBenchmark::ParadoxBenchmark() {
+    records << 1000 << 100000; // NOLINT: default counts
+}
+
+String ParadoxBenchmark::GetTableName(const Table &t) {
+    return Format("px%d%s%d%s%d", t.records, t.full ? "f" : "b", t.blocksize, t.encrypted ? "e" : "p", t.fragmentation);
+}
+
+Vector<ParadoxField> ParadoxBenchmark::GetFields(bool full) {
+    Vector<ParadoxField> fields;
+    auto add = [&](const char *name, char type, int length, int decimals = 0) {
+        ParadoxField &f = fields.Add();
+        f.name = name;
+        f.type = type;
+        f.length = length;
+        f.decimals = decimals;
+    };
+
+    add("Id", pxfLong, 4);        // NOLINT: field size
+    add("Name", pxfAlpha, 20);    // NOLINT: field size
+    add("Amount", pxfNumber, 8);  // NOLINT: field size
+    add("Born", pxfDate, 4);      // NOLINT: field size
+    if (full) {
+        add("Changed", pxfTimestamp, 8); // NOLINT: field size
+        add("Price", pxfBCD, 17, 2);     // NOLINT: field size
+        add("Note", pxfMemoBLOb, 20);    // NOLINT: field size
+    }
+    return fields;
+}
+
+bool ParadoxBenchmark::Generate(const String &path, const Table &t) {
+    DeleteFile(path);
+    DeleteFile(ForceExt(path, ".mb"));
+
+    ParadoxSession px;
+    if (!px.Create(path, GetFields(t.full))) {
+        error = Format(t_("The DB %s could not be created"), path);
+        return false;
+    }
+    if (0 != PX_set_value(px, "maxtablesize", float(t.blocksize)) ||
+        (t.encrypted && 0 != PX_set_parameter(px, "password", Password))) {
+        px.Close();
+        error = Format(t_("The DB %s could not be created"), path);
+        return false;
+    }
+
+    // the same records are generated for all tables of one size and field mix
+    uint64 state = 0x9E3779B97F4A7C15ULL ^ (uint64(t.records) << 1 | t.full); // NOLINT: seed
+    int recsize = px.GetRecordSize();
+    Buffer<char> rec(recsize);
+    Vector<Value> row;
+    for (int i = 0; i < t.records; ++i) {
+        row.Clear();
+        row << i + 1 << sText(state, 4, 20);                                     // NOLINT: lengths
+        row << (int(sRandom(state) % 2000000) - 1000000) / 100.0;                // NOLINT: range
+        row << Date(1940 + sRandom(state) % 80, 1 + sRandom(state) % 12, 1 + sRandom(state) % 28); // NOLINT: range
+        if (t.full) {
+            row << Time(2000 + sRandom(state) % 25, 1 + sRandom(state) % 12, 1 + sRandom(state) % 28, // NOLINT: range
+                        sRandom(state) % 24, sRandom(state) % 60, sRandom(state) % 60);           // NOLINT: range
+            row << Format("%d.%02d", int(sRandom(state) % 100000), int(sRandom(state) % 100));     // NOLINT: range
+            String note = sText(state, 0, 200); // NOLINT: lengths
+            row << (note.IsEmpty() ? Value() : Value(note));
+        }
+
+        memset(~rec, 0, recsize);
+        for (int field = 0; field < row.GetCount(); ++field) {
+            if (IsNull(row[field])) {
+                continue;
+            }
+            String val = px.EncodeValue(field, row[field]);
+            memcpy(~rec + px.GetFieldOffset(field), ~val, val.GetCount()); // NOLINT: C code
+        }
+        if (PX_put_record(px, ~rec) < 0) {
+            px.Close();
+            error = Format(t_("The DB %s could not be created"), path);
+            return false;
+        }
+    }
+    px.Close();
+
+    if (t.fragmentation <= 0) {
+        return true;
+    }
+
+    // deleted records leave partly filled data blocks in the whole table
+    ParadoxSession del;
+    if (!del.Open(path)) {
+        error = Format(t_("The DB %s could not be opened"), path);
+        return false;
+    }
+    Vector<int> rows;
+    for (int i = 0; i < del.GetNumRecords(); ++i) {
+        if (int(sRandom(state) % 100) < t.fragmentation) { // NOLINT: percent
+            rows.Add(i);
+        }
+    }
+    bool ok = del.DelRows(rows);
+    del.Close();
+    if (!ok) {
+        error = Format(t_("The DB %s could not be created"), path);
+    }
+    return ok;
+}
+
+void ParadoxBenchmark::Result(Stream &out, const Table &t, const char *test, int64 count, int64 usec, const ParadoxSession &px) {
+    const pxstats_t &io = px.GetIOStatistics();
+    Json json;
+    json("table", GetTableName(t))
+        ("records", t.records)
+        ("fields", t.full ? "full" : "basic")
+        ("blocksize", t.blocksize)
+        ("encrypted", t.encrypted)
+        ("fragmentation", t.fragmentation)
+        ("test", test)
+        ("count", count)
+        ("usec", usec)
+        ("persecond", usec > 0 ? count * 1000000.0 / usec : 0.0) // NOLINT: usecs
+        ("bytesread", int64(io.bytesread))
+        ("seeks", int64(io.seeks))
+        ("blocksread", int64(io.blocksread))
+        ("cachehits", int64(io.cachehits))
+        ("cachemisses", int64(io.cachemisses))
+        ("blocksdecrypted", int64(io.blocksdecrypted))
+        ("allocations", int64(io.allocations))
+        ("arenaallocations", int64(io.arenaallocations));
+    out << json.ToString() << "\n";
+}
+
+bool ParadoxBenchmark::Measure(const String &path, const Table &t, Stream &out) {
+    ParadoxSession px;
+    int64 start = usecs();
+    if (!px.Open(path)) {
+        error = Format(t_("The DB %s could not be opened"), path);
+        return false;
+    }
+    Result(out, t, "open", 1, usecs(start), px);
+
+    int rows = px.GetNumRecords();
+    int64 count = 0;
+    px.ResetStatistics();
+    start = usecs();
+    px.Scan([&](int, const char *data) {
+        px.DecodeRecord(data);
+        ++count;
+        return true;
+    });
+    Result(out, t, "scan", count, usecs(start), px);
+
+    uint64 state = 0x2545F4914F6CDD1DULL ^ uint64(rows); // NOLINT: seed
+    count = 0;
+    px.ResetStatistics();
+    start = usecs();
+    for (int i = 0; i < randomreads && rows > 0; ++i) {
+        px.GetRow(int(sRandom(state) % rows));
+        ++count;
+    }
+    Result(out, t, "random", count, usecs(start), px);
+
+    ParadoxFilter filter;
+    filter.Range(0, t.records / 4, t.records / 2); // NOLINT: quarter of the ids
+    if (filter.Compile(px)) {
+        px.ResetStatistics();
+        start = usecs();
+        px.Select(filter);
+        Result(out, t, "filter", rows, usecs(start), px);
+    }
+
+    String csv;
+    px.ResetStatistics();
+    start = usecs();
+    px.Scan([&](int, const char *data) {
+        Vector<Value> row = px.DecodeRecord(data);
+        for (int i = 0; i < row.GetCount(); ++i) {
+            if (i > 0) {
+                csv << ';';
+            }
+            csv << ParadoxSortedExport::CsvFormat(row[i]);
+        }
+        csv << "\r\n";
+        return true;
+    });
+    Result(out, t, "csv", rows, usecs(start), px);
+
+    Vector<String> names;
+    for (const SqlColumnInfo &c : px.EnumColumns(Null, Null)) {
+        names.Add(c.name);
+    }
+    JsonArray json;
+    px.ResetStatistics();
+    start = usecs();
+    px.Scan([&](int, const char *data) {
+        Vector<Value> row = px.DecodeRecord(data);
+        Json obj;
+        for (int i = 0; i < row.GetCount() && i < names.GetCount(); ++i) {
+            obj(names[i], row[i]);
+        }
+        json << obj;
+        return true;
+    });
+    String text = json.ToString();
+    Result(out, t, "json", rows, usecs(start), px);
+
+    px.Close();
+    return true;
+}
+
+bool ParadoxBenchmark::Run(const String &directory, Stream &out) {
+    error.Clear();
+
+    if (!RealizeDirectory(directory)) {
+        error = Format(t_("The directory %s could not be created"), directory);
+        return false;
+    }
+
+    for (int n : records) {
+        for (int full = 0; full < 2; ++full) {
+            for (int blocksize : BlockSizes) {
+                for (int encrypted = 0; encrypted < 2; ++encrypted) {
+                    for (int fragmentation : Fragmentations) {
+                        Table t;
+                        t.records = n;
+                        t.full = full != 0;
+                        t.blocksize = blocksize;
+                        t.encrypted = encrypted != 0;
+                        t.fragmentation = fragmentation;
+
+                        String path = AppendFileName(directory, GetTableName(t) + ".db");
+                        bool ok = Generate(path, t) && Measure(path, t, out);
+                        if (!keep) {
+                            DeleteFile(path);
+                            DeleteFile(ForceExt(path, ".mb"));
+                        }
+                        if (!ok) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,66 @@
+#ifndef PxBench_h_
+#define PxBench_h_
+
+#include "PxSession.h"
+
+namespace Upp {
+
+// Generates reproducible Paradox tables by pxlib and measures the work with
+// them. The tables vary by the number of records, the mix of the field types,
+// the size of the data blocks, the encryption and the part of the deleted
+// records. Open, full scan, random access to the rows, filter and CSV and
+// JSON export are measured for each of them, one JSON object per line is
+// written for each measurement.
+class ParadoxBenchmark {
+  public:
+    ParadoxBenchmark();
+
+    ParadoxBenchmark &Records(const Vector<int> &counts) {
+        records = clone(counts);
+        return *this;
+    }
+    // Number of the rows read by the random access
+    ParadoxBenchmark &RandomReads(int n) {
+        randomreads = n;
+        return *this;
+    }
+    // Generated tables are left in the directory
+    ParadoxBenchmark &KeepTables(bool b = true) {
+        keep = b;
+        return *this;
+    }
+
+    // Tables are generated in the directory, returns false when one of them
+    // could not be generated or opened
+    bool Run(const String &directory, Stream &out);
+
+    String GetError() const {
+        return error;
+    }
+
+  private:
+    struct Table {
+        int records = 0;
+        bool full = false;
+        int blocksize = 0; // kB
+        bool encrypted = false;
+        int fragmentation = 0; // percent of the deleted records
+    };
+
+    Vector<int> records;
+    int randomreads = 1000; // NOLINT: default count
+    bool keep = false;
+    String error;
+
+    static String GetTableName(const Table &t);
+    static Vector<ParadoxField> GetFields(bool full);
+
+    bool Generate(const String &path, const Table &t);
+    bool Measure(const String &path, const Table &t, Stream &out);
+    static void Result(Stream &out, const Table &t, const char *test, int64 count, int64 usec, const ParadoxSession &px);
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
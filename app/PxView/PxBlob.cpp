@@ -0,0 +1,213 @@
+#include "PxBlob.h"
+
+extern "C" {
+#include "lib/px_crypt.h"
+}
+
+using namespace Upp;
+
+String ParadoxBlobExtractor::ReadMb(FileIn &in, int64 pos, int len, dword encryption) {
+    // encrypted data are decrypted in chunks of 256 bytes
+    int size = encryption != 0 ? (len + 0xff) & ~0xff : len; // NOLINT: chunk size
+
+    StringBuffer data(size);
+    in.Seek(pos);
+    if (!in.GetAll(~data, size)) {
+        return String();
+    }
+
+    if (encryption != 0) {
+        auto *raw = reinterpret_cast<unsigned char *>(~data); // NOLINT: C code
+        px_decrypt_mb_block(raw, raw, encryption, size);
+    }
+
+    data.SetCount(len);
+    return String(data);
+}
+
+int ParadoxBlobExtractor::ReadPointer(ParadoxSession &px, const char *record, int field, Pointer &p) {
+    // the pointer to the blob file, the size and the modification number are behind the leader
+    pxfield_t *pxf = PX_get_fields(px);
+    const char *data = record + px.GetFieldOffset(field); // NOLINT: C code
+    int leader = pxf[field].px_flen - 10;                 // NOLINT: blob pointer size
+    if (leader < 0) {
+        return -1;
+    }
+    dword ptr = Peek32le(data + leader);           // NOLINT: C code
+    p.offset = int(ptr & 0xffffff00);              // NOLINT: blob pointer
+    p.index = int(ptr & 0xff);                     // NOLINT: blob pointer
+    p.size = Peek32le(data + leader + 4);          // NOLINT: C code
+    p.modnr = Peek16le(data + leader + 8);         // NOLINT: C code
+    p.graphic = pxf[field].px_ftype == pxfGraphic; // NOLINT: C code
+    return leader;
+}
+
+void ParadoxBlobExtractor::Schedule(CoWork &co, int groupcount, int parts, Event<int, int, int> work) {
+    for (int k = 0; k < parts; ++k) {
+        int from = k * groupcount / parts;
+        int to = (k + 1) * groupcount / parts;
+        co & [=] {
+            work(k, from, to);
+        };
+    }
+}
+
+String ParadoxBlobExtractor::ReadSingle(FileIn &in, const Blob &blob, dword encryption) {
+    // header and data of a single blob block are read at once
+    const int hsize = blob.graphic ? 17 : 9; // NOLINT: header size
+    int blobsize = blob.GetDataSize();
+
+    String data = ReadMb(in, blob.offset, hsize + blobsize, encryption);
+    if (data.GetCount() < hsize || data[0] != 2 || Peek32le(~data + 3) != blob.size) { // NOLINT: C code
+        return String();
+    }
+
+    return data.Mid(hsize, blobsize);
+}
+
+static String sSuballocated(const String &block, int index, int size, bool graphic) {
+    // table of the blobs is behind the 12 bytes of the block header, 5 bytes per blob
+    int entry = 12 + index * 5; // NOLINT: block header
+    if (block.GetCount() < ParadoxBlobExtractor::MbBlockSize || block[0] != 3 || entry + 5 > block.GetCount()) {
+        return String();
+    }
+
+    const auto *p = reinterpret_cast<const byte *>(~block) + entry; // NOLINT: C code
+    int start = p[0] * 16;                                           // NOLINT: C code
+    if (size != (p[1] - 1) * 16 + p[4]) {                            // NOLINT: C code
+        return String();
+    }
+
+    // pxlib reads size bytes of a suballocated blob, also of a graphic, and
+    // returns the first ones without the graphic header size
+    if (start + size > block.GetCount()) {
+        return String();
+    }
+    return block.Mid(start, graphic ? size - 8 : size); // NOLINT: graphic header
+}
+
+int ParadoxBlobExtractor::Extract(ParadoxSession &px, const String &dir, Gate<int, int> progress) {
+    failed = 0;
+    error.Clear();
+
+    if (!px.IsOpen()) {
+        error = t_("The DB is not open");
+        return -1;
+    }
+
+    pxdoc_t *pxdoc = px;
+    pxfield_t *pxf = PX_get_fields(pxdoc);
+
+    Vector<int> fields;
+    for (int i = 0; i < px.GetNumFields(); ++i) {
+        char type = pxf[i].px_ftype; // NOLINT: C code
+        if (type == pxfBLOb || type == pxfOLE || type == pxfGraphic) {
+            fields.Add(i);
+        }
+    }
+
+    // pointers to the blob data are collected without decoding the records
+    Vector<Blob> blobs;
+    Index<String> filenames;
+    px.Scan([&](int, const char *data) {
+        for (int field : fields) {
+            Pointer p;
+            int leader = ReadPointer(px, data, field, p);
+            int blobsize = p.GetDataSize();
+            if (leader < 0 || blobsize <= 0) {
+                continue;
+            }
+
+            // a blob pointed to by several records is written once
+            String filename = px.GetBlobName(data, field);
+            if (filenames.Find(filename) >= 0) {
+                continue;
+            }
+            filenames.Add(filename);
+
+            Blob &b = blobs.Add();
+            static_cast<Pointer &>(b) = p;
+            b.filename = filename;
+            if (blobsize <= leader) {
+                b.offset = 0;
+                b.data = String(data + px.GetFieldOffset(field), blobsize); // NOLINT: C code
+            }
+        }
+        return true;
+    });
+
+    if (blobs.IsEmpty()) {
+        return 0;
+    }
+
+    String mbfile = px.GetBlobFilePath();
+    if (IsNull(mbfile)) {
+        error = t_("The blob file of the DB does not exist");
+    }
+
+    // the blobs are processed in the order of the .mb file
+    Vector<int> order;
+    Vector<int> groups = GroupByBlock(blobs, order);
+    int groupcount = groups.GetCount() - 1;
+
+    auto encryption = static_cast<dword>(px.GetEncryption());
+
+    Atomic done(0);
+    Atomic errors(0);
+    std::atomic<bool> cancel(false);
+
+    auto work = [&](int from, int to) {
+        FileIn in;
+        bool mb = !IsNull(mbfile) && in.Open(mbfile);
+        String block;
+
+        for (int g = from; g < to && !cancel; ++g) {
+            for (int i = groups[g]; i < groups[g + 1]; ++i) {
+                const Blob &b = blobs[order[i]];
+                String data;
+                if (b.offset == 0) {
+                    data = b.data;
+                } else if (mb && b.index == SingleBlock) {
+                    data = ReadSingle(in, b, encryption);
+                } else if (mb) {
+                    if (i == groups[g]) {
+                        block = ReadMb(in, b.offset, MbBlockSize, encryption);
+                    }
+                    data = sSuballocated(block, b.index, b.size, b.graphic);
+                }
+
+                if (data.IsEmpty() || !SaveFile(AppendFileName(dir, b.filename), data)) {
+                    ++errors;
+                }
+                ++done;
+            }
+        }
+    };
+
+    int n = GetPartCount(groupcount, threads);
+    Atomic running(n);
+    CoWork co;
+    Schedule(co, groupcount, n, [&](int, int from, int to) {
+        work(from, to);
+        --running;
+    });
+
+    if (progress) {
+        while (running > 0) {
+            if (progress(done, blobs.GetCount())) {
+                cancel = true;
+            }
+            Sleep(50); // NOLINT: progress refresh
+        }
+    }
+    co.Finish();
+
+    failed = errors;
+    if (failed > 0 && error.IsEmpty()) {
+        error = t_("Some blobs could not be read or written");
+    }
+
+    return done - errors;
+}
+
+// vim: ts=4 sw=4 expandtab
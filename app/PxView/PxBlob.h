@@ -0,0 +1,103 @@
+#ifndef PxBlob_h_
+#define PxBlob_h_
+
+#include "PxSession.h"
+
+namespace Upp {
+
+// Writes the data of the binary blob fields (BLOb, OLE, graphic) of a table
+// to files named by ParadoxSession::GetBlobName() like the values shown for
+// them. The .mb file is read by a pool of threads, each
+// with its own file handle, and all blobs suballocated in one block of the
+// file are taken from a single read of that block.
+class ParadoxBlobExtractor {
+  public:
+    // 0 means the number of CPU cores
+    ParadoxBlobExtractor &Threads(int n) {
+        threads = n;
+        return *this;
+    }
+
+    // Returns the number of written files or -1 when nothing could be done,
+    // progress gets the number of processed and all blobs and returns true to cancel
+    int Extract(ParadoxSession &px, const String &dir, Gate<int, int> progress = Null);
+
+    int GetFailedCount() const {
+        return failed;
+    }
+    String GetError() const {
+        return error;
+    }
+
+    static constexpr int MbBlockSize = 4096; // NOLINT: block of the .mb file
+    static constexpr int SingleBlock = 0xff; // NOLINT: index of a single blob block
+
+    // Pointer to the blob data behind the leader of a blob field
+    struct Pointer {
+        int offset = 0; // block in the .mb file, 0 for data stored in the record
+        int index = 0;  // entry of a suballocated block, 0xff for a single blob block
+        int size = 0;   // graphics have 8 more bytes in front of the data
+        int modnr = 0;
+        bool graphic = false;
+
+        int GetDataSize() const {
+            return graphic ? size - 8 : size; // NOLINT: graphic header
+        }
+    };
+
+    // Reads the pointer of the field of a record, returns the size of the
+    // leader or -1 when the field is too short for a pointer
+    static int ReadPointer(ParadoxSession &px, const char *record, int field, Pointer &p);
+
+    // Orders the blobs by their place in the .mb file, the ones suballocated
+    // in one block form a group. Returns the position in order of the first
+    // blob of each group followed by the end of the last group.
+    template <class T>
+    static Vector<int> GroupByBlock(const Vector<T> &blobs, Vector<int> &order) {
+        order.Clear();
+        for (int i = 0; i < blobs.GetCount(); ++i) {
+            order.Add(i);
+        }
+        Sort(order, [&](int a, int b) {
+            return blobs[a].offset != blobs[b].offset ? blobs[a].offset < blobs[b].offset : blobs[a].index < blobs[b].index;
+        });
+        Vector<int> groups;
+        for (int i = 0; i < order.GetCount(); ++i) {
+            int offset = blobs[order[i]].offset;
+            if (i == 0 || offset == 0 || offset != blobs[order[i - 1]].offset) {
+                groups.Add(i);
+            }
+        }
+        groups.Add(order.GetCount());
+        return groups;
+    }
+
+    // Number of the parts of the groups processed by the threads, 0 threads
+    // means the number of CPU cores
+    static int GetPartCount(int groupcount, int threads) {
+        return max(min(threads > 0 ? threads : CPU_Cores(), groupcount), 1);
+    }
+    // Runs work(part, from, to) for every part of the groups in co, each
+    // thread gets a continuous part of the file
+    static void Schedule(CoWork &co, int groupcount, int parts, Event<int, int, int> work);
+
+    // Reads len bytes at pos of the .mb file and decrypts them
+    static String ReadMb(FileIn &in, int64 pos, int len, dword encryption);
+
+  private:
+    struct Blob : Moveable<Blob, Pointer> {
+        String filename;
+        String data; // data stored in the record
+    };
+
+    int threads = 0;
+    int failed = 0;
+    String error;
+
+    static String ReadSingle(FileIn &in, const Blob &blob, dword encryption);
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,413 @@
+#include "PxColumns.h"
+
+using namespace Upp;
+
+static const int RadixPart = 65536; // NOLINT: keys sorted by one thread
+
+// Keys of the numbers keep the order of the numbers when they are compared
+// as unsigned integers
+static uint64 sIntKey(int64 v) {
+    return uint64(v) ^ 0x8000000000000000ULL; // NOLINT: sign bit
+}
+
+static uint64 sRealKey(double v) {
+    uint64 bits = 0;
+    memcpy(&bits, &v, sizeof(bits));
+    return (bits & 0x8000000000000000ULL) ? ~bits : bits | 0x8000000000000000ULL; // NOLINT: sign bit
+}
+
+// Seconds of a "H:i:s" text, -1 when it is not a time
+static int sTimeKey(const char *s, int len) {
+    const char *e = s + len; // NOLINT: C code
+    int key = 0;
+    while (s < e) {
+        if (!IsDigit(*s)) {
+            return -1;
+        }
+        int part = 0;
+        while (s < e && IsDigit(*s)) {
+            part = 10 * part + (*s++ - '0'); // NOLINT: digits
+        }
+        key = 60 * key + part; // NOLINT: sexagesimal
+        if (s < e && *s++ != ':') {
+            return -1;
+        }
+    }
+    return len > 0 ? key : -1;
+}
+
+struct Decimal {
+    bool negative = false;
+    const char *digits = nullptr; // integer part without leading zeros
+    int length = 0;
+    const char *fraction = nullptr; // without trailing zeros
+    int fractionLength = 0;
+};
+
+static Decimal sDecimal(const char *s, int len) {
+    const char *e = s + len; // NOLINT: C code
+    Decimal d;
+    if (s < e && (*s == '-' || *s == '+')) {
+        d.negative = *s++ == '-';
+    }
+    while (s < e && *s == '0') {
+        ++s;
+    }
+    d.digits = s;
+    while (s < e && IsDigit(*s)) {
+        ++s;
+    }
+    d.length = int(s - d.digits);
+    if (s < e && (*s == '.' || *s == ',')) {
+        ++s;
+    }
+    d.fraction = s;
+    while (s < e && IsDigit(*s)) {
+        ++s;
+    }
+    d.fractionLength = int(s - d.fraction);
+    while (d.fractionLength > 0 && d.fraction[d.fractionLength - 1] == '0') {
+        --d.fractionLength;
+    }
+    if (d.length == 0 && d.fractionLength == 0) {
+        d.negative = false; // -0
+    }
+    return d;
+}
+
+// BCD fields have more digits than a double, so they are compared digit by digit
+static int sCompareDecimal(const char *a, int alen, const char *b, int blen) {
+    Decimal x = sDecimal(a, alen);
+    Decimal y = sDecimal(b, blen);
+    if (x.negative != y.negative) {
+        return x.negative ? -1 : 1;
+    }
+
+    int r = x.length - y.length;
+    if (r == 0) {
+        r = memcmp(x.digits, y.digits, x.length);
+    }
+    for (int i = 0; r == 0 && i < max(x.fractionLength, y.fractionLength); ++i) {
+        r = (i < x.fractionLength ? x.fraction[i] : '0') - (i < y.fractionLength ? y.fraction[i] : '0');
+    }
+    r = sgn(r);
+    return x.negative ? -r : r;
+}
+
+// UTF-8 texts compared by bytes are in the order of the code points
+static int sCompareText(const char *a, int alen, const char *b, int blen) {
+    int r = memcmp(a, b, min(alen, blen));
+    return r != 0 ? sgn(r) : sgn(alen - blen);
+}
+
+// LSD radix sort by bytes. Every thread counts and moves a continuous part
+// of the keys, so the sort stays stable. The bytes which are the same for
+// all keys are skipped.
+static void sRadixSort(Vector<uint64> &keys, Vector<int> &rows) {
+    int n = keys.GetCount();
+    int parts = clamp(n / RadixPart, 1, CPU_Cores());
+    auto from = [&](int k) { return int(int64(k) * n / parts); };
+    auto run = [&](const Function<void(int)> &work) {
+        if (parts == 1) {
+            work(0);
+            return;
+        }
+        CoWork co;
+        for (int k = 0; k < parts; ++k) {
+            co & [=, &work] { work(k); };
+        }
+        co.Finish();
+    };
+
+    Vector<uint64> tkeys;
+    Vector<int> trows;
+    tkeys.SetCount(n);
+    trows.SetCount(n);
+    Buffer<int> counts(parts * 256); // NOLINT: byte values
+
+    for (int shift = 0; shift < 64; shift += 8) { // NOLINT: bytes of the key
+        memset(~counts, 0, parts * 256 * sizeof(int)); // NOLINT: byte values
+        run([&](int k) {
+            int *count = ~counts + 256 * k; // NOLINT: C code
+            for (int i = from(k); i < from(k + 1); ++i) {
+                count[(keys[i] >> shift) & 255]++; // NOLINT: C code
+            }
+        });
+
+        // the counts become the positions of the parts in the output
+        int pos = 0;
+        bool same = false;
+        for (int digit = 0; digit < 256 && !same; ++digit) { // NOLINT: byte values
+            int start = pos;
+            for (int k = 0; k < parts; ++k) {
+                int count = counts[256 * k + digit]; // NOLINT: byte values
+                counts[256 * k + digit] = pos;       // NOLINT: byte values
+                pos += count;
+            }
+            same = pos - start == n;
+        }
+        if (same) {
+            continue;
+        }
+
+        run([&](int k) {
+            int *next = ~counts + 256 * k; // NOLINT: C code
+            for (int i = from(k); i < from(k + 1); ++i) {
+                int j = next[(keys[i] >> shift) & 255]++; // NOLINT: C code
+                tkeys[j] = keys[i];
+                trows[j] = rows[i];
+            }
+        });
+        Swap(keys, tkeys);
+        Swap(rows, trows);
+    }
+}
+
+void ParadoxColumns::AddColumn(dword type, int format) {
+    Column &c = columns.Add();
+    c.format = format;
+    switch (type) {
+    case INT_V:
+        c.kind = INTEGER;
+        break;
+    case BOOL_V:
+        c.kind = LOGICAL;
+        break;
+    case DOUBLE_V:
+        c.kind = REAL;
+        break;
+    case DATE_V:
+        c.kind = DAYS;
+        break;
+    case TIME_V:
+        c.kind = SECONDS;
+        break;
+    default:
+        c.kind = TEXT;
+        break;
+    }
+
+    // rows added before the column are empty
+    for (int row = 0; row < count; ++row) {
+        Grow(c, row);
+        Store(c, row, Value());
+    }
+}
+
+void ParadoxColumns::Clear() {
+    columns.Clear();
+    count = 0;
+}
+
+void ParadoxColumns::SetNull(Column &c, int row, bool null) {
+    dword bit = 1u << (row & 31); // NOLINT: bitmap
+    if (null) {
+        c.nulls[row >> 5] |= bit; // NOLINT: bitmap
+    } else {
+        c.nulls[row >> 5] &= ~bit; // NOLINT: bitmap
+    }
+}
+
+void ParadoxColumns::Store(Column &c, int row, const Value &value) {
+    bool null = IsNull(value);
+
+    switch (c.kind) {
+    case INTEGER:
+    case LOGICAL:
+        null = null || !IsNumber(value);
+        c.ints[row] = null ? 0 : (c.kind == LOGICAL ? int(bool(value)) : int(value));
+        break;
+    case REAL:
+        null = null || !IsNumber(value);
+        c.reals[row] = null ? 0 : double(value);
+        break;
+    case DAYS:
+        null = null || !IsDateTime(value);
+        c.ints[row] = null ? 0 : Date(value).Get();
+        break;
+    case SECONDS:
+        null = null || !IsDateTime(value);
+        c.seconds[row] = null ? 0 : Time(value).Get();
+        break;
+    default: {
+        // texts are kept in UTF-8, a changed text is appended to the buffer
+        bool wide = value.GetType() == WSTRING_V;
+        String s = null ? String() : (wide ? ToUtf8(WString(value)) : AsString(value));
+        c.wide = c.wide || wide;
+        c.start[row] = c.text.GetCount();
+        c.length[row] = s.GetCount();
+        c.text.Cat(s);
+        break;
+    }
+    }
+
+    SetNull(c, row, null);
+}
+
+void ParadoxColumns::Grow(Column &c, int row) {
+    if ((row & 31) == 0) { // NOLINT: bitmap
+        c.nulls.Add(0);
+    }
+    switch (c.kind) {
+    case REAL:
+        c.reals.Add(0);
+        break;
+    case SECONDS:
+        c.seconds.Add(0);
+        break;
+    case TEXT:
+        c.start.Add(0);
+        c.length.Add(0);
+        break;
+    default:
+        c.ints.Add(0);
+        break;
+    }
+}
+
+int ParadoxColumns::Add(const Vector<Value> &row) {
+    for (int col = 0; col < columns.GetCount(); ++col) {
+        Column &c = columns[col];
+        Grow(c, count);
+        Store(c, count, col < row.GetCount() ? row[col] : Value());
+    }
+    return count++;
+}
+
+void ParadoxColumns::Set(int row, int col, const Value &value) {
+    if (row >= 0 && row < count && col >= 0 && col < columns.GetCount()) {
+        Store(columns[col], row, value);
+    }
+}
+
+Value ParadoxColumns::Get(int row, int col) const {
+    if (row < 0 || row >= count || col < 0 || col >= columns.GetCount()) {
+        return Value();
+    }
+
+    const Column &c = columns[col];
+    if (IsNullAt(c, row)) {
+        return Value();
+    }
+
+    switch (c.kind) {
+    case INTEGER:
+        return c.ints[row];
+    case LOGICAL:
+        return c.ints[row] != 0;
+    case REAL:
+        return c.reals[row];
+    case DAYS: {
+        Date d;
+        d.Set(c.ints[row]);
+        return d;
+    }
+    case SECONDS: {
+        Time t;
+        t.Set(c.seconds[row]);
+        return t;
+    }
+    default:
+        break;
+    }
+
+    const char *s = ~c.text + c.start[row]; // NOLINT: C code
+    if (c.wide) {
+        return FromUtf8(s, c.length[row]);
+    }
+    return String(s, c.length[row]);
+}
+
+int64 ParadoxColumns::GetMemoryUsage() const {
+    int64 size = columns.GetCount() * int64(sizeof(Column));
+    for (const Column &c : columns) {
+        size += c.nulls.GetAlloc() * int64(sizeof(dword));
+        size += c.ints.GetAlloc() * int64(sizeof(int));
+        size += c.reals.GetAlloc() * int64(sizeof(double));
+        size += c.seconds.GetAlloc() * int64(sizeof(int64));
+        size += (c.start.GetAlloc() + c.length.GetAlloc()) * int64(sizeof(int));
+        size += c.text.GetAlloc();
+    }
+    return size;
+}
+
+bool ParadoxColumns::GetKey(const Column &c, int row, uint64 &key) {
+    switch (c.kind) {
+    case REAL:
+        key = sRealKey(c.reals[row]);
+        return true;
+    case SECONDS:
+        key = sIntKey(c.seconds[row]);
+        return true;
+    case TEXT: {
+        int seconds = sTimeKey(~c.text + c.start[row], c.length[row]); // NOLINT: C code
+        key = seconds;
+        return seconds >= 0;
+    }
+    default:
+        key = sIntKey(c.ints[row]);
+        return true;
+    }
+}
+
+Vector<int> ParadoxColumns::Sort(int col, const Vector<int> &rows, bool descending) const {
+    Vector<int> order;
+    if (col < 0 || col >= columns.GetCount()) {
+        order.Append(rows);
+        return order;
+    }
+
+    // the empty values are kept apart
+    const Column &c = columns[col];
+    Vector<int> nulls;
+    auto isnull = [&](int row) { return row < 0 || row >= count || IsNullAt(c, row); };
+
+    if (c.kind == TEXT && c.format != TIME_TEXT) {
+        struct Text : Moveable<Text> {
+            const char *s;
+            int length;
+            int row;
+        };
+        Vector<Text> texts;
+        for (int row : rows) {
+            if (isnull(row)) {
+                nulls.Add(row);
+                continue;
+            }
+            Text &t = texts.Add();
+            t.s = ~c.text + c.start[row]; // NOLINT: C code
+            t.length = c.length[row];
+            t.row = row;
+        }
+        bool decimal = c.format == DECIMAL_TEXT;
+        StableSort(texts, [&](const Text &a, const Text &b) {
+            int r = decimal ? sCompareDecimal(a.s, a.length, b.s, b.length) : sCompareText(a.s, a.length, b.s, b.length);
+            return descending ? r > 0 : r < 0;
+        });
+        for (const Text &t : texts) {
+            order.Add(t.row);
+        }
+    } else {
+        Vector<uint64> keys;
+        for (int row : rows) {
+            uint64 key = 0;
+            if (isnull(row) || !GetKey(c, row, key)) {
+                nulls.Add(row);
+                continue;
+            }
+            // the inverted keys keep the equal values in their order
+            keys.Add(descending ? ~key : key);
+            order.Add(row);
+        }
+        sRadixSort(keys, order);
+    }
+
+    if (descending) {
+        order.Append(nulls);
+        return order;
+    }
+    nulls.Append(order);
+    return nulls;
+}
+
+// vim: ts=4 sw=4 expandtab
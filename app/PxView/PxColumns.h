@@ -0,0 +1,74 @@
+#ifndef PxColumns_h_
+#define PxColumns_h_
+
+#include <Core/Core.h>
+
+namespace Upp {
+
+// Decoded records kept by columns. Numbers, dates, times and blob sizes are
+// stored in arrays of fixed size, the texts of a column one after another in
+// one buffer and the empty values in a bitmap. A Value is made only when a
+// cell is read, so the memory is close to the size of the data itself.
+class ParadoxColumns {
+  public:
+    // Texts which are sorted by their value: BCD numbers and times of day
+    enum { PLAIN_TEXT, DECIMAL_TEXT, TIME_TEXT };
+
+    // Type of the column is the type of its values as returned by
+    // SqlColumnInfo, the other types are kept as texts
+    void AddColumn(dword type, int format = PLAIN_TEXT);
+    void Clear();
+
+    // Returns the number of the new row
+    int Add(const Vector<Value> &row);
+    void Set(int row, int col, const Value &value);
+    Value Get(int row, int col) const;
+
+    int GetCount() const {
+        return count;
+    }
+    int GetColumnCount() const {
+        return columns.GetCount();
+    }
+    // Bytes allocated by the columns
+    int64 GetMemoryUsage() const;
+
+    // Returns the rows ordered by the values of the column. Numbers, dates
+    // and times are ordered by a radix sort of their keys, texts by a merge
+    // sort. Rows with equal values keep their order, the empty values are
+    // first in the ascending order.
+    Vector<int> Sort(int col, const Vector<int> &rows, bool descending = false) const;
+
+  private:
+    enum { INTEGER, LOGICAL, REAL, DAYS, SECONDS, TEXT };
+
+    struct Column {
+        int kind = TEXT;
+        int format = PLAIN_TEXT;
+        bool wide = false; // texts are returned as WString
+        Vector<dword> nulls;
+        Vector<int> ints;       // INTEGER, LOGICAL, DAYS
+        Vector<double> reals;   // REAL
+        Vector<int64> seconds;  // SECONDS
+        Vector<int> start;      // TEXT
+        Vector<int> length;     // TEXT
+        String text;            // TEXT, edited values are appended
+    };
+
+    Array<Column> columns;
+    int count = 0;
+
+    static bool IsNullAt(const Column &c, int row) {
+        return (c.nulls[row >> 5] & (1u << (row & 31))) != 0; // NOLINT: bitmap
+    }
+    static void SetNull(Column &c, int row, bool null);
+    static void Grow(Column &c, int row);
+    // Sort key of a value which is not empty, false for a text which is not a time
+    static bool GetKey(const Column &c, int row, uint64 &key);
+    static void Store(Column &c, int row, const Value &value);
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,443 @@
+#include "PxCommand.h"
+#include "PxBench.h"
+#include "PxExport.h"
+#include "PxDiff.h"
+#include "PxRecover.h"
+#include "PxVerify.h"
+
+extern "C" {
+#include "lib/paradox-mp.h"
+}
+
+using namespace Upp;
+
+static void sUsage(const String &mode);
+
+static void sBenchmark(Vector<String> args) {
+    // statistics of the memory allocated by pxlib are written to the error output
+    bool memprof = args.GetCount() > 1 && args[1] == "--memprof";
+    if (memprof) {
+        args.Remove(1);
+        ParadoxSession::MemoryProfile();
+        PX_mp_init();
+    }
+
+    if (args.GetCount() < 2) {
+        sUsage(args[0]);
+        return;
+    }
+
+    ParadoxBenchmark bench;
+    if (args.GetCount() > 3) {
+        Vector<int> records;
+        for (const String &s : Split(args[3], ',')) {
+            int n = ScanInt(s);
+            if (!IsNull(n) && n > 0) {
+                records.Add(n);
+            }
+        }
+        bench.Records(records);
+    }
+
+    FileOut out;
+    if (args.GetCount() > 2 && !out.Open(args[2])) {
+        Cerr() << "The file " << args[2] << " could not be created\n";
+        SetExitCode(1);
+        return;
+    }
+    if (!bench.Run(args[1], out.IsOpen() ? static_cast<Stream &>(out) : Cout())) {
+        Cerr() << bench.GetError() << "\n";
+        SetExitCode(1);
+    }
+
+    if (memprof) {
+        Cerr().Flush();
+        PX_mp_report(stderr);
+        PX_mp_done();
+    }
+}
+
+static void sExport(Vector<String> args) {
+    String sort;
+    int memory = 0;
+    while (args.GetCount() > 2 && (args[1] == "--sort" || args[1] == "--memory")) {
+        if (args[1] == "--sort") {
+            sort = args[2];
+        } else {
+            memory = ScanInt(args[2]);
+        }
+        args.Remove(1, 2);
+    }
+
+    if (args.GetCount() != 3) {
+        sUsage(args[0]);
+        return;
+    }
+
+    ParadoxSession px;
+    if (!px.Open(args[1])) {
+        Cerr() << "The DB " << args[1] << " could not be opened\n";
+        SetExitCode(1);
+        return;
+    }
+
+    ParadoxSortedExport exporter;
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    for (String name : Split(sort, ',')) {
+        bool descending = name.StartsWith("-");
+        if (descending) {
+            name.Remove(0);
+        }
+        int field = -1;
+        for (int i = 0; i < columns.GetCount() && field < 0; ++i) {
+            if (ToLower(columns[i].name) == ToLower(name)) {
+                field = i;
+            }
+        }
+        if (field < 0) {
+            Cerr() << "The field " << name << " does not exist\n";
+            SetExitCode(1);
+            return;
+        }
+        exporter.SortBy(field, descending);
+    }
+    if (memory > 0) {
+        exporter.MemoryLimit(int64(memory) << 20); // NOLINT: MB
+    }
+    exporter.Output(ToLower(GetFileExt(args[2])) == ".json" ? ParadoxSortedExport::JSON : ParadoxSortedExport::CSV);
+
+    FileOut out;
+    if (!out.Open(args[2])) {
+        Cerr() << "The file " << args[2] << " could not be created\n";
+        SetExitCode(1);
+        return;
+    }
+    if (exporter.Export(px, out) < 0) {
+        Cerr() << exporter.GetError() << "\n";
+        SetExitCode(1);
+    }
+}
+
+static void sDeltaExport(Vector<String> args) {
+    bool changes = false;
+    String cache;
+    while (args.GetCount() > 1 && (args[1] == "--changes" || (args[1] == "--cache" && args.GetCount() > 2))) {
+        if (args[1] == "--changes") {
+            changes = true;
+            args.Remove(1);
+        } else {
+            cache = args[2];
+            args.Remove(1, 2);
+        }
+    }
+
+    if (args.GetCount() != 3) {
+        sUsage(args[0]);
+        return;
+    }
+
+    ParadoxSession px;
+    if (!px.Open(args[1])) {
+        Cerr() << "The DB " << args[1] << " could not be opened\n";
+        SetExitCode(1);
+        return;
+    }
+
+    // the blocks of the previous export are kept next to the output by default
+    ParadoxDeltaExport exporter;
+    exporter.Cache(Nvl(cache, args[2] + ".pxdelta"));
+    if (changes) {
+        exporter.Output(ParadoxDeltaExport::CHANGES);
+    } else {
+        exporter.Output(ToLower(GetFileExt(args[2])) == ".json" ? ParadoxDeltaExport::JSON : ParadoxDeltaExport::CSV);
+    }
+
+    FileOut out;
+    if (!out.Open(args[2])) {
+        Cerr() << "The file " << args[2] << " could not be created\n";
+        SetExitCode(1);
+        return;
+    }
+    if (exporter.Export(px, out) < 0) {
+        Cerr() << exporter.GetError() << "\n";
+        SetExitCode(1);
+        return;
+    }
+    Cout() << "Decoded blocks: " << exporter.GetDecodedBlocks() << ", cached blocks: " << exporter.GetCachedBlocks()
+           << "\n";
+}
+
+static void sDiff(Vector<String> args) {
+    ParadoxDiff diff;
+    if (args.GetCount() > 1 && args[1] == "--position") {
+        diff.ByPosition();
+        args.Remove(1);
+    }
+
+    if (args.GetCount() != 3 && args.GetCount() != 4) {
+        sUsage(args[0]);
+        return;
+    }
+
+    ParadoxSession before;
+    ParadoxSession after;
+    for (int i = 1; i <= 2; ++i) {
+        if (!(i == 1 ? before : after).Open(args[i])) {
+            Cerr() << "The DB " << args[i] << " could not be opened\n";
+            SetExitCode(1);
+            return;
+        }
+    }
+
+    FileOut file;
+    if (args.GetCount() == 4 && !file.Open(args[3])) {
+        Cerr() << "The file " << args[3] << " could not be created\n";
+        SetExitCode(1);
+        return;
+    }
+    Stream &out = file.IsOpen() ? static_cast<Stream &>(file) : Cout();
+
+    // one JSON object on a line for each added, removed or changed record
+    Vector<SqlColumnInfo> columns = after.EnumColumns(Null, Null);
+    auto object = [&](ParadoxSession &px, const char *data, const Vector<int> &fields) {
+        Json obj;
+        Vector<Value> row = px.DecodeRecord(data, fields);
+        for (int i = 0; i < fields.GetCount(); ++i) {
+            obj(columns[fields[i]].name, AsString(row[i]));
+        }
+        return obj.ToString();
+    };
+    Vector<int> all;
+    for (int i = 0; i < columns.GetCount(); ++i) {
+        all.Add(i);
+    }
+    bool ok = diff.Run(before, after, [&](const ParadoxDifference &d) {
+        Vector<int> key;
+        for (int i = 0; i < diff.GetKeyFields(); ++i) {
+            key.Add(i);
+        }
+        Json line;
+        if (d.kind == ParadoxDifference::ADDED) {
+            line("op", "added")("new", d.newrecord);
+        } else if (d.kind == ParadoxDifference::REMOVED) {
+            line("op", "removed")("old", d.oldrecord);
+        } else {
+            line("op", "changed")("old", d.oldrecord)("new", d.newrecord);
+        }
+        if (!key.IsEmpty()) {
+            line.CatRaw("key", object(d.newdata ? after : before, d.newdata ? d.newdata : d.olddata, key));
+        }
+        if (d.kind == ParadoxDifference::CHANGED) {
+            Vector<Value> oldrow = before.DecodeRecord(d.olddata, d.fields);
+            Vector<Value> newrow = after.DecodeRecord(d.newdata, d.fields);
+            Json changes;
+            for (int i = 0; i < d.fields.GetCount(); ++i) {
+                changes.CatRaw(columns[d.fields[i]].name, Json("old", AsString(oldrow[i]))("new", AsString(newrow[i])));
+            }
+            line.CatRaw("changes", changes);
+        } else {
+            line.CatRaw("data", object(d.newdata ? after : before, d.newdata ? d.newdata : d.olddata, all));
+        }
+        out << line.ToString() << "\n";
+        return !out.IsError();
+    });
+
+    if (!ok) {
+        Cerr() << Nvl(diff.GetError(), String("The differences could not be written")) << "\n";
+        SetExitCode(1);
+        return;
+    }
+    if (file.IsOpen()) {
+        Cout() << "Differences: " << diff.GetDifferenceCount() << ", skipped blocks: " << diff.GetSkippedBlocks() << "\n";
+    }
+}
+
+static void sRecover(Vector<String> args) {
+    ParadoxRecovery recovery;
+    if (args.GetCount() > 1 && args[1] == "--duplicates") {
+        recovery.Duplicates();
+        args.Remove(1);
+    }
+
+    if (args.GetCount() != 2 && args.GetCount() != 3) {
+        sUsage(args[0]);
+        return;
+    }
+
+    ParadoxSession px;
+    if (!px.Open(args[1])) {
+        Cerr() << "The DB " << args[1] << " could not be opened\n";
+        SetExitCode(1);
+        return;
+    }
+    // the blobs of deleted records are released, only their size is kept
+    px.LazyBlobs();
+
+    FileOut file;
+    if (args.GetCount() == 3 && !file.Open(args[2])) {
+        Cerr() << "The file " << args[2] << " could not be created\n";
+        SetExitCode(1);
+        return;
+    }
+    Stream &out = file.IsOpen() ? static_cast<Stream &>(file) : Cout();
+
+    if (!recovery.Run(px)) {
+        Cerr() << recovery.GetError() << "\n";
+        SetExitCode(1);
+        return;
+    }
+
+    // CSV with the place of the record in front of the fields, or one JSON object on a line
+    bool csv = args.GetCount() == 3 && ToLower(GetFileExt(args[2])) == ".csv";
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    if (csv) {
+        out << "source;block;slot";
+        for (const SqlColumnInfo &c : columns) {
+            out << ';' << CsvString(c.name);
+        }
+        out << "\r\n";
+    }
+    for (const ParadoxRecoveredRecord &r : recovery.GetRecords()) {
+        const char *source = r.kind == ParadoxRecoveredRecord::DELETED ? "deleted" : "unlinked";
+        Vector<Value> row = px.DecodeRecord(~r.data);
+        if (csv) {
+            out << source << ';' << r.block << ';' << r.slot;
+            for (const Value &v : row) {
+                out << ';' << ParadoxSortedExport::CsvFormat(v);
+            }
+            out << "\r\n";
+        } else {
+            Json data;
+            for (int i = 0; i < row.GetCount(); ++i) {
+                data(columns[i].name, AsString(row[i]));
+            }
+            out << Json("source", source)("block", r.block)("slot", r.slot).CatRaw("data", data).ToString() << "\n";
+        }
+    }
+
+    if (out.IsError()) {
+        Cerr() << "The recovered records could not be written\n";
+        SetExitCode(1);
+        return;
+    }
+    if (file.IsOpen()) {
+        Cout() << "Recovered records: " << recovery.GetRecords().GetCount() << ", data blocks: " << recovery.GetBlockCount()
+               << ", unlinked blocks: " << recovery.GetUnlinkedBlocks() << ", rejected slots: "
+               << recovery.GetRejectedSlots() << ", copies of records: " << recovery.GetDuplicateSlots() << "\n";
+    }
+}
+
+static void sVerify(Vector<String> args) {
+    ParadoxVerifier verifier;
+    if (args.GetCount() > 2 && args[1] == "--threads") {
+        verifier.Threads(max(ScanInt(args[2]), 0));
+        args.Remove(1, 2);
+    }
+
+    if (args.GetCount() < 2) {
+        sUsage(args[0]);
+        return;
+    }
+
+    // the tables of a directory are checked in the order of their names
+    Vector<String> tables;
+    for (int i = 1; i < args.GetCount(); ++i) {
+        if (!DirectoryExists(args[i])) {
+            tables.Add(args[i]);
+            continue;
+        }
+        Vector<String> found;
+        for (FindFile ff(AppendFileName(args[i], "*.db")); ff; ff.Next()) {
+            if (ff.IsFile()) {
+                found.Add(ff.GetPath());
+            }
+        }
+        Sort(found);
+        tables.Append(found);
+    }
+
+    // one table after the other, the blocks of each table are checked in parallel
+    int failed = 0;
+    int warned = 0;
+    for (const String &table : tables) {
+        ParadoxSession px;
+        if (!px.Open(table)) {
+            Cout() << table << ": error: The DB could not be opened\n";
+            ++failed;
+            continue;
+        }
+        if (!verifier.Run(px)) {
+            Cout() << table << ": error: " << verifier.GetError() << "\n";
+            ++failed;
+            continue;
+        }
+        Cout() << table << ": " << verifier.GetErrorCount() << " errors, " << verifier.GetWarningCount()
+               << " warnings, data blocks: " << verifier.GetCheckedBlocks() << ", records: "
+               << verifier.GetCheckedRecords() << ", blobs: " << verifier.GetCheckedBlobs() << "\n";
+        Cout() << verifier.GetReport(px);
+        if (verifier.GetErrorCount() > 0) {
+            ++failed;
+        } else if (verifier.GetWarningCount() > 0) {
+            ++warned;
+        }
+    }
+
+    Cout() << "Tables: " << tables.GetCount() << ", with errors: " << failed << ", with warnings only: " << warned
+           << "\n";
+    if (failed > 0) {
+        SetExitCode(1);
+    }
+}
+
+struct CommandMode {
+    const char *name;
+    const char *usage;
+    void (*run)(Vector<String> args);
+};
+
+static const CommandMode sModes[] = {
+    {"--benchmark", "[--memprof] <directory> [<results file>] [<record counts separated by commas>]", sBenchmark},
+    {"--export", "[--sort <fields separated by commas, - for descending>] [--memory <MB>] <table> <output file .csv or .json>", sExport},
+    {"--delta-export", "[--changes] [--cache <file>] <table> <output file .csv, .json or .ndjson>", sDeltaExport},
+    {"--diff", "[--position] <old table> <new table> [<output file .ndjson>]", sDiff},
+    {"--recover", "[--duplicates] <table> [<output file .csv or .ndjson>]", sRecover},
+    {"--verify", "[--threads <n>] <tables or directories>", sVerify},
+};
+
+static void sUsage(const String &mode) {
+    for (const CommandMode &m : sModes) {
+        if (mode == m.name) {
+            Cerr() << "Usage: " << GetExeTitle() << " " << m.name << " " << m.usage << "\n";
+        }
+    }
+    SetExitCode(1);
+}
+
+bool ParadoxCommand::IsMode(const Vector<String> &args) {
+    for (const CommandMode &m : sModes) {
+        if (!args.IsEmpty() && args[0] == m.name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParadoxCommand::Run(const Vector<String> &args) {
+    for (const CommandMode &m : sModes) {
+        if (!args.IsEmpty() && args[0] == m.name) {
+            m.run(clone(args));
+            return true;
+        }
+    }
+    return false;
+}
+
+String ParadoxCommand::GetUsage() {
+    String usage;
+    for (const CommandMode &m : sModes) {
+        usage << GetExeTitle() << " " << m.name << " " << m.usage << "\n";
+    }
+    return usage;
+}
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,24 @@
+#ifndef PxCommand_h_
+#define PxCommand_h_
+
+#include "PxSession.h"
+
+namespace Upp {
+
+// Modes of the command line of PxView and PxViewCli, the first argument
+// selects the mode. The output goes to the standard output and the errors to
+// the error output, the exit code is 1 when a mode failed.
+class ParadoxCommand {
+  public:
+    static bool IsMode(const Vector<String> &args);
+    // Runs the mode selected by the first argument, returns false when the
+    // arguments do not select a mode
+    static bool Run(const Vector<String> &args);
+    // One line with the arguments of each mode
+    static String GetUsage();
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,284 @@
+#include "PxDiff.h"
+#include "PxExport.h"
+
+using namespace Upp;
+
+bool ParadoxDiff::Cursor::Start(ParadoxSession &session) {
+    px = &session;
+    recordsize = px->GetRecordSize();
+    data.Alloc(px->GetBlockSize());
+    block = -1;
+    error = false;
+    return NextBlock() || !error;
+}
+
+bool ParadoxDiff::Cursor::NextBlock() {
+    // empty data blocks are passed over
+    slot = 0;
+    count = 0;
+    while (++block < px->GetBlockCount()) {
+        count = px->ReadBlock(block, ~data);
+        if (count < 0) {
+            count = 0;
+            error = true;
+            return false;
+        }
+        if (count > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParadoxDiff::Cursor::Next() {
+    return ++slot < count || NextBlock();
+}
+
+bool ParadoxDiff::Report(int kind, int oldrecord, const char *olddata, int newrecord, const char *newdata) {
+    ParadoxDifference d;
+    d.kind = kind;
+    d.oldrecord = oldrecord;
+    d.olddata = olddata;
+    d.newrecord = newrecord;
+    d.newdata = newdata;
+    ++differences;
+    return report(d);
+}
+
+bool ParadoxDiff::Compare(int oldrecord, const char *olddata, int newrecord, const char *newdata) {
+    if (memcmp(olddata, newdata, recordsize) == 0) {
+        return true;
+    }
+
+    ParadoxDifference d;
+    d.kind = ParadoxDifference::CHANGED;
+    d.oldrecord = oldrecord;
+    d.olddata = olddata;
+    d.newrecord = newrecord;
+    d.newdata = newdata;
+    for (int i = 0; i < fieldoffset.GetCount(); ++i) {
+        if (memcmp(olddata + fieldoffset[i], newdata + fieldoffset[i], fieldlength[i]) != 0) { // NOLINT: C code
+            d.fields.Add(i);
+        }
+    }
+    ++differences;
+    return report(d);
+}
+
+bool ParadoxDiff::RunByPosition(ParadoxSession &before, ParadoxSession &after) {
+    Cursor a;
+    Cursor b;
+    a.Start(before);
+    b.Start(after);
+
+    bool ok = true;
+    while (ok && !a.error && !b.error && (!a.IsEnd() || !b.IsEnd())) {
+        // the records of blocks with the same checksum at the same place are the same
+        if (!a.IsEnd() && !b.IsEnd() && a.slot == 0 && b.slot == 0 &&
+            before.GetBlockHash(a.block) == after.GetBlockHash(b.block)) {
+            ++skipped;
+            a.NextBlock();
+            b.NextBlock();
+            continue;
+        }
+
+        if (a.IsEnd()) {
+            ok = Report(ParadoxDifference::ADDED, -1, nullptr, b.GetRecord(), b.Get());
+            b.Next();
+        } else if (b.IsEnd()) {
+            ok = Report(ParadoxDifference::REMOVED, a.GetRecord(), a.Get(), -1, nullptr);
+            a.Next();
+        } else {
+            ok = Compare(a.GetRecord(), a.Get(), b.GetRecord(), b.Get());
+            a.Next();
+            b.Next();
+        }
+    }
+
+    if (a.error || b.error) {
+        error = t_("The records could not be read");
+        return false;
+    }
+    return ok;
+}
+
+bool ParadoxDiff::ComparePartition(const String &olds, const String &news) {
+    // an entry is the number of the record followed by its data
+    int entrysize = 4 + recordsize; // NOLINT: record number
+    int oldcount = olds.GetCount() / entrysize;
+    int newcount = news.GetCount() / entrysize;
+
+    Index<String> keys;
+    for (int i = 0; i < oldcount; ++i) {
+        keys.Add(String(~olds + i * entrysize + 4, keysize)); // NOLINT: C code
+    }
+    Vector<bool> matched;
+    matched.SetCount(oldcount, false);
+
+    for (int j = 0; j < newcount; ++j) {
+        const char *entry = ~news + j * entrysize; // NOLINT: C code
+        int i = keys.Find(String(entry + 4, keysize)); // NOLINT: C code
+        while (i >= 0 && matched[i]) {
+            i = keys.FindNext(i);
+        }
+        bool ok = true;
+        if (i < 0) {
+            ok = Report(ParadoxDifference::ADDED, -1, nullptr, Peek32le(entry), entry + 4); // NOLINT: C code
+        } else {
+            matched[i] = true;
+            const char *old = ~olds + i * entrysize; // NOLINT: C code
+            ok = Compare(Peek32le(old), old + 4, Peek32le(entry), entry + 4); // NOLINT: C code
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < oldcount; ++i) {
+        const char *old = ~olds + i * entrysize; // NOLINT: C code
+        if (!matched[i] && !Report(ParadoxDifference::REMOVED, Peek32le(old), old + 4, -1, nullptr)) { // NOLINT: C code
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParadoxDiff::RunByKey(ParadoxSession &before, ParadoxSession &after) {
+    // the data blocks are compared by their checksums first, only the blocks
+    // which differ are matched by the keys of their records
+    Vector<int> oldblocks;
+    Vector<int> newblocks;
+    int64 size = 0;
+    {
+        Buffer<char> data(max(before.GetBlockSize(), after.GetBlockSize()));
+        for (int block = 0; block < max(before.GetBlockCount(), after.GetBlockCount()); ++block) {
+            int oldcount = block < before.GetBlockCount() ? before.ReadBlock(block, ~data) : 0;
+            int newcount = block < after.GetBlockCount() ? after.ReadBlock(block, ~data) : 0;
+            if (oldcount < 0 || newcount < 0) {
+                error = Format(t_("The data block %d could not be read"), block);
+                return false;
+            }
+            if (block < before.GetBlockCount() && block < after.GetBlockCount() &&
+                before.GetBlockHash(block) == after.GetBlockHash(block)) {
+                ++skipped;
+                continue;
+            }
+            if (oldcount > 0) {
+                oldblocks.Add(block);
+            }
+            if (newcount > 0) {
+                newblocks.Add(block);
+            }
+            size += int64(oldcount + newcount) * (4 + recordsize); // NOLINT: record number
+        }
+    }
+
+    // the records are split by the hash of their key to parts which fit in the memory
+    int parts = int(clamp<int64>((size + memorylimit - 1) / max<int64>(memorylimit, 1), 1, 256)); // NOLINT: open files
+    Vector<String> paths;
+    Array<FileOut> files;
+    StringBuffer memory[2];
+    if (parts > 1) {
+        for (int i = 0; i < 2 * parts; ++i) {
+            paths.Add(ParadoxSortedExport::MakeTempFile("pxdiff", tempdir));
+            if (!files.Add().Open(paths.Top())) {
+                error = Format(t_("The file %s could not be created"), paths.Top());
+                for (const String &path : paths) {
+                    DeleteFile(path);
+                }
+                return false;
+            }
+        }
+    }
+
+    // old records go to the even parts, the new ones to the odd parts
+    auto split = [&](ParadoxSession &px, const Vector<int> &blocks, int side) {
+        Buffer<char> data(px.GetBlockSize());
+        char number[4];
+        for (int block : blocks) {
+            int count = px.ReadBlock(block, ~data);
+            if (count < 0) {
+                error = Format(t_("The data block %d could not be read"), block);
+                return false;
+            }
+            for (int i = 0; i < count; ++i) {
+                const char *rec = ~data + i * recordsize; // NOLINT: C code
+                Poke32le(number, px.GetBlockStart(block) + i);
+                if (parts == 1) {
+                    memory[side].Cat(number, 4);
+                    memory[side].Cat(rec, recordsize);
+                } else {
+                    // the parts must not depend on the hash of Index
+                    Stream &out = files[2 * int(ParadoxSession::Hash(rec, keysize) % parts) + side];
+                    out.Put(number, 4);
+                    out.Put(rec, recordsize);
+                }
+            }
+        }
+        return true;
+    };
+
+    bool ok = split(before, oldblocks, 0) && split(after, newblocks, 1);
+    if (parts == 1) {
+        ok = ok && ComparePartition(String(memory[0]), String(memory[1]));
+    } else {
+        for (FileOut &out : files) {
+            out.Close();
+            if (ok && out.IsError()) {
+                error = t_("The temporary files could not be written");
+                ok = false;
+            }
+        }
+        for (int i = 0; ok && i < parts; ++i) {
+            ok = ComparePartition(LoadFile(paths[2 * i]), LoadFile(paths[2 * i + 1]));
+        }
+        for (const String &path : paths) {
+            DeleteFile(path);
+        }
+    }
+    return ok;
+}
+
+bool ParadoxDiff::Run(ParadoxSession &before, ParadoxSession &after, Function<bool(const ParadoxDifference &)> difference) {
+    error.Clear();
+    skipped = 0;
+    differences = 0;
+    report = difference;
+
+    if (!before.IsOpen() || !after.IsOpen()) {
+        error = t_("The DB is not open");
+        return false;
+    }
+
+    // the records are compared by their raw data, so the fields must be the same
+    Vector<SqlColumnInfo> oldcolumns = before.EnumColumns(Null, Null);
+    Vector<SqlColumnInfo> newcolumns = after.EnumColumns(Null, Null);
+    bool same = oldcolumns.GetCount() == newcolumns.GetCount() && before.GetRecordSize() == after.GetRecordSize();
+    for (int i = 0; same && i < newcolumns.GetCount(); ++i) {
+        same = ToUpper(oldcolumns[i].name) == ToUpper(newcolumns[i].name) &&
+               before.GetFieldType(i) == after.GetFieldType(i) && oldcolumns[i].width == newcolumns[i].width;
+    }
+    if (!same) {
+        error = t_("The tables have different fields");
+        return false;
+    }
+
+    recordsize = after.GetRecordSize();
+    fieldoffset.Clear();
+    fieldlength.Clear();
+    for (int i = 0; i < newcolumns.GetCount(); ++i) {
+        fieldoffset.Add(after.GetFieldOffset(i));
+        fieldlength.Add(newcolumns[i].width);
+    }
+
+    // the key fields are the first fields of the record
+    keyfields = byposition ? 0 : clamp(after.GetPrimaryKeyField(), 0, newcolumns.GetCount());
+    keysize = keyfields < newcolumns.GetCount() ? fieldoffset[keyfields] : recordsize;
+
+    int64 start = usecs();
+    bool ok = keyfields > 0 ? RunByKey(before, after) : RunByPosition(before, after);
+    after.AddTime(ParadoxSession::PhaseExport, usecs(start));
+    return ok;
+}
+
+// vim: ts=4 sw=4 expandtab
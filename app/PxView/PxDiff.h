@@ -0,0 +1,112 @@
+#ifndef PxDiff_h_
+#define PxDiff_h_
+
+#include "PxSession.h"
+
+namespace Upp {
+
+// One record which differs between the old and the new table
+struct ParadoxDifference {
+    enum { ADDED, REMOVED, CHANGED };
+
+    int kind = CHANGED;
+    int oldrecord = -1; // -1 for an added record
+    int newrecord = -1; // -1 for a removed record
+    const char *olddata = nullptr;
+    const char *newdata = nullptr;
+    Vector<int> fields; // changed fields
+};
+
+// Compares two versions of a table with the same fields. The records are
+// matched by the key fields of the new table, or by their position when it
+// has none. The data blocks at the same place with the same checksum are
+// skipped without comparing their records. The records of the other blocks
+// are matched by a hash of their key, in one pass when they fit in the memory
+// limit, otherwise they are split by the hash to temporary files first.
+class ParadoxDiff {
+  public:
+    // Records are matched by position even when the table has a key
+    ParadoxDiff &ByPosition(bool b = true) {
+        byposition = b;
+        return *this;
+    }
+    // Memory of the records of the changed blocks in bytes
+    ParadoxDiff &MemoryLimit(int64 bytes) {
+        memorylimit = bytes;
+        return *this;
+    }
+    // Directory of the temporary files, the system one by default
+    ParadoxDiff &TempDirectory(const String &dir) {
+        tempdir = dir;
+        return *this;
+    }
+
+    // The differences of the records matched by position are passed in their
+    // order. The records matched by key are passed in the order of the new
+    // records followed by the removed ones, for each part of the records
+    // split by the memory limit. Difference returns false to stop.
+    bool Run(ParadoxSession &before, ParadoxSession &after, Function<bool(const ParadoxDifference &)> difference);
+
+    String GetError() const {
+        return error;
+    }
+    int GetKeyFields() const {
+        return keyfields;
+    }
+    // Number of the data blocks skipped by their checksum
+    int GetSkippedBlocks() const {
+        return skipped;
+    }
+    int GetDifferenceCount() const {
+        return differences;
+    }
+
+  private:
+    // Records of one table read in the order of the data blocks
+    struct Cursor {
+        ParadoxSession *px = nullptr;
+        Buffer<char> data;
+        int recordsize = 0;
+        int block = -1;
+        int count = 0; // records in the block
+        int slot = 0;
+        bool error = false;
+
+        bool Start(ParadoxSession &session);
+        bool Next();
+        bool NextBlock();
+        bool IsEnd() const {
+            return slot >= count;
+        }
+        const char *Get() const {
+            return ~data + slot * recordsize; // NOLINT: C code
+        }
+        int GetRecord() const {
+            return px->GetBlockStart(block) + slot;
+        }
+    };
+
+    bool byposition = false;
+    int64 memorylimit = 256 << 20; // NOLINT: 256 MB
+    String tempdir;
+    String error;
+    int keyfields = 0;
+    int keysize = 0;
+    int recordsize = 0;
+    int skipped = 0;
+    int differences = 0;
+    Vector<int> fieldoffset;
+    Vector<int> fieldlength;
+    Function<bool(const ParadoxDifference &)> report;
+
+    bool Compare(int oldrecord, const char *olddata, int newrecord, const char *newdata);
+    bool Report(int kind, int oldrecord, const char *olddata, int newrecord, const char *newdata);
+    bool RunByPosition(ParadoxSession &before, ParadoxSession &after);
+    bool RunByKey(ParadoxSession &before, ParadoxSession &after);
+    bool ComparePartition(const String &olds, const String &news);
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,470 @@
+#include "PxExport.h"
+
+using namespace Upp;
+
+// CSV line without its end or JSON object of one record
+static String sFormatRecord(const Vector<Value> &row, const Vector<SqlColumnInfo> &columns, bool json, const String &sep) {
+    String text;
+    if (json) {
+        Json obj;
+        for (int i = 0; i < row.GetCount() && i < columns.GetCount(); ++i) {
+            obj(columns[i].name, AsString(row[i]));
+        }
+        text = obj.ToString();
+    } else {
+        for (int i = 0; i < row.GetCount(); ++i) {
+            text << (i > 0 ? sep : String()) << ParadoxSortedExport::CsvFormat(row[i]);
+        }
+    }
+    return text;
+}
+
+static String sCsvHeader(const Vector<SqlColumnInfo> &columns, const String &sep) {
+    String text;
+    for (int i = 0; i < columns.GetCount(); ++i) {
+        text << (i > 0 ? sep : String()) << CsvString(columns[i].name);
+    }
+    return text;
+}
+
+String ParadoxSortedExport::CsvFormat(const Value &v) {
+    return (IsNumber(v) || IsVoid(v)) ? AsString(v) : CsvString(AsString(v));
+}
+
+String ParadoxSortedExport::MakeTempFile(const char *prefix, const String &dir) {
+    String path = GetTempFileName(prefix);
+    if (!IsNull(dir)) {
+        path = AppendFileName(dir, GetFileName(path));
+    }
+    return path;
+}
+
+String ParadoxSortedExport::NewTempFile() {
+    String path = MakeTempFile("pxsort", tempdir);
+    temps.Add(path);
+    return path;
+}
+
+void ParadoxSortedExport::RemoveTemps() {
+    for (const String &path : temps) {
+        DeleteFile(path);
+    }
+    temps.Clear();
+}
+
+void ParadoxSortedExport::MakeKey(int record, const char *data, char *key) const {
+    for (const SortField &f : sortfields) {
+        memcpy(key, data + f.offset, f.width); // NOLINT: C code
+        if (f.descending) {
+            for (int i = 0; i < f.width; ++i) {
+                key[i] = char(~key[i]); // NOLINT: C code
+            }
+        }
+        key += f.width; // NOLINT: C code
+    }
+
+    // the number of the record keeps the order of the equal keys
+    key[0] = char(record >> 24); // NOLINT: big-endian
+    key[1] = char(record >> 16); // NOLINT: big-endian
+    key[2] = char(record >> 8);  // NOLINT: big-endian
+    key[3] = char(record);       // NOLINT: big-endian
+}
+
+bool ParadoxSortedExport::WriteRun(const char *entries, const Vector<int> &order, Vector<String> &runs) {
+    String path = NewTempFile();
+    FileOut out;
+    if (!out.Open(path)) {
+        error = Format(t_("The file %s could not be created"), path);
+        return false;
+    }
+    for (int i : order) {
+        out.Put(entries + int64(i) * entrysize, entrysize); // NOLINT: C code
+    }
+    out.Close();
+    if (out.IsError()) {
+        error = Format(t_("The file %s could not be written"), path);
+        return false;
+    }
+    runs.Add(path);
+    ++runcount;
+    return true;
+}
+
+bool ParadoxSortedExport::Merge(const Vector<String> &runs, Event<const char *> entry) {
+    // the heap holds the runs ordered by the key of their first entry
+    int n = runs.GetCount();
+    Array<FileIn> in;
+    Buffer<char> heads(n * entrysize);
+    Vector<int> heap;
+    auto head = [&](int k) { return ~heads + k * entrysize; }; // NOLINT: C code
+    auto less = [&](int a, int b) { return memcmp(head(a), head(b), keysize) < 0; };
+    auto sift = [&](int i) {
+        for (;;) {
+            int c = 2 * i + 1;
+            if (c >= heap.GetCount()) {
+                break;
+            }
+            if (c + 1 < heap.GetCount() && less(heap[c + 1], heap[c])) {
+                ++c;
+            }
+            if (!less(heap[c], heap[i])) {
+                break;
+            }
+            Swap(heap[c], heap[i]);
+            i = c;
+        }
+    };
+
+    for (int k = 0; k < n; ++k) {
+        FileIn &f = in.Add();
+        if (!f.Open(runs[k])) {
+            error = Format(t_("The file %s could not be opened"), runs[k]);
+            return false;
+        }
+        if (f.GetAll(head(k), entrysize)) {
+            heap.Add(k);
+        }
+    }
+    for (int i = heap.GetCount() / 2 - 1; i >= 0; --i) {
+        sift(i);
+    }
+
+    while (!heap.IsEmpty()) {
+        int k = heap[0];
+        entry(head(k));
+        if (!in[k].GetAll(head(k), entrysize)) {
+            heap[0] = heap.Top();
+            heap.Drop();
+        }
+        sift(0);
+    }
+
+    for (int k = 0; k < n; ++k) {
+        if (in[k].IsError()) {
+            error = Format(t_("The file %s could not be read"), runs[k]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int ParadoxSortedExport::Export(ParadoxSession &px, Stream &out, byte charset) {
+    error.Clear();
+    runcount = 0;
+
+    if (!px.IsOpen()) {
+        error = t_("The DB is not open");
+        return -1;
+    }
+
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    keysize = 4; // NOLINT: record number
+    for (SortField &f : sortfields) {
+        if (f.field < 0 || f.field >= columns.GetCount() || px.IsBlobField(f.field)) {
+            error = Format(t_("The field %d cannot be sorted"), f.field);
+            return -1;
+        }
+        f.offset = px.GetFieldOffset(f.field);
+        f.width = columns[f.field].width;
+        keysize += f.width;
+    }
+    Vector<int> outfields;
+    Vector<SqlColumnInfo> outcolumns;
+    for (int i = 0; i < (fields.IsEmpty() ? columns.GetCount() : fields.GetCount()); ++i) {
+        int field = fields.IsEmpty() ? i : fields[i];
+        if (field < 0 || field >= columns.GetCount()) {
+            error = Format(t_("The field %d does not exist"), field);
+            return -1;
+        }
+        outfields.Add(field);
+        outcolumns.Add(columns[field]);
+    }
+    int recsize = px.GetRecordSize();
+    entrysize = keysize + recsize;
+
+    // the blobs are exported with their data, not with their size
+    bool lazyblobs = px.IsLazyBlobs();
+    px.LazyBlobs(false);
+
+    int64 start = usecs();
+    int count = 0;
+    String sep(separator, 1);
+    if (output == CSV) {
+        out << sCsvHeader(outcolumns, sep) << "\r\n";
+    } else {
+        out << "[";
+    }
+    auto write = [&](const char *data) {
+        String text = sFormatRecord(px.DecodeRecord(data, outfields, charset), outcolumns, output == JSON, sep);
+        if (output == CSV) {
+            out << text << "\r\n";
+        } else {
+            out << (count > 0 ? "," : "") << text;
+        }
+        ++count;
+    };
+
+    // the runs are sorted in memory, only the records which do not fit are written
+    int64 capacity = memorylimit / (entrysize + int64(sizeof(int)));
+    capacity = clamp<int64>(capacity, 1, min<int64>(max(px.GetNumRecords(), 0) + 1, INT_MAX / entrysize));
+    Buffer<char> entries(int(capacity) * entrysize);
+    Vector<int> order;
+    Vector<String> runs;
+    bool ok = true;
+    auto sort = [&] {
+        Sort(order, [&](int a, int b) {
+            return memcmp(~entries + a * entrysize, ~entries + b * entrysize, keysize) < 0; // NOLINT: C code
+        });
+    };
+
+    auto add = [&](int record, const char *data) {
+        char *entry = ~entries + order.GetCount() * entrysize; // NOLINT: C code
+        MakeKey(record, data, entry);
+        memcpy(entry + keysize, data, recsize); // NOLINT: C code
+        order.Add(order.GetCount());
+        if (order.GetCount() == capacity) {
+            sort();
+            ok = WriteRun(~entries, order, runs);
+            order.Clear();
+        }
+        return ok;
+    };
+    bool scanned = filter ? px.Scan(*filter, add) : px.Scan(add);
+    if (ok && !scanned) {
+        error = t_("The records could not be read");
+        ok = false;
+    }
+
+    if (ok && runs.IsEmpty()) {
+        sort();
+        for (int i : order) {
+            write(~entries + i * entrysize + keysize); // NOLINT: C code
+        }
+    } else if (ok) {
+        if (!order.IsEmpty()) {
+            sort();
+            ok = WriteRun(~entries, order, runs);
+        }
+        entries.Clear();
+
+        // too many runs are merged to longer ones first, so the open files are limited
+        while (ok && runs.GetCount() > MergeWidth) {
+            Vector<String> part;
+            part.Append(runs, 0, MergeWidth);
+            runs.Remove(0, MergeWidth);
+            String path = NewTempFile();
+            FileOut merged;
+            if (!merged.Open(path)) {
+                error = Format(t_("The file %s could not be created"), path);
+                ok = false;
+                break;
+            }
+            ok = Merge(part, [&](const char *entry) { merged.Put(entry, entrysize); });
+            merged.Close();
+            if (ok && merged.IsError()) {
+                error = Format(t_("The file %s could not be written"), path);
+                ok = false;
+            }
+            for (const String &p : part) {
+                DeleteFile(p);
+            }
+            runs.Add(path);
+        }
+
+        ok = ok && Merge(runs, [&](const char *entry) { write(entry + keysize); }); // NOLINT: C code
+    }
+    RemoveTemps();
+    px.LazyBlobs(lazyblobs);
+
+    if (output == JSON) {
+        out << "]";
+    }
+    px.AddTime(ParadoxSession::PhaseExport, usecs(start));
+
+    if (ok && out.IsError()) {
+        error = t_("The exported data could not be written");
+        ok = false;
+    }
+    return ok ? count : -1;
+}
+
+String ParadoxDeltaExport::GetSignature(ParadoxSession &px, byte charset) const {
+    // the cache is used only for the same fields and the same format of the text
+    String signature = Format("%s:%d:%d:%d", output == CSV ? "csv" : "json", output == CSV ? separator : 0,
+                              px.GetCharset(charset), px.GetRecordSize());
+    for (const SqlColumnInfo &column : px.EnumColumns(Null, Null)) {
+        signature << ":" << column.name << "/" << column.type << "/" << column.width;
+    }
+    return signature;
+}
+
+bool ParadoxDeltaExport::ReadSegment(Stream &in, Segment &s) {
+    if (in.IsEof()) {
+        return false;
+    }
+    s.hash = in.Get64le();
+    s.count = in.Get32le();
+    int length = in.Get32le();
+    if (in.IsError() || s.count < 0 || length < 0) {
+        return false;
+    }
+    s.text = in.Get(length);
+    return s.text.GetCount() == length;
+}
+
+void ParadoxDeltaExport::WriteSegment(Stream &out, const Segment &s) {
+    out.Put64le(s.hash);
+    out.Put32le(s.count);
+    out.Put32le(s.text.GetCount());
+    out.Put(s.text);
+}
+
+void ParadoxDeltaExport::WriteChange(Stream &out, const char *op, int block, int record, const String &data) {
+    out << Json("op", op)("block", block)("record", record).CatRaw("data", data).ToString() << "\n";
+}
+
+int ParadoxDeltaExport::Export(ParadoxSession &px, Stream &out, byte charset) {
+    static const char magic[] = "PXDELTA1";
+
+    error.Clear();
+    decoded = 0;
+    cached = 0;
+
+    if (!px.IsOpen()) {
+        error = t_("The DB is not open");
+        return -1;
+    }
+
+    // the cache of a different table or text format is not used
+    String signature = GetSignature(px, charset);
+    FileIn in;
+    bool old = !IsNull(cachepath) && FileExists(cachepath) && in.Open(cachepath) &&
+               in.Get(int(sizeof(magic)) - 1) == magic && in.Get32le() == signature.GetCount() &&
+               in.Get(signature.GetCount()) == signature && !in.IsError();
+
+    // the new cache replaces the old one when the export is complete
+    String temppath = cachepath + ".tmp";
+    FileOut cache;
+    if (!IsNull(cachepath)) {
+        if (!cache.Open(temppath)) {
+            error = Format(t_("The file %s could not be created"), temppath);
+            return -1;
+        }
+        cache.Put(magic, int(sizeof(magic)) - 1);
+        cache.Put32le(signature.GetCount());
+        cache.Put(signature);
+    }
+
+    int64 start = usecs();
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    String sep(separator, 1);
+    bool json = output != CSV;
+    if (output == CSV) {
+        out << sCsvHeader(columns, sep) << "\r\n";
+    } else if (output == JSON) {
+        out << "[";
+    }
+
+    int count = 0;
+    int record = 0;    // first record of the block
+    int oldrecord = 0; // first record of the block at the same place in the previous export
+    int recsize = px.GetRecordSize();
+    Buffer<char> data(px.GetBlockSize());
+    Segment prev;
+    bool ok = true;
+    for (int block = 0; block < px.GetBlockCount(); ++block) {
+        Segment s;
+        s.count = px.ReadBlock(block, ~data);
+        if (s.count < 0) {
+            error = Format(t_("The data block %d could not be read"), block);
+            ok = false;
+            break;
+        }
+        s.hash = px.GetBlockHash(block);
+
+        old = old && ReadSegment(in, prev);
+        if (old && prev.hash == s.hash) {
+            s.text = pick(prev.text);
+            ++cached;
+        } else {
+            for (int i = 0; i < s.count; ++i) {
+                Vector<Value> row = px.DecodeRecord(~data + i * recsize, charset); // NOLINT: C code
+                s.text << sFormatRecord(row, columns, json, sep) << (json ? "\n" : "\r\n");
+            }
+            ++decoded;
+
+            // the records of the changed block are compared one by one with the records at their place before
+            if (output == CHANGES) {
+                Vector<String> now = Split(s.text, '\n');
+                Vector<String> before = old ? Split(prev.text, '\n') : Vector<String>();
+                for (int i = 0; i < max(now.GetCount(), before.GetCount()); ++i) {
+                    if (i >= before.GetCount()) {
+                        WriteChange(out, "insert", block, record + i, now[i]);
+                    } else if (i >= now.GetCount()) {
+                        WriteChange(out, "delete", block, oldrecord + i, before[i]);
+                    } else if (now[i] != before[i]) {
+                        WriteChange(out, "update", block, record + i, now[i]);
+                    } else {
+                        continue;
+                    }
+                    ++count;
+                }
+            }
+        }
+
+        if (output == CSV) {
+            out << s.text;
+            count += s.count;
+        } else if (output == JSON) {
+            for (const String &line : Split(s.text, '\n')) {
+                out << (count > 0 ? "," : "") << line;
+                ++count;
+            }
+        }
+        if (cache.IsOpen()) {
+            WriteSegment(cache, s);
+        }
+        record += s.count;
+        oldrecord += old ? prev.count : 0;
+    }
+
+    // records of the blocks which are not in the table any more
+    for (int block = px.GetBlockCount(); ok && output == CHANGES && old && ReadSegment(in, prev); ++block) {
+        Vector<String> before = Split(prev.text, '\n');
+        for (int i = 0; i < before.GetCount(); ++i) {
+            WriteChange(out, "delete", block, oldrecord + i, before[i]);
+            ++count;
+        }
+        oldrecord += prev.count;
+    }
+
+    if (output == JSON) {
+        out << "]";
+    }
+    px.AddTime(ParadoxSession::PhaseExport, usecs(start));
+
+    in.Close();
+    if (cache.IsOpen()) {
+        cache.Close();
+        if (ok && cache.IsError()) {
+            error = Format(t_("The file %s could not be written"), temppath);
+            ok = false;
+        }
+        if (ok) {
+            DeleteFile(cachepath);
+            if (!FileMove(temppath, cachepath)) {
+                error = Format(t_("The file %s could not be created"), cachepath);
+                ok = false;
+            }
+        }
+        DeleteFile(temppath);
+    }
+
+    if (ok && out.IsError()) {
+        error = t_("The exported data could not be written");
+        ok = false;
+    }
+    return ok ? count : -1;
+}
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,166 @@
+#ifndef PxExport_h_
+#define PxExport_h_
+
+#include "PxFilter.h"
+#include "PxSession.h"
+
+namespace Upp {
+
+// Exports a table as CSV or JSON ordered by one or more fields, without
+// keeping the whole table in memory. The records are sorted in runs of
+// limited size, the runs are written to temporary files and merged at the
+// end. The sort key is made of the raw bytes of the fields: pxlib stores the
+// numbers, dates and times big-endian with the sign bit flipped, so the keys
+// are compared bytewise without decoding the records.
+class ParadoxSortedExport {
+  public:
+    enum { CSV, JSON };
+
+    // Fields are sorted in the order of the calls, blob fields cannot be sorted
+    ParadoxSortedExport &SortBy(int field, bool descending = false) {
+        SortField &f = sortfields.Add();
+        f.field = field;
+        f.descending = descending;
+        return *this;
+    }
+    ParadoxSortedExport &Output(int fmt) {
+        output = fmt;
+        return *this;
+    }
+    // Exported fields in their order, all fields when empty
+    ParadoxSortedExport &Fields(const Vector<int> &f) {
+        fields = clone(f);
+        return *this;
+    }
+    // Only the records accepted by the compiled filter are exported
+    ParadoxSortedExport &Filter(const ParadoxFilter &f) {
+        filter = &f;
+        return *this;
+    }
+    // Separator of the CSV columns
+    ParadoxSortedExport &Separator(int c) {
+        separator = c;
+        return *this;
+    }
+    // Memory of one run in bytes
+    ParadoxSortedExport &MemoryLimit(int64 bytes) {
+        memorylimit = bytes;
+        return *this;
+    }
+    // Directory of the temporary files, the system one by default
+    ParadoxSortedExport &TempDirectory(const String &dir) {
+        tempdir = dir;
+        return *this;
+    }
+
+    // Returns the number of exported records or -1 when the export failed
+    int Export(ParadoxSession &px, Stream &out, byte charset = 0);
+
+    String GetError() const {
+        return error;
+    }
+    // Number of the runs written to temporary files by the last export
+    int GetRunCount() const {
+        return runcount;
+    }
+
+    // Text of a value in a CSV column, the numbers are not quoted
+    static String CsvFormat(const Value &v);
+    // Name of a new temporary file, in the directory when it is not Null
+    static String MakeTempFile(const char *prefix, const String &dir);
+
+  private:
+    static constexpr int MergeWidth = 64; // NOLINT: runs merged at once
+
+    struct SortField : Moveable<SortField> {
+        int field = 0;
+        bool descending = false;
+        int offset = 0; // of the field in the record
+        int width = 0;
+    };
+
+    Vector<SortField> sortfields;
+    Vector<int> fields;
+    const ParadoxFilter *filter = nullptr;
+    int output = CSV;
+    int separator = ';';
+    int64 memorylimit = 64 << 20; // NOLINT: 64 MB
+    String tempdir;
+    String error;
+    int runcount = 0;
+
+    int keysize = 0;
+    int entrysize = 0;
+    Vector<String> temps;
+
+    String NewTempFile();
+    void MakeKey(int record, const char *data, char *key) const;
+    bool WriteRun(const char *entries, const Vector<int> &order, Vector<String> &runs);
+    bool Merge(const Vector<String> &runs, Event<const char *> entry);
+    void RemoveTemps();
+};
+
+// Exports a table again using the output of its previous export. The cache
+// file keeps the checksum and the exported text of each data block, only the
+// blocks whose checksum has changed are decoded, the text of the other ones
+// is copied from the cache. The output is the whole table as CSV or JSON, or
+// the changed records only as NDJSON lines.
+class ParadoxDeltaExport {
+  public:
+    enum { CSV, JSON, CHANGES };
+
+    ParadoxDeltaExport &Output(int fmt) {
+        output = fmt;
+        return *this;
+    }
+    // Separator of the CSV columns
+    ParadoxDeltaExport &Separator(int c) {
+        separator = c;
+        return *this;
+    }
+    // File with the data blocks of the previous export, it is created when it does not exist
+    ParadoxDeltaExport &Cache(const String &path) {
+        cachepath = path;
+        return *this;
+    }
+
+    // Returns the number of exported records or changes, -1 when the export failed
+    int Export(ParadoxSession &px, Stream &out, byte charset = 0);
+
+    String GetError() const {
+        return error;
+    }
+    // Number of the data blocks decoded and taken from the cache by the last export
+    int GetDecodedBlocks() const {
+        return decoded;
+    }
+    int GetCachedBlocks() const {
+        return cached;
+    }
+
+  private:
+    // Exported text of the records of one data block, each JSON object is
+    // on its own line
+    struct Segment {
+        uint64 hash = 0;
+        int count = 0;
+        String text;
+    };
+
+    int output = CSV;
+    int separator = ';';
+    String cachepath;
+    String error;
+    int decoded = 0;
+    int cached = 0;
+
+    String GetSignature(ParadoxSession &px, byte charset) const;
+    static bool ReadSegment(Stream &in, Segment &s);
+    static void WriteSegment(Stream &out, const Segment &s);
+    static void WriteChange(Stream &out, const char *op, int block, int record, const String &data);
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
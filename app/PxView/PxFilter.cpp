@@ -0,0 +1,333 @@
+#include "PxFilter.h"
+
+using namespace Upp;
+
+static inline byte sFold(byte c) {
+    return (c >= 'A' && c <= 'Z') ? byte(c + ('a' - 'A')) : c;
+}
+
+// text constants of number, date and time fields must be scanned completely,
+// otherwise they would be encoded as an empty value
+static bool sIsValidConstant(char type, const Value &value) {
+    if (!IsString(value)) {
+        return true;
+    }
+    String text = TrimBoth(AsString(value));
+    const char *end = nullptr;
+    switch (type) {
+    case pxfShort:
+    case pxfLong:
+    case pxfAutoInc:
+        return !IsNull(ScanInt(text, &end)) && *end == '\0';
+    case pxfNumber:
+    case pxfCurrency:
+        return !IsNull(ScanDouble(text, &end)) && *end == '\0';
+    case pxfDate:
+        return !IsNull(ScanDate(text));
+    case pxfTime:
+    case pxfTimestamp:
+        return !IsNull(ScanTime(text));
+    default:
+        return true;
+    }
+}
+
+ParadoxFilter::Term &ParadoxFilter::AddTerm(int field, int op) {
+    Term &t = terms.Add();
+    t.field = field;
+    t.op = op;
+    compiled.Clear();
+    return t;
+}
+
+ParadoxFilter &ParadoxFilter::Equal(int field, const Value &value) {
+    AddTerm(field, EQUAL).low = value;
+    return *this;
+}
+
+ParadoxFilter &ParadoxFilter::Range(int field, const Value &low, const Value &high, bool lowincl, bool highincl) {
+    Term &t = AddTerm(field, RANGE);
+    t.low = low;
+    t.high = high;
+    t.lowincl = lowincl;
+    t.highincl = highincl;
+    return *this;
+}
+
+ParadoxFilter &ParadoxFilter::Prefix(int field, const String &text) {
+    AddTerm(field, PREFIX).low = text;
+    return *this;
+}
+
+ParadoxFilter &ParadoxFilter::Contains(int field, const String &text) {
+    AddTerm(field, CONTAINS).low = text;
+    return *this;
+}
+
+ParadoxFilter &ParadoxFilter::IsNull(int field) {
+    AddTerm(field, ISNULL);
+    return *this;
+}
+
+ParadoxFilter &ParadoxFilter::NotNull(int field) {
+    AddTerm(field, NOTNULL);
+    return *this;
+}
+
+void ParadoxFilter::Clear() {
+    terms.Clear();
+    compiled.Clear();
+    error.Clear();
+    nocase = false;
+}
+
+bool ParadoxFilter::Compile(ParadoxSession &px, byte charset) {
+    compiled.Clear();
+    error.Clear();
+
+    pxdoc_t *pxdoc = px;
+    int numfields = PX_get_num_fields(pxdoc);
+    pxfield_t *fields = PX_get_fields(pxdoc);
+    byte codepage = px.GetCharset(charset);
+
+    for (const Term &t : terms) {
+        if (t.field < 0 || t.field >= numfields) {
+            error = Format(t_("Unknown field number %d"), t.field);
+            compiled.Clear();
+            return false;
+        }
+
+        pxfield_t *pxf = fields + t.field; // NOLINT: C code
+        Predicate &p = compiled.Add();
+        p.field = t.field;
+        p.op = t.op;
+        p.offset = px.GetFieldOffset(t.field);
+        p.length = pxf->px_flen;
+        p.alpha = pxf->px_ftype == pxfAlpha;
+        p.blob = px.IsBlobField(t.field);
+        p.lowincl = t.lowincl;
+        p.highincl = t.highincl;
+
+        if (p.blob && p.op != ISNULL && p.op != NOTNULL) {
+            error = Format(t_("Field '%s' can only be tested for an empty value"), pxf->px_fname);
+            compiled.Clear();
+            return false;
+        }
+
+        if ((t.op == EQUAL || t.op == RANGE) && !p.alpha) {
+            for (const Value *v : {&t.low, &t.high}) {
+                if (!Upp::IsNull(*v) && !sIsValidConstant(pxf->px_ftype, *v)) {
+                    error = Format(t_("Value '%s' is not valid for field '%s'"), AsString(*v), pxf->px_fname);
+                    compiled.Clear();
+                    return false;
+                }
+            }
+        }
+
+        switch (t.op) {
+        case EQUAL:
+            if (Upp::IsNull(t.low)) {
+                p.op = ISNULL;
+            } else {
+                p.low = px.EncodeValue(t.field, p.alpha ? Value(AsString(t.low)) : t.low, charset);
+            }
+            break;
+        case RANGE:
+            if (!Upp::IsNull(t.low)) {
+                p.low = px.EncodeValue(t.field, p.alpha ? Value(AsString(t.low)) : t.low, charset);
+            }
+            if (!Upp::IsNull(t.high)) {
+                p.high = px.EncodeValue(t.field, p.alpha ? Value(AsString(t.high)) : t.high, charset);
+            }
+            break;
+        case PREFIX:
+        case CONTAINS:
+            if (!p.alpha) {
+                error = Format(t_("Field '%s' is not a text field"), pxf->px_fname);
+                compiled.Clear();
+                return false;
+            }
+            p.low = FromUnicode(AsString(t.low).ToWString(), codepage);
+            break;
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool ParadoxFilter::IsNullData(const Predicate &p, const char *data) const {
+    if (p.alpha) {
+        return data[0] == '\0'; // NOLINT: C code
+    }
+
+    if (p.blob) {
+        // size of the blob data is stored behind the pointer to the blob file
+        const int leader = p.length - 10;                 // NOLINT: blob pointer size
+        return leader < 0 || Peek32le(data + leader + 4) == 0; // NOLINT: C code
+    }
+
+    for (int i = 0; i < p.length; ++i) {
+        if (data[i] != '\0') { // NOLINT: C code
+            return false;
+        }
+    }
+    return true;
+}
+
+int ParadoxFilter::Compare(const Predicate &p, const char *data, const String &value) const {
+    if (!(p.alpha && nocase)) {
+        return memcmp(data, value, p.length);
+    }
+
+    const auto *a = reinterpret_cast<const byte *>(data);  // NOLINT: raw data
+    const auto *b = reinterpret_cast<const byte *>(~value); // NOLINT: raw data
+    for (int i = 0; i < p.length; ++i) {
+        int c = int(sFold(a[i])) - int(sFold(b[i])); // NOLINT: C code
+        if (c != 0) {
+            return c;
+        }
+    }
+    return 0;
+}
+
+bool ParadoxFilter::Find(const Predicate &p, const char *data, bool prefix) const {
+    const auto *text = reinterpret_cast<const byte *>(~p.low); // NOLINT: raw data
+    const auto *field = reinterpret_cast<const byte *>(data);  // NOLINT: raw data
+    int textlen = p.low.GetCount();
+
+    int fieldlen = 0;
+    while (fieldlen < p.length && field[fieldlen] != 0) { // NOLINT: C code
+        ++fieldlen;
+    }
+
+    int last = prefix ? 0 : fieldlen - textlen;
+    for (int pos = 0; pos <= last; ++pos) {
+        int i = 0;
+        while (i < textlen && pos + i < fieldlen) {
+            byte a = field[pos + i]; // NOLINT: C code
+            byte b = text[i];        // NOLINT: C code
+            if (nocase ? sFold(a) != sFold(b) : a != b) {
+                break;
+            }
+            ++i;
+        }
+        if (i == textlen) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParadoxFilter::Match(const char *record) const {
+    for (const Predicate &p : compiled) {
+        const char *data = record + p.offset; // NOLINT: C code
+        bool null = IsNullData(p, data);
+
+        switch (p.op) {
+        case ISNULL:
+            if (!null) {
+                return false;
+            }
+            break;
+        case NOTNULL:
+            if (null) {
+                return false;
+            }
+            break;
+        case EQUAL:
+            if (null || Compare(p, data, p.low) != 0) {
+                return false;
+            }
+            break;
+        case RANGE: {
+            if (null) {
+                return false;
+            }
+            if (!p.low.IsEmpty()) {
+                int c = Compare(p, data, p.low);
+                if (c < 0 || (c == 0 && !p.lowincl)) {
+                    return false;
+                }
+            }
+            if (!p.high.IsEmpty()) {
+                int c = Compare(p, data, p.high);
+                if (c > 0 || (c == 0 && !p.highincl)) {
+                    return false;
+                }
+            }
+            break;
+        }
+        case PREFIX:
+        case CONTAINS:
+            if (null || !Find(p, data, p.op == PREFIX)) {
+                return false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool ParadoxFilter::MatchZone(const ParadoxBlockZone &zone) const {
+    for (const Predicate &p : compiled) {
+        byte flags = zone.flags[p.field];
+        if (p.op == ISNULL) {
+            if (!(flags & ParadoxBlockZone::NULLS)) {
+                return false;
+            }
+            continue;
+        }
+        // all other predicates need a value
+        if (!(flags & ParadoxBlockZone::VALUES)) {
+            return false;
+        }
+
+        // the zone is ordered bytewise, which is not the order of the folded case
+        if (p.blob || (p.alpha && nocase)) {
+            continue;
+        }
+        const char *minimum = ~zone.minimum + p.offset; // NOLINT: C code
+        const char *maximum = ~zone.maximum + p.offset; // NOLINT: C code
+
+        switch (p.op) {
+        case EQUAL:
+            if (Compare(p, maximum, p.low) < 0 || Compare(p, minimum, p.low) > 0) {
+                return false;
+            }
+            break;
+        case RANGE: {
+            if (!p.low.IsEmpty()) {
+                int c = Compare(p, maximum, p.low);
+                if (c < 0 || (c == 0 && !p.lowincl)) {
+                    return false;
+                }
+            }
+            if (!p.high.IsEmpty()) {
+                int c = Compare(p, minimum, p.high);
+                if (c > 0 || (c == 0 && !p.highincl)) {
+                    return false;
+                }
+            }
+            break;
+        }
+        case PREFIX: {
+            int n = min(p.low.GetCount(), p.length);
+            if (memcmp(maximum, p.low, n) < 0 || memcmp(minimum, p.low, n) > 0) {
+                return false;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+// vim: ts=4 sw=4 expandtab
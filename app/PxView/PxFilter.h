@@ -0,0 +1,89 @@
+#ifndef PxFilter_h_
+#define PxFilter_h_
+
+#include "PxSession.h"
+
+namespace Upp {
+
+// Record filter evaluated on the encoded record data. Paradox stores numbers
+// big-endian with a flipped sign bit (negative values inverted), so the raw
+// bytes of two values of one field compare the same way as the values and
+// rejected records never have to be decoded.
+class ParadoxFilter {
+  public:
+    enum Operation {
+        EQUAL,
+        RANGE,
+        PREFIX,
+        CONTAINS,
+        ISNULL,
+        NOTNULL
+    };
+
+    ParadoxFilter &Equal(int field, const Value &value);
+    // Null bound means an open interval on that side
+    ParadoxFilter &Range(int field, const Value &low, const Value &high, bool lowincl = true, bool highincl = true);
+    ParadoxFilter &Prefix(int field, const String &text);
+    ParadoxFilter &Contains(int field, const String &text);
+    ParadoxFilter &IsNull(int field);
+    ParadoxFilter &NotNull(int field);
+    // ASCII case folding of alpha fields
+    ParadoxFilter &NoCase(bool b = true) {
+        nocase = b;
+        return *this;
+    }
+
+    bool Compile(ParadoxSession &px, byte charset = 0);
+    bool Match(const char *record) const;
+    // False when no record of the data block can match
+    bool MatchZone(const ParadoxBlockZone &zone) const;
+
+    bool IsEmpty() const {
+        return terms.IsEmpty();
+    }
+    int GetCount() const {
+        return terms.GetCount();
+    }
+    String GetError() const {
+        return error;
+    }
+    void Clear();
+
+  private:
+    struct Term : Moveable<Term> {
+        int field = 0;
+        int op = EQUAL;
+        Value low;
+        Value high;
+        bool lowincl = true;
+        bool highincl = true;
+    };
+
+    struct Predicate : Moveable<Predicate> {
+        int field = 0;
+        int op = EQUAL;
+        int offset = 0;
+        int length = 0;
+        bool alpha = false;
+        bool blob = false;
+        bool lowincl = true;
+        bool highincl = true;
+        String low;
+        String high;
+    };
+
+    Vector<Term> terms;
+    Vector<Predicate> compiled;
+    bool nocase = false;
+    String error;
+
+    Term &AddTerm(int field, int op);
+    bool IsNullData(const Predicate &p, const char *data) const;
+    int Compare(const Predicate &p, const char *data, const String &value) const;
+    bool Find(const Predicate &p, const char *data, bool prefix) const;
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,319 @@
+#include "PxImport.h"
+
+using namespace Upp;
+
+static const int MaxFieldName = 25;
+static const int MaxAlpha = 255;
+static const int BatchBlocks = 16;
+
+// Types allowed by all values of a column, found by the first pass over the source
+struct ColumnGuess : Moveable<ColumnGuess> {
+    bool integer = true;
+    bool number = true;
+    bool date = true;
+    bool time = true;
+    bool logical = true;
+    bool values = false;
+    int length = 0;
+};
+
+static bool sIsNumber(const String &s, bool integer) {
+    const char *end = nullptr;
+    if (integer) {
+        int64 n = ScanInt64(s, &end);
+        return !IsNull(n) && *end == 0 && n >= INT_MIN && n <= INT_MAX;
+    }
+    double d = ScanDouble(s, &end);
+    return !IsNull(d) && *end == 0;
+}
+
+static bool sIsDate(const String &s, bool time) {
+    // letters would allow a lot of texts to be scanned as dates
+    int separators = 0;
+    for (int c : s) {
+        if (IsAlpha(c)) {
+            return false;
+        }
+        separators += c == '.' || c == '-' || c == '/';
+    }
+    if (separators != 2 || (s.Find(':') >= 0) != time) {
+        return false;
+    }
+    return time ? !IsNull(ScanTime(s)) : !IsNull(ScanDate(s));
+}
+
+static void sGuess(ColumnGuess &g, const String &s) {
+    g.values = true;
+    g.length = max(g.length, s.GetCount());
+    g.integer = g.integer && sIsNumber(s, true);
+    g.number = g.number && sIsNumber(s, false);
+    g.date = g.date && sIsDate(s, false);
+    g.time = g.time && sIsDate(s, true);
+    String l = ToLower(s);
+    g.logical = g.logical && (l == "true" || l == "false");
+}
+
+bool ParadoxImporter::OpenSource(FileIn &in, const String &source, Vector<String> &columns) {
+    columns.Clear();
+
+    if (!in.Open(source)) {
+        error = Format(t_("The file %s could not be opened"), source);
+        return false;
+    }
+
+    String ext = ToLower(GetFileExt(source));
+    json = ext == ".ndjson" || ext == ".jsonl" || ext == ".json";
+
+    // UTF-8 BOM is skipped
+    String first = in.GetLine();
+    int start = first.StartsWith("\xEF\xBB\xBF") ? 3 : 0; // NOLINT: BOM size
+    in.Seek(start);
+    if (json) {
+        // columns are added by ReadRow() with the first occurrence of the keys
+        return true;
+    }
+
+    if (separator == 0) {
+        int semicolons = 0;
+        int commas = 0;
+        int tabs = 0;
+        for (int c : first) {
+            semicolons += c == ';';
+            commas += c == ',';
+            tabs += c == '\t';
+        }
+        separator = tabs > max(semicolons, commas) ? '\t' : (commas > semicolons ? ',' : ';');
+    }
+
+    columns = GetCsvLine(in, separator, CHARSET_UTF8);
+    if (columns.IsEmpty()) {
+        error = t_("The file has no header line");
+        return false;
+    }
+    for (String &c : columns) {
+        c = TrimBoth(c);
+    }
+    return true;
+}
+
+bool ParadoxImporter::ReadRow(FileIn &in, Vector<String> &columns, Vector<Value> &row) {
+    row.Clear();
+
+    if (!json) {
+        while (!in.IsEof()) {
+            Vector<String> line = GetCsvLine(in, separator, CHARSET_UTF8);
+            if (line.IsEmpty() || (line.GetCount() == 1 && line[0].IsEmpty())) {
+                continue;
+            }
+            for (const String &s : line) {
+                row.Add(s.IsEmpty() ? Value() : Value(s));
+            }
+            return true;
+        }
+        return false;
+    }
+
+    while (!in.IsEof()) {
+        String line = TrimBoth(in.GetLine());
+        if (line.IsEmpty()) {
+            continue;
+        }
+
+        Value v = ParseJSON(line);
+        if (IsError(v) || !IsValueMap(v)) {
+            error = t_("The file contains a line which is not a JSON object");
+            return false;
+        }
+
+        // every value is kept as a text, nested objects and arrays as JSON
+        ValueMap m = v;
+        for (int i = 0; i < m.GetCount(); ++i) {
+            String key = m.GetKey(i);
+            int q = FindIndex(columns, key);
+            if (q < 0) {
+                q = columns.GetCount();
+                columns.Add(key);
+            }
+            const Value &val = m.GetValue(i);
+            row.At(q) = IsNull(val) ? Value() : IsString(val) ? val : Value(AsJSON(val));
+        }
+        return true;
+    }
+    return false;
+}
+
+Vector<ParadoxField> ParadoxImporter::GuessFields(const String &source) {
+    Vector<ParadoxField> fields;
+
+    FileIn in;
+    Vector<String> columns;
+    if (!OpenSource(in, source, columns)) {
+        return fields;
+    }
+
+    Vector<ColumnGuess> guess;
+    Vector<Value> row;
+    while (ReadRow(in, columns, row)) {
+        for (int i = 0; i < row.GetCount(); ++i) {
+            if (!IsNull(row[i])) {
+                sGuess(guess.At(i), row[i]);
+            }
+        }
+    }
+    if (!error.IsEmpty()) {
+        return fields;
+    }
+
+    // names are limited to the size of the header entry, the repeated ones are skipped
+    Index<String> names;
+    for (int i = 0; i < columns.GetCount(); ++i) {
+        String name = columns[i].Left(MaxFieldName);
+        if (name.IsEmpty() || names.Find(ToLower(name)) >= 0) {
+            continue;
+        }
+        names.Add(ToLower(name));
+
+        const ColumnGuess &g = i < guess.GetCount() ? guess[i] : ColumnGuess();
+        ParadoxField &f = fields.Add();
+        f.name = name;
+        if (!g.values) {
+            f.type = pxfAlpha;
+            f.length = 1;
+        } else if (g.integer) {
+            f.type = pxfLong;
+            f.length = 4; // NOLINT: field size
+        } else if (g.number) {
+            f.type = pxfNumber;
+            f.length = 8; // NOLINT: field size
+        } else if (g.date) {
+            f.type = pxfDate;
+            f.length = 4; // NOLINT: field size
+        } else if (g.time) {
+            f.type = pxfTimestamp;
+            f.length = 8; // NOLINT: field size
+        } else if (g.logical) {
+            f.type = pxfLogical;
+            f.length = 1;
+        } else if (g.length <= MaxAlpha) {
+            f.type = pxfAlpha;
+            f.length = g.length;
+        } else {
+            // 10 bytes of the text are kept in the record with the pointer to the .mb file
+            f.type = pxfMemoBLOb;
+            f.length = 20; // NOLINT: field size
+        }
+    }
+
+    if (fields.IsEmpty()) {
+        error = t_("There are no columns to import");
+    }
+    return fields;
+}
+
+int ParadoxImporter::Import(const String &source, const String &table, Gate<int64, int64> progress) {
+    error.Clear();
+    written = 0;
+
+    ParadoxSession px;
+    if (FileExists(table)) {
+        if (!px.Open(table)) {
+            error = Format(t_("The DB %s could not be opened"), table);
+            return -1;
+        }
+    } else {
+        Vector<ParadoxField> fields = GuessFields(source);
+        if (fields.IsEmpty()) {
+            return -1;
+        }
+        if (!px.Create(table, fields)) {
+            error = Format(t_("The DB %s could not be created"), table);
+            return -1;
+        }
+    }
+
+    if (px.GetFileType() == pxfFileTypIndexDB) {
+        error = t_("Records cannot be appended to a table with a primary index");
+        px.Close();
+        return -1;
+    }
+
+    int recsize = px.GetRecordSize();
+    int recsperblock = (px.GetBlockSize() - 6) / max(recsize, 1); // NOLINT: data block header
+    if (recsperblock < 1) {
+        error = t_("The records do not fit into the data block");
+        px.Close();
+        return -1;
+    }
+
+    FileIn in;
+    Vector<String> columns;
+    if (!OpenSource(in, source, columns)) {
+        px.Close();
+        return -1;
+    }
+
+    // columns are matched to the fields by the name, each field is used once
+    Index<String> names;
+    for (const SqlColumnInfo &c : px.EnumColumns(Null, Null)) {
+        names.Add(ToLower(c.name));
+    }
+    Vector<int> fieldof;
+    Vector<bool> used;
+    used.SetCount(names.GetCount(), false);
+
+    // records are encoded into whole data blocks and appended in batches
+    int capacity = recsperblock * BatchBlocks;
+    Buffer<char> batch(capacity * recsize);
+    int count = 0;
+    bool ok = true;
+    Vector<Value> row;
+    while (ok && ReadRow(in, columns, row)) {
+        while (fieldof.GetCount() < columns.GetCount()) {
+            int field = names.Find(ToLower(columns[fieldof.GetCount()].Left(MaxFieldName)));
+            if (field >= 0 && used[field]) {
+                field = -1;
+            }
+            if (field >= 0) {
+                used[field] = true;
+            }
+            fieldof.Add(field);
+        }
+
+        char *rec = ~batch + count * recsize; // NOLINT: C code
+        memset(rec, 0, recsize);
+        // the cells behind the last column of the header have no field
+        for (int i = 0; i < min(row.GetCount(), fieldof.GetCount()); ++i) {
+            int field = fieldof[i];
+            if (field < 0 || IsNull(row[i])) {
+                continue;
+            }
+            String val = px.EncodeValue(field, row[i]);
+            memcpy(rec + px.GetFieldOffset(field), ~val, val.GetCount()); // NOLINT: C code
+        }
+
+        if (++count == capacity) {
+            ok = px.AppendRecords(batch, count);
+            written += ok ? count : 0;
+            count = 0;
+            if (progress && progress(in.GetPos(), in.GetSize())) {
+                break;
+            }
+        }
+    }
+
+    if (ok && error.IsEmpty() && count > 0) {
+        ok = px.AppendRecords(batch, count);
+        written += ok ? count : 0;
+    }
+    px.Close();
+
+    if (!ok) {
+        error = t_("Writing of the records has failed");
+    }
+    if (!error.IsEmpty() && written > 0) {
+        error << ", " << Format(t_("%d records have been written before the error"), written);
+    }
+    return ok && error.IsEmpty() ? written : -1;
+}
+
+// vim: ts=4 sw=4 expandtab
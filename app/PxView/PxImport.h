@@ -0,0 +1,51 @@
+#ifndef PxImport_h_
+#define PxImport_h_
+
+#include "PxSession.h"
+
+namespace Upp {
+
+// Imports a CSV file with a header line or an NDJSON file (one JSON object
+// per line, by the extension .ndjson, .jsonl or .json) into a Paradox table.
+// A missing table is created with the fields named by the columns and typed
+// by their values, memo fields get a new .mb file. Records of an existing
+// table are appended, the columns are matched to the fields by the name.
+// The records are encoded in batches of whole data blocks, each new block is
+// written to the file at once. Empty autoincrement fields are numbered, a
+// table with a primary index is refused as its .px index is not updated.
+class ParadoxImporter {
+  public:
+    // Separator of the CSV columns, 0 detects it from the header line
+    ParadoxImporter &Separator(int c) {
+        separator = c;
+        return *this;
+    }
+
+    // Returns the number of imported records or -1 when the import failed,
+    // progress gets the number of read and all bytes and returns true to cancel
+    int Import(const String &source, const String &table, Gate<int64, int64> progress = Null);
+
+    String GetError() const {
+        return error;
+    }
+    // Records written to the table before the import failed, the batches
+    // appended before the failure stay in the table
+    int GetWritten() const {
+        return written;
+    }
+
+  private:
+    int separator = 0;
+    bool json = false;
+    String error;
+    int written = 0;
+
+    bool OpenSource(FileIn &in, const String &source, Vector<String> &columns);
+    bool ReadRow(FileIn &in, Vector<String> &columns, Vector<Value> &row);
+    Vector<ParadoxField> GuessFields(const String &source);
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,374 @@
+#include "PxProfile.h"
+
+using namespace Upp;
+
+static bool sIsBlob(char type) {
+    return type == pxfMemoBLOb || type == pxfBLOb || type == pxfFmtMemoBLOb || type == pxfOLE || type == pxfGraphic;
+}
+
+static bool sIsInteger(char type) {
+    return type == pxfLogical || type == pxfShort || type == pxfLong || type == pxfAutoInc || type == pxfDate ||
+           type == pxfTime;
+}
+
+void ParadoxProfiler::Histogram::Add(double x, int64 n) {
+    if (total == 0) {
+        low = x;
+        width = 0;
+        bins[0] = n;
+        total = n;
+        return;
+    }
+
+    if (width == 0) {
+        double w = fabs(x - low) / (HistogramBins - 1);
+        if (w <= 0) {
+            bins[0] += n;
+            total += n;
+            return;
+        }
+        // the first two different values span the bins
+        double value = low;
+        int64 count = bins[0];
+        bins[0] = 0;
+        low = min(low, x);
+        width = w;
+        bins[clamp(int((value - low) / width), 0, HistogramBins - 1)] = count;
+    }
+
+    // the bins become twice wider, the old ones are merged to one half
+    while (x < low) {
+        for (int i = HistogramBins - 1; i >= HistogramBins / 2; --i) {
+            bins[i] = bins[2 * i - HistogramBins] + bins[2 * i - HistogramBins + 1];
+        }
+        for (int i = 0; i < HistogramBins / 2; ++i) {
+            bins[i] = 0;
+        }
+        low -= HistogramBins * width;
+        width *= 2;
+    }
+    while (x >= low + HistogramBins * width) {
+        for (int i = 0; i < HistogramBins / 2; ++i) {
+            bins[i] = bins[2 * i] + bins[2 * i + 1];
+        }
+        for (int i = HistogramBins / 2; i < HistogramBins; ++i) {
+            bins[i] = 0;
+        }
+        width *= 2;
+    }
+
+    bins[clamp(int((x - low) / width), 0, HistogramBins - 1)] += n;
+    total += n;
+}
+
+void ParadoxProfiler::Histogram::Merge(const Histogram &h) {
+    if (h.total == 0) {
+        return;
+    }
+    if (h.width == 0) {
+        Add(h.low, h.bins[0]);
+        return;
+    }
+    for (int i = 0; i < HistogramBins; ++i) {
+        if (h.bins[i] > 0) {
+            Add(h.low + (i + 0.5) * h.width, h.bins[i]); // NOLINT: middle of the bin
+        }
+    }
+}
+
+void ParadoxProfiler::Field::Merge(const Field &f) {
+    nulls += f.nulls;
+    count += f.count;
+    if (!f.minimum.IsEmpty() && (minimum.IsEmpty() || memcmp(~f.minimum, ~minimum, minimum.GetCount()) < 0)) {
+        minimum = f.minimum;
+    }
+    if (!f.maximum.IsEmpty() && (maximum.IsEmpty() || memcmp(~f.maximum, ~maximum, maximum.GetCount()) > 0)) {
+        maximum = f.maximum;
+    }
+    for (int i = 0; i < registers.GetCount() && i < f.registers.GetCount(); ++i) {
+        registers[i] = max(registers[i], f.registers[i]);
+    }
+    lengths += f.lengths;
+    maxlength = max(maxlength, f.maxlength);
+    histogram.Merge(f.histogram);
+}
+
+bool ParadoxProfiler::GetNumber(const Layout &l, const char *p, double &x) {
+    // the numbers are big-endian with the sign bit flipped, negative doubles
+    // have all bits inverted
+    if (sIsInteger(l.type)) {
+        int bits = 8 * l.width; // NOLINT: bits of the field
+        uint64 u = 0;
+        for (int i = 0; i < l.width; ++i) {
+            u = (u << 8) | byte(p[i]); // NOLINT: big-endian
+        }
+        u ^= uint64(1) << (bits - 1);
+        x = double(int64(u << (64 - bits)) >> (64 - bits)); // NOLINT: sign extension
+        return true;
+    }
+
+    switch (l.type) {
+    case pxfNumber:
+    case pxfCurrency:
+    case pxfTimestamp: {
+        uint64 u = 0;
+        for (int i = 0; i < 8; ++i) {  // NOLINT: size of double
+            u = (u << 8) | byte(p[i]); // NOLINT: big-endian
+        }
+        u = (u & 0x8000000000000000ULL) ? u ^ 0x8000000000000000ULL : ~u; // NOLINT: sign bit
+        memcpy(&x, &u, sizeof(x));
+        return IsFin(x);
+    }
+    case pxfBCD: {
+        // 32 digits behind the sign and the number of the decimals, the
+        // digits of a negative number are inverted
+        bool negative = !(p[0] & 0x80); // NOLINT: sign bit
+        int sign = negative ? 0x0f : 0; // NOLINT: nibble
+        double value = 0;
+        for (int i = 2; i < 34; ++i) { // NOLINT: digits
+            int nibble = (i % 2) ? p[i / 2] & 0x0f : (p[i / 2] >> 4) & 0x0f; // NOLINT: nibbles
+            value = 10 * value + (nibble ^ sign); // NOLINT: digits
+        }
+        x = (negative ? -value : value) / pow(10.0, l.decimals); // NOLINT: decimals
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void ParadoxProfiler::Process(const char *data, int count, int recordsize, Array<Field> &fields) const {
+    for (int r = 0; r < count; ++r) {
+        const char *record = data + r * recordsize; // NOLINT: C code
+        for (int f = 0; f < layout.GetCount(); ++f) {
+            const Layout &l = layout[f];
+            const char *p = record + l.offset; // NOLINT: C code
+            Field &s = fields[f];
+
+            if (sIsBlob(l.type)) {
+                // size of the blob data is stored behind the pointer to the blob file
+                int size = l.width < 10 ? 0 : Peek32le(p + l.width - 10 + 4); // NOLINT: blob pointer
+                if (size <= 0) {
+                    ++s.nulls;
+                } else {
+                    ++s.count;
+                    s.lengths += size;
+                    s.maxlength = max(s.maxlength, size);
+                }
+                continue;
+            }
+
+            // empty texts start with zero, other empty values are all zeros
+            int len = 0;
+            if (l.type == pxfAlpha) {
+                while (len < l.width && p[len] != 0) { // NOLINT: C code
+                    ++len;
+                }
+            } else {
+                for (int i = 0; i < l.width && len == 0; ++i) {
+                    len = p[i] != 0 ? l.width : 0; // NOLINT: C code
+                }
+            }
+            if (len == 0) {
+                ++s.nulls;
+                continue;
+            }
+            ++s.count;
+
+            if (s.minimum.IsEmpty() || memcmp(p, ~s.minimum, l.width) < 0) {
+                s.minimum = String(p, l.width);
+            }
+            if (s.maximum.IsEmpty() || memcmp(p, ~s.maximum, l.width) > 0) {
+                s.maximum = String(p, l.width);
+            }
+
+            // the first bits select the register, which keeps the longest run of zeros in the others
+            uint64 h = ParadoxSession::Hash(p, len);
+            uint64 w = (h << HllBits) | (uint64(1) << (HllBits - 1));
+            byte rank = 1;
+            while (!(w & 0x8000000000000000ULL)) { // NOLINT: highest bit
+                ++rank;
+                w <<= 1;
+            }
+            byte &reg = s.registers[int(h >> (64 - HllBits))]; // NOLINT: index bits
+            reg = max(reg, rank);
+
+            if (l.type == pxfAlpha) {
+                s.lengths += len;
+                s.maxlength = max(s.maxlength, len);
+            }
+
+            double x = 0;
+            if (GetNumber(l, p, x)) {
+                s.histogram.Add(x);
+            }
+        }
+    }
+}
+
+int64 ParadoxProfiler::Estimate(const Vector<byte> &registers) {
+    int m = registers.GetCount();
+    if (m == 0) {
+        return 0;
+    }
+    double sum = 0;
+    int zeros = 0;
+    for (byte r : registers) {
+        sum += ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+    double alpha = 0.7213 / (1 + 1.079 / m); // NOLINT: HyperLogLog constants
+    double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeros > 0) { // NOLINT: small range correction
+        e = m * log(double(m) / zeros);
+    }
+    return int64(e + 0.5); // NOLINT: rounding
+}
+
+Value ParadoxProfiler::GetValue(ParadoxSession &px, int field, const String &raw, byte charset) const {
+    Buffer<char> record(px.GetRecordSize(), 0);
+    memcpy(~record + layout[field].offset, ~raw, min(raw.GetCount(), layout[field].width)); // NOLINT: C code
+    return px.DecodeField(~record, field, px.GetCharset(charset));
+}
+
+Value ParadoxProfiler::GetEdge(ParadoxSession &px, int field, double x, byte charset) const {
+    const Layout &l = layout[field];
+    String raw(0, l.width);
+    uint64 u = 0;
+    if (sIsInteger(l.type)) {
+        // the bins of integers start at the first integer inside them
+        int bits = 8 * l.width; // NOLINT: bits of the field
+        double limit = ldexp(1.0, bits - 1);
+        int64 v = int64(clamp(ceil(x), -limit, limit - 1));
+        u = (uint64(v) ^ (uint64(1) << (bits - 1))) << (64 - bits); // NOLINT: sign bit
+    } else if (l.type == pxfNumber || l.type == pxfCurrency || l.type == pxfTimestamp) {
+        memcpy(&u, &x, sizeof(u));
+        u = (u & 0x8000000000000000ULL) ? ~u : u | 0x8000000000000000ULL; // NOLINT: sign bit
+    } else {
+        return x;
+    }
+    for (int i = 0; i < l.width; ++i) {
+        raw.Set(i, int(u >> (56 - 8 * i)) & 0xff); // NOLINT: big-endian
+    }
+    return GetValue(px, field, raw, charset);
+}
+
+bool ParadoxProfiler::Run(ParadoxSession &px, Gate<int, int> progress, byte charset) {
+    error.Clear();
+    statistics.Clear();
+    layout.Clear();
+
+    if (!px.IsOpen()) {
+        error = t_("The DB is not open");
+        return false;
+    }
+
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    pxfield_t *pxf = PX_get_fields(px);
+    for (int i = 0; i < columns.GetCount(); ++i) {
+        Layout &l = layout.Add();
+        l.type = pxf[i].px_ftype;     // NOLINT: C code
+        l.width = pxf[i].px_flen;     // NOLINT: C code
+        l.decimals = pxf[i].px_fdc;   // NOLINT: C code
+        l.offset = px.GetFieldOffset(i);
+    }
+
+    // every thread has its own statistics, they are merged at the end
+    int n = max(threads > 0 ? threads : CPU_Cores(), 1);
+    Array<Array<Field>> partial;
+    for (int t = 0; t < n; ++t) {
+        Array<Field> &fields = partial.Add();
+        for (const Layout &l : layout) {
+            Field &f = fields.Add();
+            if (!sIsBlob(l.type)) {
+                f.registers.SetCount(1 << HllBits, 0);
+            }
+        }
+    }
+
+    int recordsize = px.GetRecordSize();
+    int blocks = px.GetBlockCount();
+    Vector<int> counts;
+    counts.SetCount(blocks, 0);
+    bool ok = px.ProcessBlocks(
+        0, blocks, n,
+        [&](int b, char *data) {
+            counts[b] = px.ReadBlock(b, data);
+            if (counts[b] < 0) {
+                error = Format(t_("The data block %d could not be read"), b);
+                return false;
+            }
+            return true;
+        },
+        [&](int t, int b, const char *data) { Process(data, counts[b], recordsize, partial[t]); },
+        [&](int done, int all) {
+            if (progress && progress(done, all)) {
+                error = t_("The computation was canceled");
+                return true;
+            }
+            return false;
+        });
+    if (!ok) {
+        return false;
+    }
+
+    for (int t = 1; t < n; ++t) {
+        for (int f = 0; f < layout.GetCount(); ++f) {
+            partial[0][f].Merge(partial[t][f]);
+        }
+    }
+
+    for (int f = 0; f < layout.GetCount(); ++f) {
+        const Layout &l = layout[f];
+        const Field &s = partial[0][f];
+        ParadoxColumnStatistics &st = statistics.Add();
+        st.name = columns[f].name;
+        st.type = l.type;
+        st.count = s.count;
+        st.nulls = s.nulls;
+
+        if (sIsBlob(l.type)) {
+            st.distinct = Null;
+        } else {
+            st.distinct = min(Estimate(s.registers), s.count);
+            if (s.count > 0) {
+                st.min = GetValue(px, f, s.minimum, charset);
+                st.max = GetValue(px, f, s.maximum, charset);
+            }
+        }
+        if (l.type == pxfAlpha || sIsBlob(l.type)) {
+            st.avglength = s.count > 0 ? double(s.lengths) / s.count : 0;
+            st.maxlength = s.maxlength;
+        }
+
+        // the empty bins at the ends are left out
+        const Histogram &h = s.histogram;
+        if (h.total > 0 && h.width == 0) {
+            ParadoxColumnStatistics::Bin &bin = st.histogram.Add();
+            bin.from = bin.to = GetEdge(px, f, h.low, charset);
+            bin.count = h.total;
+        } else if (h.total > 0) {
+            int lo = 0;
+            int hi = HistogramBins - 1;
+            while (h.bins[lo] == 0) {
+                ++lo;
+            }
+            while (h.bins[hi] == 0) {
+                --hi;
+            }
+            for (int i = lo; i <= hi; ++i) {
+                ParadoxColumnStatistics::Bin &bin = st.histogram.Add();
+                bin.from = GetEdge(px, f, h.low + i * h.width, charset);
+                bin.to = GetEdge(px, f, h.low + (i + 1) * h.width, charset);
+                bin.count = h.bins[i];
+            }
+        }
+    }
+
+    if (progress) {
+        progress(blocks, blocks);
+    }
+    return true;
+}
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,102 @@
+#ifndef PxProfile_h_
+#define PxProfile_h_
+
+#include "PxSession.h"
+
+namespace Upp {
+
+// Statistics of the values of one field
+struct ParadoxColumnStatistics {
+    struct Bin : Moveable<Bin> {
+        Value from; // the values of the bin are from <= value < to
+        Value to;
+        int64 count = 0;
+    };
+
+    String name;
+    char type = 0;
+    int64 count = 0; // values which are not empty
+    int64 nulls = 0;
+    int64 distinct = 0; // estimate, Null for blob fields
+    Value min;
+    Value max;
+    double avglength = 0; // of texts and blobs
+    int maxlength = 0;
+    Vector<Bin> histogram; // numbers, dates and times
+};
+
+// Computes the statistics of all fields in one pass over the data blocks.
+// The blocks are read in rounds, the records of each round are processed by
+// several threads from the raw data. The minimum and maximum are kept as raw
+// field data, which are ordered bytewise, and decoded at the end. The number
+// of distinct values is estimated by HyperLogLog.
+class ParadoxProfiler {
+  public:
+    ParadoxProfiler &Threads(int n) {
+        threads = n;
+        return *this;
+    }
+
+    // Returns false when a data block could not be read or the work was
+    // canceled, progress gets the number of read and all blocks and returns
+    // true to cancel
+    bool Run(ParadoxSession &px, Gate<int, int> progress = Null, byte charset = 0);
+
+    const Array<ParadoxColumnStatistics> &GetStatistics() const {
+        return statistics;
+    }
+    String GetError() const {
+        return error;
+    }
+
+  private:
+    static constexpr int HllBits = 12;        // NOLINT: 4096 registers, 1.6 % error
+    static constexpr int HistogramBins = 32;  // NOLINT: bins
+
+    // Equal width bins which double their width when a value does not fit
+    struct Histogram {
+        double low = 0;
+        double width = 0; // 0 while all values are the same
+        int64 total = 0;
+        int64 bins[HistogramBins] = {};
+
+        void Add(double x, int64 n = 1);
+        void Merge(const Histogram &h);
+    };
+
+    struct Field {
+        int64 nulls = 0;
+        int64 count = 0;
+        String minimum; // raw data of the field
+        String maximum;
+        Vector<byte> registers;
+        int64 lengths = 0;
+        int maxlength = 0;
+        Histogram histogram;
+
+        void Merge(const Field &f);
+    };
+
+    struct Layout : Moveable<Layout> {
+        char type = 0;
+        int offset = 0;
+        int width = 0;
+        int decimals = 0;
+    };
+
+    int threads = 0;
+    String error;
+    Array<ParadoxColumnStatistics> statistics;
+    Vector<Layout> layout;
+
+    void Process(const char *data, int count, int recordsize, Array<Field> &fields) const;
+    static bool GetNumber(const Layout &l, const char *p, double &x);
+    static int64 Estimate(const Vector<byte> &registers);
+    Value GetValue(ParadoxSession &px, int field, const String &raw, byte charset) const;
+    Value GetEdge(ParadoxSession &px, int field, double x, byte charset) const;
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
@@ -3,8 +3,13 @@
 using namespace Upp;
 
 PxRecordView::PxRecordView() {
+    px.LazyBlobs();
+    cellDisplay.view = this;
+
     WhenMenuBar = [=](Bar &bar) { StatusMenuBar(bar); };
     WhenEnter = WhenLeftDouble = [=] { EditData(); };
+    // cells hold no values, a click on the header sorts the rows by the column store
+    WhenSort = [=] { SortByHeader(); };
 
     httpClient.MaxContentSize(INT_MAX);
     httpClient.WhenContent = [=](const void *ptr, int size) { HttpContent(ptr, size); };
@@ -18,26 +23,45 @@ PxRecordView::PxRecordView() {
         .Accepting()
         .Canceling()
         .ColorRows()
+        .Sorting()
+        .MultiSorting(false)
         .Navigating()
-        .Searching()
         .SetToolBar()
         .SelectRow()
         .MultiSelect()
         .Indicator(true, IndicatorSize);
+
+    // the table can be modified by another program while it is shown
+    SetTimeCallback(-ReloadInterval, [=] { CheckFile(); });
 }
 
 void PxRecordView::StatusMenuBar(Bar &bar) {
     bool enable = px.IsOpen();
 
     bar.Add(enable, t_("Show DB info"), [=] { ShowInfo(); });
+    bar.Add(enable, t_("Show I/O statistics"), [=] { ShowStatistics(); });
+    bar.Add(enable, t_("Show column statistics"), [=] { ShowColumnStatistics(); });
+    bar.Add(enable, t_("Recover deleted records"), [=] { ShowRecoveredRecords(); });
+    bar.Add(enable, t_("Verify table"), [=] { ShowVerification(); });
     bar.Add(t_("Close this DB"), [=] { DoRemoveTab(); });
     bar.Separator();
     bar.Add(enable, t_("Change characters encoding"), [=] { ChangeCharset(); });
     bar.Separator();
-    bar.Add(enable && editing, t_("Delete current row"), [=] { DeleteRow(); });
+    bar.Add(enable, t_("Select columns"), [=] { SelectColumns(); });
+    bar.Add(enable, t_("Filter rows"), [=] { FilterRows(); });
+    bar.Add(enable && IsFiltered(), t_("Show all rows"), [=] { ClearFilter(); });
+    bar.Add(enable, t_("Run SQL query"), [=] { RunQuery(); });
+    bar.Separator();
+    bar.Add(enable && GetColId() >= 0, t_("Sort rows by current column ascending"), [=] { SortRows(GetColId(), false); });
+    bar.Add(enable && GetColId() >= 0, t_("Sort rows by current column descending"), [=] { SortRows(GetColId(), true); });
+    bar.Add(enable, t_("Sort rows by record number"), [=] { SortRows(-1, false); });
+    bar.Separator();
+    bar.Add(enable && editing, t_("Delete selected rows"), [=] { DeleteRow(); });
+    bar.Add(enable && editing && px.CanPack(), t_("Compact table"), [=] { CompactTable(); });
     bar.Separator();
     bar.Add(enable, t_("Export DB as CSV"), [=] { SaveAs(csv); });
     bar.Add(enable, t_("Export DB as JSON"), [=] { SaveAs(json); });
+    bar.Add(enable, t_("Extract all blobs"), [=] { ExtractBlobs(); });
     bar.Separator();
     bar.Add(enable, t_("Send current row using HTTPS (application/json)"), [=] { ExportJson(); });
     bar.Add(enable, t_("Send ALL rows using HTTPS (application/json)"), [=] { ExportAllJson(); });
@@ -55,26 +79,235 @@ bool PxRecordView::OpenDB(const String &filePath) {
     return result;
 }
 
-void PxRecordView::ReadRecords(byte charset) {
+void PxRecordView::ReadRecords() {
     if (!px.IsOpen()) {
         return;
     }
 
     Ready(false);
     Clear(true);
+    recordMap.Clear();
+    storeMap.Clear();
+    store.Clear();
+    sortColumn = -1;
 
     Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
-    for (int i = 0; i < columns.GetCount(); ++i) {
-        AddColumn(static_cast<Id>(columns[i].name), columns[i].name);
+    Vector<int> fields;
+    for (int i : visibleFields) {
+        if (i >= 0 && i < columns.GetCount()) {
+            fields.Add(i);
+        }
+    }
+    if (fields.IsEmpty()) {
+        visibleFields.Clear();
+        for (int i = 0; i < columns.GetCount(); ++i) {
+            fields.Add(i);
+        }
+    }
+    for (int i : fields) {
+        bool blob = px.IsBlobField(i);
+        // BCD numbers and times are texts, which are sorted by their value
+        int format = ParadoxColumns::PLAIN_TEXT;
+        if (px.GetFieldType(i) == pxfBCD) {
+            format = ParadoxColumns::DECIMAL_TEXT;
+        } else if (px.GetFieldType(i) == pxfTime) {
+            format = ParadoxColumns::TIME_TEXT;
+        }
+        store.AddColumn(blob ? INT_V : columns[i].type, format);
+        AddColumn(static_cast<Id>(columns[i].name), columns[i].name).SetDisplay(cellDisplay);
+    }
+
+    if (!rowFilter.IsEmpty() && !rowFilter.Compile(px, dbCharset)) {
+        ErrorOK(Format("%s: %s", t_("Invalid filter"), DeQtf(rowFilter.GetError())));
+        rowFilter.Clear();
+    }
+
+    // only the shown fields of the records accepted by the filter are decoded,
+    // the grid gets empty rows painted from the store
+    px.Scan(rowFilter, [&](int record, const char *data) {
+        recordMap.Add(record);
+        storeMap.Add(store.Add(px.DecodeRecord(data, fields, dbCharset)));
+        return true;
+    });
+    SetRowCount(recordMap.GetCount());
+
+    Ready(true);
+}
+
+void PxRecordView::CheckFile() {
+    // nothing is changed while a dialog of the view is open
+    Ctrl *top = GetTopCtrl();
+    if (top == nullptr || !top->IsEnabled()) {
+        return;
+    }
+
+    // the grid is updated by the first check after the file was read
+    if (reloadSession) {
+        if (reloadRunning == 0) {
+            reloadWork.Finish();
+            ReloadRecords();
+        }
+        return;
+    }
+    if (!px.IsFileChanged()) {
+        return;
+    }
+
+    // the data blocks are read and their checksums made by another thread
+    ParadoxSession *next = &reloadSession.Create();
+    next->Background();
+    String path = px.GetFilePath();
+    reloadRead = false;
+    reloadRunning = 1;
+    reloadWork & [=] {
+        reloadRead = next->ReadForReload(path);
+        --reloadRunning;
+    };
+}
+
+void PxRecordView::ReloadRecords() {
+    ParadoxChanges changes;
+    bool reloaded = reloadRead && px.Reload(changes, *reloadSession);
+    reloadSession.Clear();
+    if (!reloaded) {
+        // the file is tried again by the next check
+        return;
+    }
+
+    // the replaced rows stay in the store, it is made again when they are too many
+    if (changes.fields || store.GetCount() > 2 * GetCount() + ReloadSlack) {
+        ReadRecords();
+        return;
+    }
+
+    int sortcol = sortColumn;
+    if (sortcol >= 0) {
+        SortRows(-1, false);
     }
 
-    Vector<Value> row;
-    for (int i = 0; i < px.GetNumRecords(); ++i) {
-        row = px.GetRow(i, charset);
-        Add(row);
+    // rows of the unchanged blocks get the new numbers of their records,
+    // rows of the changed blocks are removed
+    Vector<bool> same;
+    same.SetCount(px.GetBlockCount(), true);
+    for (int block : changes.changed) {
+        same[block] = false;
+    }
+    Vector<int> removed;
+    for (int i = 0; i < recordMap.GetCount(); ++i) {
+        int record = recordMap[i];
+        int block = FindUpperBound(changes.oldstart, record) - 1;
+        if (block >= 0 && block < same.GetCount() && same[block]) {
+            recordMap[i] = px.GetBlockStart(block) + record - changes.oldstart[block];
+        } else {
+            removed.Add(i);
+        }
     }
 
+    Ready(false);
+    for (int i = removed.GetCount() - 1; i >= 0;) {
+        int count = 1;
+        while (i - count >= 0 && removed[i - count] == removed[i] - count) {
+            ++count;
+        }
+        int first = removed[i] - count + 1;
+        Remove(first, count);
+        recordMap.Remove(first, count);
+        storeMap.Remove(first, count);
+        i -= count;
+    }
+
+    // only the changed blocks are decoded, their records are inserted at their place
+    Vector<int> fields;
+    for (int i = 0; i < store.GetColumnCount(); ++i) {
+        fields.Add(GetFieldId(i));
+    }
+    Vector<int> records;
+    Vector<int> rows;
+    px.Scan(rowFilter, changes.changed, [&](int record, const char *data) {
+        records.Add(record);
+        rows.Add(store.Add(px.DecodeRecord(data, fields, dbCharset)));
+        return true;
+    });
+
+    // the records of one block go to one place, which is filled from the end
+    for (int i = records.GetCount() - 1; i >= 0;) {
+        int pos = FindLowerBound(recordMap, records[i]);
+        int count = 1;
+        while (i - count >= 0 && FindLowerBound(recordMap, records[i - count]) == pos) {
+            ++count;
+        }
+        int first = i - count + 1;
+        Insert(pos, count);
+        recordMap.InsertN(pos, count);
+        storeMap.InsertN(pos, count);
+        for (int k = 0; k < count; ++k) {
+            recordMap[pos + k] = records[first + k];
+            storeMap[pos + k] = rows[first + k];
+        }
+        i -= count;
+    }
     Ready(true);
+
+    if (sortcol >= 0) {
+        SortRows(sortcol, sortDescending);
+    }
+}
+
+void PxRecordView::CellDisplay::Paint(Draw &w, int x, int y, int cx, int cy, const Value &, dword style, Color &fg,
+                                     Color &bg, Font &fnt, bool found, int fs, int fe) {
+    GridDisplay::Paint(w, x, y, cx, cy, view->GetCellText(row, col), style, fg, bg, fnt, found, fs, fe);
+}
+
+Value PxRecordView::GetCellText(int row, int col) const {
+    Value v = store.Get(GetStoreRow(row), col);
+    if (px.IsBlobField(GetFieldId(col)) && !IsNull(v)) {
+        return Format(t_("<%d bytes>"), (int)v);
+    }
+    return v;
+}
+
+Value PxRecordView::GetCellData(int row, int col) {
+    int field = GetFieldId(col);
+    return px.IsBlobField(field) ? px.GetBlob(GetRecordId(row), field, dbCharset) : store.Get(GetStoreRow(row), col);
+}
+
+void PxRecordView::SortRows(int col, bool descending) {
+    if (!px.IsOpen()) {
+        return;
+    }
+
+    Vector<int> records;
+    records.SetCount(store.GetCount(), -1);
+    for (int i = 0; i < storeMap.GetCount(); ++i) {
+        records[storeMap[i]] = recordMap[i];
+    }
+    if (col < 0) {
+        Sort(storeMap, [&](int a, int b) { return records[a] < records[b]; });
+    } else {
+        storeMap = store.Sort(col, storeMap, descending);
+    }
+    sortColumn = col;
+    sortDescending = descending;
+
+    // the empty grid rows stay, they are painted from the store in the new order
+    for (int i = 0; i < storeMap.GetCount(); ++i) {
+        recordMap[i] = records[storeMap[i]];
+    }
+    ClearSelection();
+    Refresh();
+}
+
+void PxRecordView::SortByHeader() {
+    // the grid rows go back to their places, another click on the sorted
+    // column reverses the order
+    Vector<int> order = GetSortOrder();
+    ClearSorting();
+    if (order.IsEmpty()) {
+        SortRows(-1, false);
+        return;
+    }
+    int col = order.Top();
+    SortRows(col, col == sortColumn && !sortDescending);
 }
 
 void PxRecordView::ChangeCharset() {
@@ -95,8 +328,182 @@ void PxRecordView::ChangeCharset() {
 
     if (dlg.Run() == IDOK) {
         String charsetName = dlg.charsetDL.GetValue();
-        ReadRecords(CharsetByName(charsetName));
+        dbCharset = CharsetByName(charsetName);
+        ReadRecords();
+    }
+}
+
+void PxRecordView::SelectColumns() {
+    if (!px.IsOpen()) {
+        return;
+    }
+
+    WithColumnsLayout<TopWindow> dlg;
+    CtrlLayout(dlg, t_("Select columns"));
+    dlg.Sizeable();
+
+    dlg.Acceptor(dlg.ok, IDOK);
+    dlg.Rejector(dlg.cancel, IDCANCEL);
+    dlg.WhenClose = dlg.Rejector(IDCANCEL);
+
+    dlg.columns.AddColumn(t_("Show")).Ctrls<Option>().HeaderTab().Fixed(48); // NOLINT: width
+    dlg.columns.AddColumn(t_("Column"));
+    dlg.columns.AutoHideSb().NoCursor();
+
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    for (int i = 0; i < columns.GetCount(); ++i) {
+        bool show = visibleFields.IsEmpty() || FindIndex(visibleFields, i) >= 0;
+        dlg.columns.Add(show, columns[i].name);
+    }
+
+    if (dlg.Execute() != IDOK) {
+        return;
+    }
+
+    Vector<int> fields;
+    for (int i = 0; i < dlg.columns.GetCount(); ++i) {
+        if ((int)dlg.columns.Get(i, 0) != 0) {
+            fields.Add(i);
+        }
+    }
+
+    if (fields.IsEmpty()) {
+        ErrorOK(t_("At least one column has to be selected"));
+        return;
+    }
+
+    if (fields.GetCount() == columns.GetCount()) {
+        fields.Clear();
+    }
+    visibleFields = pick(fields);
+    ReadRecords();
+}
+
+void PxRecordView::FilterRows() {
+    if (!px.IsOpen()) {
+        return;
+    }
+
+    WithFilterLayout<TopWindow> dlg;
+    CtrlLayout(dlg, t_("Filter rows"));
+
+    dlg.Acceptor(dlg.ok, IDOK);
+    dlg.Rejector(dlg.cancel, IDCANCEL);
+    dlg.WhenClose = dlg.Rejector(IDCANCEL);
+
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    for (int i = 0; i < columns.GetCount(); ++i) {
+        dlg.column.Add(i, columns[i].name);
+    }
+    dlg.column.SetIndex(max(0, min(GetFieldId(GetColId()), columns.GetCount() - 1)));
+
+    dlg.condition.Add(ParadoxFilter::EQUAL, t_("equals"));
+    dlg.condition.Add(ParadoxFilter::RANGE, t_("is between"));
+    dlg.condition.Add(ParadoxFilter::PREFIX, t_("starts with"));
+    dlg.condition.Add(ParadoxFilter::CONTAINS, t_("contains"));
+    dlg.condition.Add(ParadoxFilter::ISNULL, t_("is empty"));
+    dlg.condition.Add(ParadoxFilter::NOTNULL, t_("is not empty"));
+    dlg.condition.SetIndex(0);
+
+    dlg.condition << [&] {
+        int op = ~dlg.condition;
+        dlg.value.Enable(op != ParadoxFilter::ISNULL && op != ParadoxFilter::NOTNULL);
+        dlg.value2.Enable(op == ParadoxFilter::RANGE);
+    };
+    dlg.condition.WhenAction();
+
+    if (dlg.Execute() != IDOK) {
+        return;
+    }
+
+    int field = ~dlg.column;
+    String value = ~dlg.value;
+    String value2 = ~dlg.value2;
+
+    rowFilter.Clear();
+    rowFilter.NoCase(~dlg.nocase);
+    switch ((int)~dlg.condition) {
+    case ParadoxFilter::EQUAL:
+        rowFilter.Equal(field, value);
+        break;
+    case ParadoxFilter::RANGE:
+        rowFilter.Range(field, value, value2);
+        break;
+    case ParadoxFilter::PREFIX:
+        rowFilter.Prefix(field, value);
+        break;
+    case ParadoxFilter::CONTAINS:
+        rowFilter.Contains(field, value);
+        break;
+    case ParadoxFilter::ISNULL:
+        rowFilter.IsNull(field);
+        break;
+    case ParadoxFilter::NOTNULL:
+        rowFilter.NotNull(field);
+        break;
+    default:
+        break;
+    }
+
+    ReadRecords();
+}
+
+void PxRecordView::ClearFilter() {
+    rowFilter.Clear();
+    ReadRecords();
+}
+
+void PxRecordView::RunQuery() {
+    if (!px.IsOpen()) {
+        return;
+    }
+
+    WithSqlQueryLayout<TopWindow> dlg;
+    CtrlLayout(dlg, t_("SQL query"));
+    dlg.Sizeable().Zoomable();
+
+    dlg.Rejector(dlg.cancel, IDCANCEL);
+    dlg.WhenClose = dlg.Rejector(IDCANCEL);
+
+    dlg.query <<= Format("SELECT * FROM %s", GetFileTitle(px.GetFilePath()));
+    dlg.result.AutoHideSb().OddRowColor();
+
+    dlg.execute << [&] {
+        dlg.result.Reset();
+
+        String query = ~dlg.query;
+        Sql sql(px);
+        if (!sql.Execute(query)) {
+            dlg.status.SetText(px.GetLastError());
+            return;
+        }
+
+        for (int i = 0; i < sql.GetColumns(); ++i) {
+            dlg.result.AddColumn(sql.GetColumnInfo(i).name);
+        }
+        while (sql.Fetch()) {
+            dlg.result.Add(sql.GetRow());
+        }
+        dlg.status.SetText(Format(t_("Number of rows: %d"), dlg.result.GetCount()));
+    };
+
+    dlg.Execute();
+}
+
+Vector<int> PxRecordView::GetEditRows() {
+    // all selected rows when the current row is one of them
+    Vector<int> rows;
+    int row = GetRowId();
+    if (GetSelectedCount() > 1 && IsSelected(row)) {
+        for (int i = 0; i < GetCount(); ++i) {
+            if (IsSelected(i)) {
+                rows.Add(i);
+            }
+        }
+    } else if (row >= 0) {
+        rows.Add(row);
     }
+    return rows;
 }
 
 void PxRecordView::DeleteRow() {
@@ -104,14 +511,66 @@ void PxRecordView::DeleteRow() {
         return;
     }
 
-    int row = GetRowId();
+    Vector<int> rows = GetEditRows();
+    if (rows.IsEmpty()) {
+        return;
+    }
 
-    if (PromptOKCancel(t_("Delete current row from the DB?")) == IDOK) {
-        if (px.DelRow(row)) {
-            ReadRecords();
-        } else {
-            ErrorOK(t_("Delete row has failed!"));
+    String question = rows.GetCount() > 1 ? Format(t_("Delete %d selected rows from the DB?"), rows.GetCount())
+                                          : String(t_("Delete current row from the DB?"));
+    if (PromptOKCancel(question) != IDOK) {
+        return;
+    }
+
+    Vector<int> records;
+    for (int row : rows) {
+        records.Add(GetRecordId(row));
+    }
+
+    if (!px.DelRows(records)) {
+        ErrorOK(t_("Delete row has failed!"));
+        ReadRecords();
+        return;
+    }
+
+    // only the deleted rows are removed from the grid, the following
+    // records move down by the number of deleted records before them
+    for (int i = rows.GetCount() - 1; i >= 0;) {
+        int count = 1;
+        while (i - count >= 0 && rows[i - count] == rows[i] - count) {
+            ++count;
         }
+        int first = rows[i] - count + 1;
+        Remove(first, count);
+        recordMap.Remove(first, count);
+        storeMap.Remove(first, count);
+        i -= count;
+    }
+
+    Sort(records);
+    for (int &record : recordMap) {
+        record -= FindLowerBound(records, record);
+    }
+}
+
+void PxRecordView::CompactTable() {
+    if (!px.IsOpen() || !editing) {
+        return;
+    }
+
+    if (!px.CanPack()) {
+        ErrorOK(t_("A table with a primary index cannot be compacted!"));
+        return;
+    }
+
+    // the records keep their numbers, so the grid stays as it is
+    int64 size = GetFileLength(px.GetFilePath());
+    if (px.Pack()) {
+        PromptOK(Format(t_("Size of the table reduced from %s to %s"), FormatFileSize(size),
+                        FormatFileSize(GetFileLength(px.GetFilePath()))));
+    } else {
+        ErrorOK(t_("Compacting of the table has failed!"));
+        ReadRecords();
     }
 }
 
@@ -122,7 +581,7 @@ void PxRecordView::EditData() {
 
     int row = GetRowId();
     int col = GetColId();
-    Value data = Get(row, col);
+    Value data = GetCellData(row, col);
 
     Button ok;
     Button cancel;
@@ -178,10 +637,36 @@ void PxRecordView::EditData() {
 
     if (editcolumn.Execute() == IDOK) {
         Value newData = c->GetData();
-        if (data != newData && px.SetRowCol(row, col, newData)) {
-            Set(row, col, newData);
-            modified = true;
+
+        // the value is set to all selected rows, which are written at once
+        Vector<int> rows = GetEditRows();
+        int field = GetFieldId(col);
+        Vector<int> changed;
+        px.Begin();
+        for (int r : rows) {
+            if (GetCellData(r, col) != newData && px.SetRowCol(GetRecordId(r), field, newData)) {
+                changed.Add(r);
+            }
         }
+        px.Commit();
+
+        if (!px.GetLastError().IsEmpty()) {
+            ErrorOK(DeQtf(px.GetLastError()));
+            return;
+        }
+
+        for (int r : changed) {
+            if (px.IsBlobField(field)) {
+                Vector<Value> blob = px.GetRow(GetRecordId(r), Vector<int>{field}, dbCharset);
+                store.Set(GetStoreRow(r), col, blob.IsEmpty() ? Value() : blob[0]);
+            } else {
+                store.Set(GetStoreRow(r), col, newData);
+            }
+        }
+        if (!changed.IsEmpty()) {
+            Refresh();
+        }
+        modified = modified || !changed.IsEmpty();
     }
 }
 
@@ -243,8 +728,271 @@ void PxRecordView::ShowInfo() {
     w.Run();
 }
 
-String
-PxRecordView::AsText(String (*format)(const Value &), const char *tab, const char *row, const char *hdrtab, const char *hdrrow) const {
+static const VectorMap<int, const char *> &sFieldTypes() {
+    static const VectorMap<int, const char *> types = {
+        {pxfAlpha, "alpha"},
+        {pxfDate, "date"},
+        {pxfShort, "short"},
+        {pxfLong, "long"},
+        {pxfCurrency, "currency"},
+        {pxfNumber, "number"},
+        {pxfLogical, "logical"},
+        {pxfMemoBLOb, "memo"},
+        {pxfBLOb, "blob"},
+        {pxfFmtMemoBLOb, "formatted memo"},
+        {pxfOLE, "OLE"},
+        {pxfGraphic, "graphic"},
+        {pxfTime, "time"},
+        {pxfTimestamp, "timestamp"},
+        {pxfAutoInc, "autoincrement"},
+        {pxfBCD, "BCD"},
+        {pxfBytes, "bytes"},
+    };
+    return types;
+}
+
+void PxRecordView::ShowStatistics() {
+    if (!px.IsOpen()) {
+        return;
+    }
+
+    TopWindow w;
+    ArrayCtrl info;
+
+    info.AddColumn("parameter");
+    info.AddColumn("value");
+    info.NoHeader().AutoHideSb().OddRowColor();
+
+    const pxstats_t &io = px.GetIOStatistics();
+    info.Add("Bytes read", int64(io.bytesread));
+    info.Add("Bytes written", int64(io.byteswritten));
+    info.Add("Seeks", int64(io.seeks));
+    info.Add("Data blocks read", int64(io.blocksread));
+    info.Add("Data blocks written", int64(io.blockswritten));
+    info.Add("Block cache hits", int64(io.cachehits));
+    info.Add("Block cache misses", int64(io.cachemisses));
+    info.Add("Data blocks decrypted", int64(io.blocksdecrypted));
+    info.Add("Memory allocations", int64(io.allocations));
+    info.Add("Arena allocations", int64(io.arenaallocations));
+    info.Add("Column store memory", store.GetMemoryUsage());
+
+    info.Add("Data blocks skipped by filter", px.GetSkippedBlocks());
+    info.Add("Decoded records", px.GetDecodedRecords());
+    const VectorMap<int, const char *> &types = sFieldTypes();
+    for (int i = 0; i < types.GetCount(); ++i) {
+        if (px.GetDecodedFields(types.GetKey(i)) > 0) {
+            info.Add(Format("Decoded %s fields", types[i]), px.GetDecodedFields(types.GetKey(i)));
+        }
+    }
+
+    // times are shown in milliseconds
+    static const char *phases[] = {"Open time (ms)", "Index build time (ms)", "Scan time (ms)", "Export time (ms)",
+                                   "HTTP time (ms)"};
+    for (int i = 0; i < ParadoxSession::PhaseCount; ++i) {
+        info.Add(phases[i], px.GetTime(i) / 1000.0); // NOLINT: microseconds
+    }
+
+    w.Title(t_("I/O statistics"));
+    w.SetRect(0, 0, InfoSizeHorz, InfoSizeVert);
+    w.Sizeable();
+    w.Add(info.SizePos());
+
+    w.Run();
+}
+
+void PxRecordView::ShowColumnStatistics() {
+    if (!px.IsOpen()) {
+        return;
+    }
+
+    // the grid is not used, all records of the table are read
+    ParadoxProfiler profiler;
+    Progress pi(t_("Computing column statistics"));
+    bool ok = profiler.Run(px, [&](int done, int total) {
+        pi.Set(done, total);
+        return pi.Canceled();
+    }, dbCharset);
+    pi.Close();
+    if (!ok) {
+        ErrorOK(Format("%s: %s", t_("Error computing the column statistics"), DeQtf(profiler.GetError())));
+        return;
+    }
+    const Array<ParadoxColumnStatistics> &statistics = profiler.GetStatistics();
+
+    TopWindow w;
+    Splitter split;
+    ArrayCtrl fields;
+    ArrayCtrl histogram;
+
+    fields.AddColumn(t_("Field"));
+    fields.AddColumn(t_("Type"));
+    fields.AddColumn(t_("Values"));
+    fields.AddColumn(t_("Empty"));
+    fields.AddColumn(t_("Distinct (estimate)"));
+    fields.AddColumn(t_("Minimum"));
+    fields.AddColumn(t_("Maximum"));
+    fields.AddColumn(t_("Average length"));
+    fields.AddColumn(t_("Maximum length"));
+    fields.AutoHideSb().OddRowColor();
+
+    const VectorMap<int, const char *> &types = sFieldTypes();
+    for (int i = 0; i < statistics.GetCount(); ++i) {
+        const ParadoxColumnStatistics &s = statistics[i];
+        bool text = s.type == pxfAlpha || px.IsBlobField(i);
+        fields.Add(s.name, types.Get(s.type, ""), s.count, s.nulls, s.distinct, s.min, s.max,
+                   text ? Value(Format("%.1f", s.avglength)) : Value(), text ? Value(s.maxlength) : Value());
+    }
+
+    histogram.AddColumn(t_("From"));
+    histogram.AddColumn(t_("To"));
+    histogram.AddColumn(t_("Count"));
+    histogram.AutoHideSb().OddRowColor();
+
+    // histogram of the selected numeric, date or time field
+    fields.WhenSel = [&] {
+        histogram.Clear();
+        int i = fields.GetCursor();
+        if (i >= 0 && i < statistics.GetCount()) {
+            for (const ParadoxColumnStatistics::Bin &bin : statistics[i].histogram) {
+                histogram.Add(bin.from, bin.to, bin.count);
+            }
+        }
+    };
+    if (fields.GetCount() > 0) {
+        fields.SetCursor(0);
+    }
+
+    split.Vert(fields, histogram);
+    w.Title(t_("Column statistics"));
+    w.SetRect(0, 0, 2 * InfoSizeHorz, InfoSizeVert);
+    w.Sizeable();
+    w.Add(split.SizePos());
+
+    w.Run();
+}
+
+void PxRecordView::ShowRecoveredRecords() {
+    if (!px.IsOpen()) {
+        return;
+    }
+
+    ParadoxRecovery recovery;
+    Progress pi(t_("Recovering deleted records"));
+    bool ok = recovery.Run(px, [&](int done, int total) {
+        pi.Set(done, total);
+        return pi.Canceled();
+    });
+    pi.Close();
+    if (!ok) {
+        ErrorOK(Format("%s: %s", t_("Error recovering the deleted records"), DeQtf(recovery.GetError())));
+        return;
+    }
+    const Vector<ParadoxRecoveredRecord> &records = recovery.GetRecords();
+    if (records.IsEmpty()) {
+        PromptOK(Format(t_("No deleted records were found in %d data blocks"), recovery.GetBlockCount()));
+        return;
+    }
+
+    TopWindow w;
+    ArrayCtrl list;
+    Button save;
+
+    // the found records are not added to the table, they can be exported
+    list.AddColumn(t_("Source"));
+    list.AddColumn(t_("Block"));
+    list.AddColumn(t_("Slot"));
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    for (const SqlColumnInfo &c : columns) {
+        list.AddColumn(c.name);
+    }
+    list.AutoHideSb().OddRowColor().MultiSelect();
+    for (const ParadoxRecoveredRecord &r : records) {
+        Vector<Value> row = px.DecodeRecord(~r.data, dbCharset);
+        row.Insert(0, r.kind == ParadoxRecoveredRecord::DELETED ? t_("deleted") : t_("unlinked block"));
+        row.Insert(1, r.block);
+        row.Insert(2, r.slot);
+        list.Add(row);
+    }
+
+    save.SetLabel(t_("Export as CSV")) << [&] {
+        FileSel file;
+        file.Type(t_("CSV files (*.csv)"), "*.csv");
+        if (file.ExecuteSaveAs(t_("Select file to save the recovered records")) &&
+            !SaveFile(file.Get(), list.AsCsv(false, ';', true))) {
+            ErrorOK(t_("Error saving the CSV file"));
+        }
+    };
+
+    w.Title(Format(t_("Recovered records: %d, rejected slots: %d, copies of records: %d"), records.GetCount(),
+                   recovery.GetRejectedSlots(), recovery.GetDuplicateSlots()));
+    w.SetRect(0, 0, 2 * InfoSizeHorz, InfoSizeVert);
+    w.Sizeable();
+    w.Add(list.HSizePos().VSizePosZ(0, 28)); // NOLINT: position
+    w.Add(save.RightPosZ(4, 100).BottomPosZ(4, 20)); // NOLINT: position
+
+    w.Run();
+}
+
+void PxRecordView::ShowVerification() {
+    if (!px.IsOpen()) {
+        return;
+    }
+
+    ParadoxVerifier verifier;
+    Progress pi(t_("Verifying the table"));
+    bool ok = verifier.Run(px, [&](int done, int total) {
+        pi.Set(done, total);
+        return pi.Canceled();
+    });
+    pi.Close();
+    if (!ok) {
+        ErrorOK(Format("%s: %s", t_("Error verifying the table"), DeQtf(verifier.GetError())));
+        return;
+    }
+    const Vector<ParadoxProblem> &problems = verifier.GetProblems();
+    if (problems.IsEmpty()) {
+        PromptOK(Format(t_("No problems were found in %d data blocks, %d records and %d blobs"),
+                        verifier.GetCheckedBlocks(), verifier.GetCheckedRecords(), verifier.GetCheckedBlobs()));
+        return;
+    }
+
+    TopWindow w;
+    ArrayCtrl list;
+    Button save;
+
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    list.AddColumn(t_("Severity"));
+    list.AddColumn(t_("Block"));
+    list.AddColumn(t_("Record"));
+    list.AddColumn(t_("Field"));
+    list.AddColumn(t_("Problem"), 4); // NOLINT: column width ratio
+    list.AutoHideSb().OddRowColor().MultiSelect();
+    for (const ParadoxProblem &p : problems) {
+        list.Add(p.severity == ParadoxProblem::FAILURE ? t_("error") : t_("warning"), p.block > 0 ? Value(p.block) : Value(),
+                 p.slot >= 0 ? Value(p.slot) : Value(),
+                 p.field >= 0 && p.field < columns.GetCount() ? Value(columns[p.field].name) : Value(), p.text);
+    }
+
+    save.SetLabel(t_("Save report")) << [&] {
+        FileSel file;
+        file.Type(t_("text files (*.txt)"), "*.txt");
+        if (file.ExecuteSaveAs(t_("Select file to save the report")) && !SaveFile(file.Get(), verifier.GetReport(px))) {
+            ErrorOK(t_("Error saving the report"));
+        }
+    };
+
+    w.Title(Format(t_("Errors: %d, warnings: %d, data blocks: %d, records: %d, blobs: %d"), verifier.GetErrorCount(),
+                   verifier.GetWarningCount(), verifier.GetCheckedBlocks(), verifier.GetCheckedRecords(),
+                   verifier.GetCheckedBlobs()));
+    w.SetRect(0, 0, 2 * InfoSizeHorz, InfoSizeVert);
+    w.Sizeable();
+    w.Add(list.HSizePos().VSizePosZ(0, 28)); // NOLINT: position
+    w.Add(save.RightPosZ(4, 100).BottomPosZ(4, 20)); // NOLINT: position
+
+    w.Run();
+}
+
+String PxRecordView::AsText(String (*format)(const Value &), const char *tab, const char *row, const char *hdrtab, const char *hdrrow) {
     String txt;
     if (hdrtab != nullptr) {
         for (int i = 0; i < GetColumnCount(); ++i) {
@@ -266,7 +1014,7 @@ PxRecordView::AsText(String (*format)(const Value &), const char *tab, const cha
             if (i > 0) {
                 txt << tab;
             }
-            txt << (*format)(Get(r, i));
+            txt << (*format)(GetCellData(r, i));
         }
         next = true;
     }
@@ -289,23 +1037,24 @@ static String sCsvString(const String &text) {
     return r;
 }
 
-static String sCsvFormat(const Value &v) {
-    return (IsNumber(v) || IsVoid(v)) ? AsString(v) : CsvString(AsString(v));
-}
-
-String PxRecordView::AsCsv(int sep, bool hdr) const {
+String PxRecordView::AsCsv(int sep, bool hdr) {
+    int64 start = usecs();
     String h(0, 2);
     h.Set(0, sep);
-    return AsText(sCsvFormat, h, "\r\n", hdr ? h : Null, "\r\n");
+    String csv = AsText(ParadoxSortedExport::CsvFormat, h, "\r\n", hdr ? h : Null, "\r\n");
+    px.AddTime(ParadoxSession::PhaseExport, usecs(start));
+    return csv;
 }
 
 String PxRecordView::AsJson() {
+    int64 start = usecs();
     JsonArray data;
 
     for (int r = 0; r < GetCount(); ++r) {
         data << GetJson(r);
     }
 
+    px.AddTime(ParadoxSession::PhaseExport, usecs(start));
     return data.ToString();
 }
 
@@ -313,7 +1062,7 @@ Json PxRecordView::GetJson(int row) {
     Json json;
 
     for (int i = 0; i < GetColumnCount(); ++i) {
-        String val = Get(row, i).ToString();
+        String val = GetCellData(row, i).ToString();
         if (val.GetCount() > 0) {
             val.Replace("\r", "");
             val.Replace("\n", "\\n");
@@ -337,10 +1086,32 @@ void PxRecordView::SaveAs(const int filetype) {
     }
 }
 
+bool PxRecordView::SaveRows(const String &filePath, int output) {
+    // the shown fields of the filtered rows are exported in the order of the
+    // grid, the rows sorted by the size of a blob stay in the record order
+    ParadoxSortedExport exporter;
+    Vector<int> fields;
+    for (int i = 0; i < GetColumnCount(); ++i) {
+        fields.Add(GetFieldId(i));
+    }
+    exporter.Fields(fields).Filter(rowFilter).Output(output);
+    if (sortColumn >= 0 && !px.IsBlobField(GetFieldId(sortColumn))) {
+        exporter.SortBy(GetFieldId(sortColumn), sortDescending);
+    }
+
+    FileOut out;
+    if (!out.Open(filePath)) {
+        return false;
+    }
+    int count = exporter.Export(px, out, dbCharset);
+    out.Close();
+    return count >= 0 && !out.IsError();
+}
+
 void PxRecordView::SaveAsCsv(const String &dirPath) {
     String fileName = px.GetFileName() + ".csv";
     String filePath = AppendFileName(dirPath, fileName);
-    if (!SaveFile(filePath, AsCsv())) {
+    if (!SaveRows(filePath, ParadoxSortedExport::CSV)) {
         ErrorOK("Error saving the CSV file");
     } else {
         PromptOK("Successfully saved the CSV file");
@@ -350,13 +1121,40 @@ void PxRecordView::SaveAsCsv(const String &dirPath) {
 void PxRecordView::SaveAsJson(const String &dirPath) {
     String fileName = px.GetFileName() + ".json";
     String filePath = AppendFileName(dirPath, fileName);
-    if (!SaveFile(filePath, AsJson())) {
+    if (!SaveRows(filePath, ParadoxSortedExport::JSON)) {
         ErrorOK("Error saving the JSON file");
     } else {
         PromptOK("Successfully saved the JSON file");
     }
 }
 
+void PxRecordView::ExtractBlobs() {
+    if (!px.IsOpen()) {
+        return;
+    }
+
+    FileSel file;
+    if (!file.ExecuteSelectDir(t_("Select directory to save the blobs"))) {
+        return;
+    }
+
+    Progress pi(t_("Extracting blobs"));
+    ParadoxBlobExtractor extractor;
+    int count = extractor.Extract(px, file.Get(), [&](int done, int total) {
+        pi.Set(done, total);
+        return pi.Canceled();
+    });
+
+    if (count < 0) {
+        ErrorOK(Format("%s: %s", t_("Error extracting the blobs"), DeQtf(extractor.GetError())));
+    } else if (extractor.GetFailedCount() > 0) {
+        Exclamation(Format(t_("Extracted blobs: %d, failed: %d"), count, extractor.GetFailedCount()) + "&" +
+                    DeQtf(extractor.GetError()));
+    } else {
+        PromptOK(Format(t_("Extracted blobs: %d"), count));
+    }
+}
+
 void PxRecordView::GetUrl(bool &upload, String &url, String &auth, bool &checkError) {
     WithHttpSendLayout<TopWindow> ctrl;
     CtrlLayout(ctrl, t_("HTTPS data transfer"));
@@ -389,7 +1187,9 @@ int PxRecordView::SendData(const Json &data, const String &url, const String &au
     httpClient.Authorization(auth);
     httpClient.ContentType("application/json");
     httpClient.Post(data);
+    int64 start = usecs();
     httpClient.Url(url).Execute();
+    px.AddTime(ParadoxSession::PhaseHttp, usecs(start));
 
     if (httpOut.IsOpen()) {
         httpOut.Close();
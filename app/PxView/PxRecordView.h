@@ -4,6 +4,13 @@
 #include <CtrlLib/CtrlLib.h>
 #include <GridCtrl/GridCtrl.h>
 
+#include "PxBlob.h"
+#include "PxColumns.h"
+#include "PxExport.h"
+#include "PxFilter.h"
+#include "PxProfile.h"
+#include "PxRecover.h"
+#include "PxVerify.h"
 #include "PxSession.h"
 
 enum filetype {
@@ -17,14 +24,41 @@ class PxRecordView : public Upp::GridCtrl {
     ~PxRecordView() override {};
 
   private:
+    // Grid cells hold no values, they are painted from the column store by
+    // the row of the store of the grid row. Blob columns hold the size of the
+    // data only, the data are read on demand.
+    struct CellDisplay : public Upp::GridDisplay {
+        const PxRecordView *view = nullptr;
+        void Paint(Upp::Draw &w, int x, int y, int cx, int cy, const Upp::Value &val, Upp::dword style,
+                   Upp::Color &fg, Upp::Color &bg, Upp::Font &fnt, bool found, int fs, int fe) override;
+    };
+
     Upp::ParadoxSession px;
+    Upp::ParadoxFilter rowFilter;
+    Upp::Vector<int> recordMap;     // record number of each grid row
+    Upp::Vector<int> storeMap;      // row of the column store of each grid row
+    Upp::ParadoxColumns store;      // decoded values of the shown fields
+    Upp::Vector<int> visibleFields; // field number of each grid column, empty for all fields
+    byte dbCharset = 0;
     bool modified = false;
+    CellDisplay cellDisplay;
+    int sortColumn = -1; // grid rows are in the order of the records
+    bool sortDescending = false;
+
+    // The changed file is read by a session of its own in the background,
+    // the work is declared last to be finished before the session is freed
+    Upp::One<Upp::ParadoxSession> reloadSession;
+    bool reloadRead = false;
+    Upp::Atomic reloadRunning;
+    Upp::CoWork reloadWork;
 
     const int EditSizeHorz = 640;
     const int EditSizeVert = 72;
     const int InfoSizeHorz = 500;
     const int InfoSizeVert = 400;
     const int IndicatorSize = 12;
+    const int ReloadInterval = 2000; // ms between the checks of the file
+    const int ReloadSlack = 4096;    // replaced rows kept in the store
 
     Upp::Progress httpPI;
     Upp::HttpRequest httpClient;
@@ -38,9 +72,20 @@ class PxRecordView : public Upp::GridCtrl {
     Upp::String httpPIText = Upp::t_("HTTPS data transfer");
 
     void StatusMenuBar(Upp::Bar &bar);
-    void ReadRecords(byte charset = 0);
+    void ReadRecords();
+    void CheckFile();
+    void ReloadRecords();
+    Upp::Value GetCellData(int row, int col);
+    Upp::Value GetCellText(int row, int col) const;
+    int GetStoreRow(int row) const {
+        return (row >= 0 && row < storeMap.GetCount()) ? storeMap[row] : -1;
+    }
+    Upp::Vector<int> GetEditRows();
     void EditData();
+    void SortRows(int col, bool descending);
+    void SortByHeader();
     void SaveAs(int fileType);
+    bool SaveRows(const Upp::String &filePath, int output);
 
     void HttpStart();
     void HttpContent(const void *ptr, int size);
@@ -63,15 +108,40 @@ class PxRecordView : public Upp::GridCtrl {
     bool IsDBOpen() {
         return px.IsOpen();
     }
+    bool CanCompact() const {
+        return editing && px.CanPack();
+    }
     void ShowInfo();
+    void ShowStatistics();
+    void ShowColumnStatistics();
+    void ShowRecoveredRecords();
+    void ShowVerification();
     void ChangeCharset();
+    void SelectColumns();
+    void FilterRows();
+    void ClearFilter();
+    void RunQuery();
+    bool IsFiltered() const {
+        return !rowFilter.IsEmpty();
+    }
+    int GetRecordId(int row) const {
+        return (row >= 0 && row < recordMap.GetCount()) ? recordMap[row] : -1;
+    }
+    int GetFieldId(int col) const {
+        return visibleFields.IsEmpty() ? col : ((col >= 0 && col < visibleFields.GetCount()) ? visibleFields[col] : -1);
+    }
     void DeleteRow();
+    void CompactTable();
+    void ExtractBlobs();
     void ExportJson();
     void ExportAllJson();
 
     Upp::String GetFilePath() const {
         return px.GetFilePath();
     }
+    void Journal(bool b) {
+        px.Journal(b);
+    }
     Upp::String GetFileName() const {
         return px.GetFileName();
     }
@@ -80,8 +150,8 @@ class PxRecordView : public Upp::GridCtrl {
                        const char *tab = "\t",
                        const char *row = "\r\n",
                        const char *hdrtab = "\t",
-                       const char *hdrrow = "\r\n") const;
-    Upp::String AsCsv(int sep = ';', bool hdr = true) const;
+                       const char *hdrrow = "\r\n");
+    Upp::String AsCsv(int sep = ';', bool hdr = true);
     Upp::String AsJson();
 
     Upp::Json GetJson(int row);
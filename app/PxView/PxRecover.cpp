@@ -0,0 +1,113 @@
+#include "PxRecover.h"
+
+using namespace Upp;
+
+bool ParadoxRecovery::IsValid(const ParadoxSession &px, const char *record) {
+    for (int f = 0; f < px.GetNumFields(); ++f) {
+        if (!px.IsValidData(record, f)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParadoxRecovery::Run(ParadoxSession &px, Gate<int, int> progress) {
+    error.Clear();
+    records.Clear();
+    blockcount = 0;
+    unlinked = 0;
+    rejected = 0;
+    duplicated = 0;
+
+    if (!px.IsOpen()) {
+        error = t_("The DB is not open");
+        return false;
+    }
+
+    // the blocks in the list of the table, the other ones are unlinked
+    blockcount = px.GetFileBlockCount();
+    Vector<bool> linked;
+    linked.SetCount(blockcount + 1, false);
+    for (int block = 0; block < px.GetBlockCount(); ++block) {
+        int number = px.GetBlockNumber(block);
+        if (number > 0 && number <= blockcount) {
+            linked[number] = true;
+        }
+    }
+
+    // a delete moves the following records of the block down, so the slots
+    // behind the records in use often keep copies of them
+    int recordsize = px.GetRecordSize();
+    Buffer<char> data(px.GetBlockSize());
+    Vector<uint64> live;
+    Vector<uint64> hashes;
+    Index<uint64> found;
+    for (int number = 1; number <= blockcount; ++number) {
+        if (progress(number - 1, blockcount)) {
+            error = t_("The computation was canceled");
+            return false;
+        }
+        pxdatablockinfo_t info;
+        int slots = px.ReadRawBlock(number, ~data, info);
+        int inuse = info.numrecords;
+        if (slots < 0) {
+            error = Format(t_("The data block %d could not be read"), number);
+            return false;
+        }
+
+        // all slots of an unlinked block or of a broken block header are examined
+        int first = 0;
+        if (!linked[number]) {
+            ++unlinked;
+        } else if (inuse > 0) {
+            first = inuse;
+            for (int i = 0; i < inuse; ++i) {
+                live.Add(ParadoxSession::Hash(~data + i * recordsize, recordsize)); // NOLINT: C code
+            }
+        }
+
+        for (int i = first; i < slots; ++i) {
+            const char *rec = ~data + i * recordsize; // NOLINT: C code
+            bool empty = true;
+            for (int j = 0; empty && j < recordsize; ++j) {
+                empty = rec[j] == '\0'; // NOLINT: C code
+            }
+            if (empty) {
+                continue;
+            }
+            if (!IsValid(px, rec)) {
+                ++rejected;
+                continue;
+            }
+            uint64 hash = ParadoxSession::Hash(rec, recordsize);
+            if (!duplicates && found.Find(hash) >= 0) {
+                ++duplicated;
+                continue;
+            }
+            found.Add(hash);
+            hashes.Add(hash);
+            ParadoxRecoveredRecord &r = records.Add();
+            r.kind = linked[number] ? ParadoxRecoveredRecord::DELETED : ParadoxRecoveredRecord::UNLINKED;
+            r.block = number;
+            r.slot = i;
+            r.data = String(rec, recordsize);
+        }
+    }
+
+    // copies of the records in use are known after all blocks were read
+    if (!duplicates) {
+        Sort(live);
+        Vector<int> copies;
+        for (int i = 0; i < records.GetCount(); ++i) {
+            int q = FindLowerBound(live, hashes[i]);
+            if (q < live.GetCount() && live[q] == hashes[i]) {
+                copies.Add(i);
+            }
+        }
+        records.Remove(copies);
+        duplicated += copies.GetCount();
+    }
+    return true;
+}
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,74 @@
+#ifndef PxRecover_h_
+#define PxRecover_h_
+
+#include "PxSession.h"
+
+namespace Upp {
+
+// Record found in a data block slot which is not in use
+struct ParadoxRecoveredRecord : Moveable<ParadoxRecoveredRecord> {
+    enum { DELETED, UNLINKED };
+
+    int kind = DELETED; // behind the records of a block in the list, or in a block out of the list
+    int block = 0;      // number of the data block in the file, the first block is 1
+    int slot = 0;
+    String data; // raw data of the record
+};
+
+// Finds the records which can be recovered from the slots of the data blocks
+// which are not in use: behind the records of each block, whose data are
+// kept after a delete, and in the blocks which are not in the list of the
+// table. All blocks of the file are read once in their order. The data of a
+// slot is accepted when each field is empty or valid for its type, copies of
+// the records of the table and of the other recovered records are left out.
+class ParadoxRecovery {
+  public:
+    // Copies of the records of the table are recovered too
+    ParadoxRecovery &Duplicates(bool b = true) {
+        duplicates = b;
+        return *this;
+    }
+
+    // Returns false when a data block could not be read or the work was
+    // canceled, progress gets the number of read and all blocks and returns
+    // true to cancel
+    bool Run(ParadoxSession &px, Gate<int, int> progress = Null);
+
+    const Vector<ParadoxRecoveredRecord> &GetRecords() const {
+        return records;
+    }
+    String GetError() const {
+        return error;
+    }
+    // Data blocks of the file and the ones which are not in the list
+    int GetBlockCount() const {
+        return blockcount;
+    }
+    int GetUnlinkedBlocks() const {
+        return unlinked;
+    }
+    // Slots with data which is not valid for the fields
+    int GetRejectedSlots() const {
+        return rejected;
+    }
+    // Slots with copies of the records of the table or of the recovered records
+    int GetDuplicateSlots() const {
+        return duplicated;
+    }
+
+  private:
+    bool duplicates = false;
+    String error;
+    Vector<ParadoxRecoveredRecord> records;
+    int blockcount = 0;
+    int unlinked = 0;
+    int rejected = 0;
+    int duplicated = 0;
+
+    static bool IsValid(const ParadoxSession &px, const char *record);
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
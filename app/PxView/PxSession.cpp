@@ -1,10 +1,52 @@
 #include "PxSession.h"
+#include "PxFilter.h"
+#include "PxSql.h"
+
+extern "C" {
+#include "lib/paradox-mp.h"
+}
 
 using namespace Upp;
 
+bool ParadoxSession::memprofile = false;
+
+static constexpr int MaxDate = 3652059; // NOLINT: days of 31.12.9999
+static constexpr int DayMsecs = 86400000; // NOLINT: milliseconds of a day
+
+// Integers are big-endian with the sign bit flipped
+static int64 sGetInteger(const char *p, int width) {
+    int bits = 8 * width; // NOLINT: bits of the field
+    uint64 u = 0;
+    for (int i = 0; i < width; ++i) {
+        u = (u << 8) | byte(p[i]); // NOLINT: big-endian
+    }
+    u ^= uint64(1) << (bits - 1);
+    return int64(u << (64 - bits)) >> (64 - bits); // NOLINT: sign extension
+}
+
+// Doubles have the sign bit flipped, negative ones have all bits inverted
+static double sGetDouble(const char *p) {
+    uint64 u = 0;
+    for (int i = 0; i < 8; ++i) {  // NOLINT: size of double
+        u = (u << 8) | byte(p[i]); // NOLINT: big-endian
+    }
+    u = (u & 0x8000000000000000ULL) ? u ^ 0x8000000000000000ULL : ~u; // NOLINT: sign bit
+    double x = 0;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
 ParadoxSession::ParadoxSession() {
     PX_boot();
-    pxdoc = PX_new2(ErrorHandler, nullptr, nullptr, nullptr); // NOLINT: cppcoreguidelines-prefer-member-initializer
+    pxdoc = NewDocument(); // NOLINT: cppcoreguidelines-prefer-member-initializer
+}
+
+pxdoc_t *ParadoxSession::NewDocument() {
+    if (memprofile) {
+        return PX_new2(ErrorHandler, PX_mp_malloc, PX_mp_realloc, PX_mp_free);
+    }
+    // temporary memory of the decoding is taken from the arena of the document
+    return PX_new2(ErrorHandler, PX_arena_malloc, PX_arena_realloc, PX_arena_free);
 }
 
 ParadoxSession::~ParadoxSession() {
@@ -14,18 +56,184 @@ ParadoxSession::~ParadoxSession() {
 
 bool ParadoxSession::Open(const char *filename) {
     filepath = filename;
+    directory = GetFileFolder(filepath);
 
-    if (0 == PX_open_file(pxdoc, filepath)) {
-        open = true;
-        blobfilepath = AppendFileName(Upp::GetFileDirectory(filename), Upp::GetFileTitle(filename) + ".mb");
-        // TODO: check proper work with the blob file
-        // if (FileExists(blobfilepath) && (0 > PX_set_blob_file(pxdoc, blobfilepath))) {
-        //	ErrorOK(Format("%s: %s", t_("Could not open blob file"), DeQtf(blobfilepath)));
-        //	return false;
-        //}
-        return true;
+    // a journal left by an interrupted commit is written to the file first
+    PX_replay_journal(pxdoc, filepath, GetJournalPath());
+
+    return OpenFile();
+}
+
+bool ParadoxSession::OpenFile() {
+    ResetStatistics();
+    int64 start = usecs();
+    if (0 != PX_open_file(pxdoc, filepath)) {
+        return false;
+    }
+    AddTime(PhaseOpen, usecs(start));
+    open = true;
+    tablecharset = CharsetByName(GetCharsetName());
+    BuildFieldIndex();
+    InvalidateBlocks();
+    // blob file is opened by OpenBlobFile() with the first read of blob data
+    blobfilepath = AppendFileName(Upp::GetFileDirectory(filepath), Upp::GetFileTitle(filepath) + ".mb");
+    blobfilechecked = false;
+    pending.Clear();
+    translevel = 0;
+    return !journal || 0 == PX_begin_journal(pxdoc, GetJournalPath());
+}
+
+ParadoxFileStamp ParadoxSession::ReadFileStamp(const String &path) {
+    ParadoxFileStamp stamp;
+    stamp.time = FileGetTime(path);
+    stamp.length = Upp::GetFileLength(path);
+
+    // files older than version 4 have the field types at the place of the
+    // update time, which do not change either
+    byte header[UpdateTimeOffset + 4]; // NOLINT: 32-bit time
+    FileIn in(path);
+    if (in.IsOpen() && in.GetAll(header, sizeof(header))) {
+        stamp.records = Peek32le(header + NumRecordsOffset);  // NOLINT: C code
+        stamp.updatetime = Peek32le(header + UpdateTimeOffset); // NOLINT: C code
+    }
+    return stamp;
+}
+
+bool ParadoxSession::Create(const char *filename, const Vector<ParadoxField> &fields, int codepage) {
+    if (fields.IsEmpty()) {
+        return false;
+    }
+
+    // pxlib takes the ownership of the field definitions
+    int count = fields.GetCount();
+    auto *pxf = static_cast<pxfield_t *>(pxdoc->malloc(pxdoc, count * sizeof(pxfield_t), "Allocate memory for fields."));
+    bool blobs = false;
+    for (int i = 0; i < count; ++i) {
+        const ParadoxField &f = fields[i];
+        pxf[i].px_fname = static_cast<char *>(pxdoc->malloc(pxdoc, f.name.GetCount() + 1, "Allocate memory for field name."));
+        strcpy(pxf[i].px_fname, f.name); // NOLINT: C code
+        pxf[i].px_ftype = f.type;        // NOLINT: C code
+        pxf[i].px_flen = f.length;       // NOLINT: C code
+        pxf[i].px_fdc = f.decimals;      // NOLINT: C code
+        blobs = blobs || f.type == pxfMemoBLOb || f.type == pxfFmtMemoBLOb || f.type == pxfBLOb;
+    }
+
+    if (0 != PX_create_file(pxdoc, pxf, count, filename, pxfFileTypNonIndexDB)) {
+        for (int i = 0; i < count; ++i) {
+            pxdoc->free(pxdoc, pxf[i].px_fname); // NOLINT: C code
+        }
+        pxdoc->free(pxdoc, pxf);
+        return false;
+    }
+
+    PX_set_value(pxdoc, "codepage", float(codepage));
+    PX_set_tablename(pxdoc, GetFileTitle(filename));
+    PX_write_header(pxdoc);
+
+    filepath = filename;
+    directory = GetFileFolder(filepath);
+    open = true;
+    tablecharset = CharsetByName(GetCharsetName());
+    BuildFieldIndex();
+    InvalidateBlocks();
+    blobfilepath = AppendFileName(Upp::GetFileDirectory(filename), Upp::GetFileTitle(filename) + ".mb");
+    blobfilechecked = true;
+    pending.Clear();
+    translevel = 0;
+
+    if (journal && 0 != PX_begin_journal(pxdoc, GetJournalPath())) {
+        return false;
+    }
+    return !blobs || 0 == PX_set_blob_file(pxdoc, blobfilepath);
+}
+
+ParadoxSession &ParadoxSession::Background() {
+    // the dialogs and the memory profiler belong to the main thread
+    PX_delete(pxdoc);
+    pxdoc = PX_new2(nullptr, PX_arena_malloc, PX_arena_realloc, PX_arena_free);
+    return *this;
+}
+
+bool ParadoxSession::ReadForReload(const String &path) {
+    // the journal is replayed by the session of the view only
+    filepath = path;
+    directory = GetFileFolder(filepath);
+    if (!OpenFile()) {
+        return false;
+    }
+
+    // the blocks are read to get their checksums, they are not decoded
+    Buffer<char> data(GetBlockSize());
+    for (int block = 0; block < blockindex.GetCount(); ++block) {
+        if (ReadBlock(block, ~data) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParadoxSession::Reload(ParadoxChanges &changes, ParadoxSession &next) {
+    if (!open || !next.open || next.filepath != filepath || translevel > 0 || !pending.IsEmpty()) {
+        return false;
+    }
+
+    changes.fields = false;
+    changes.oldstart = clone(blockstart);
+    changes.changed.Clear();
+    Vector<uint64> oldhash = pick(blockhash);
+    int recordsize = GetRecordSize();
+    Vector<String> fieldnames;
+    pxfield_t *pxf = PX_get_fields(pxdoc);
+    for (int i = 0; i < GetNumFields(); ++i) {
+        fieldnames.Add(Format("%s:%d:%d", pxf[i].px_fname, pxf[i].px_ftype, pxf[i].px_flen)); // NOLINT: C code
     }
-    return false;
+
+    // pxlib cannot read the header of an open file again, the document read
+    // by the other session is taken and the old one is closed; its memory is
+    // not profiled
+    Swap(pxdoc, next.pxdoc);
+    PX_delete(next.pxdoc);
+    next.pxdoc = NewDocument();
+    next.open = false;
+    pxdoc->errorhandler = ErrorHandler;
+
+    ResetStatistics();
+    tablecharset = CharsetByName(GetCharsetName());
+    BuildFieldIndex();
+    InvalidateBlocks();
+    blockhash = pick(next.blockhash);
+    blockhash.SetCount(blockindex.GetCount(), 0);
+    // a change of the file while the blocks were read is found by the next check
+    filestamp = next.filestamp;
+    blobfilechecked = false;
+    if (journal && 0 != PX_begin_journal(pxdoc, GetJournalPath())) {
+        journal = false;
+    }
+
+    pxf = PX_get_fields(pxdoc);
+    changes.fields = recordsize != GetRecordSize() || fieldnames.GetCount() != GetNumFields();
+    for (int i = 0; !changes.fields && i < GetNumFields(); ++i) {
+        changes.fields = fieldnames[i] != Format("%s:%d:%d", pxf[i].px_fname, pxf[i].px_ftype, pxf[i].px_flen); // NOLINT: C code
+    }
+    for (int block = 0; block < blockindex.GetCount(); ++block) {
+        if (changes.fields || block >= oldhash.GetCount() || oldhash[block] == 0 || blockhash[block] == 0 ||
+            oldhash[block] != blockhash[block]) {
+            changes.changed.Add(block);
+        }
+    }
+    return true;
+}
+
+ParadoxSession &ParadoxSession::Journal(bool b) {
+    if (open && b != journal) {
+        if (b) {
+            b = 0 == PX_begin_journal(pxdoc, GetJournalPath());
+        } else {
+            PX_end_journal(pxdoc);
+        }
+    }
+    journal = b;
+    return *this;
 }
 
 dword ParadoxSession::GetInfoType(char px_ftype) {
@@ -99,349 +307,1062 @@ Vector<SqlColumnInfo> ParadoxSession::EnumColumns(String database, String table)
 // NOLINTNEXTLINE
 Vector<String> ParadoxSession::EnumTables(String database) {
     Vector<String> out;
-    out.Add(GetTableName());
+    String dir = IsNull(database) ? directory : database;
+
+    for (FindFile ff(AppendFileName(dir, "*")); ff; ff.Next()) {
+        if (ff.IsFile() && ToLower(GetFileExt(ff.GetName())) == ".db") {
+            out.Add(GetFileTitle(ff.GetName()));
+        }
+    }
+
     return out;
 }
 
-Vector<Value> ParadoxSession::GetRow(int row, byte charset) {
-    Vector<Value> record;
+String ParadoxSession::FindTable(const String &table) const {
+    String title = ToUpper(GetFileTitle(table));
 
-    if (row < 0 || row > GetNumRecords()) {
-        return record;
+    for (FindFile ff(AppendFileName(directory, "*")); ff; ff.Next()) {
+        if (ff.IsFile() && ToLower(GetFileExt(ff.GetName())) == ".db" && ToUpper(GetFileTitle(ff.GetName())) == title) {
+            return ff.GetPath();
+        }
     }
 
-    pxdatablockinfo_t pxdbinfo;
-    int isdeleted = 0; // TODO: allow option to select deleted data
-    int recordsize = PX_get_recordsize(pxdoc);
+    return Null;
+}
 
-    StringBuffer data(recordsize);
-    if (nullptr == PX_get_record2(pxdoc, row, data, &isdeleted, &pxdbinfo)) {
-        return record;
+SqlConnection *ParadoxSession::CreateConnection() {
+    return new ParadoxConnection(*this);
+}
+
+void ParadoxSession::BuildBlockIndex() {
+    blockindex.Clear();
+    blockstart.Clear();
+    blockhash.Clear();
+
+    auto *pindex = static_cast<pxpindex_t *>(pxdoc->px_indexdata);
+    if (nullptr == pindex) {
+        return;
     }
 
-    int offset = 0;
-    pxfield_t *pxf = PX_get_fields(pxdoc);
-    byte codepage = CharsetByName(GetCharsetName());
-    if (charset > 0) {
-        codepage = charset;
+    int64 start = usecs();
+    int numrecords = 0;
+    for (int i = 0; i < pxdoc->px_indexdatalen; ++i) {
+        // NOLINTNEXTLINE: C code
+        if (pindex[i].level == 1) {
+            blockindex.Add(i);
+            blockstart.Add(numrecords);
+            numrecords += pindex[i].numrecords; // NOLINT: C code
+        }
     }
+    blockhash.SetCount(blockindex.GetCount(), 0);
+    AddTime(PhaseIndex, usecs(start));
+}
 
-    for (int i = 0; i < PX_get_num_fields(pxdoc); ++i) {
-        Value val;
-        switch (pxf->px_ftype) {
-        case pxfAlpha: {
-            char *value = nullptr;
-            if (0 < PX_get_data_alpha(pxdoc, &data[offset], pxf->px_flen, &value)) {
-                val = Upp::ToUnicode(value, codepage);
-                pxdoc->free(pxdoc, value);
+void ParadoxSession::ResetStatistics() {
+    memset(&pxdoc->px_stats, 0, sizeof(pxstats_t));
+    memset(phasetime, 0, sizeof(phasetime));
+    memset(decodedfields, 0, sizeof(decodedfields));
+    decodedrecords = 0;
+    skippedblocks = 0;
+}
+
+int ParadoxSession::ReadBlock(int block, char *data) {
+    if (block < 0 || block >= blockindex.GetCount()) {
+        return -1;
+    }
+
+    // modified records of the running transaction
+    int q = pending.Find(block);
+    if (q >= 0) {
+        memcpy(data, ~pending[q].data, pending[q].count * PX_get_recordsize(pxdoc));
+        return pending[q].count;
+    }
+
+    pxdatablockinfo_t pxdbinfo;
+    int count = PX_get_datablock(pxdoc, blockindex[block], data, &pxdbinfo);
+    if (count >= 0) {
+        blockhash[block] = MakeBlockHash(data, count * PX_get_recordsize(pxdoc));
+    }
+    return count;
+}
+
+int ParadoxSession::GetBlockNumber(int block) const {
+    if (block < 0 || block >= blockindex.GetCount()) {
+        return -1;
+    }
+    auto *pindex = static_cast<pxpindex_t *>(pxdoc->px_indexdata);
+    return pindex[blockindex[block]].blocknumber; // NOLINT: C code
+}
+
+int ParadoxSession::GetFileBlockCount() const {
+    int64 size = Upp::GetFileLength(filepath) - GetHeaderSize();
+    int blocksize = GetBlockSize();
+    return (size > 0 && blocksize > 0) ? int(size / blocksize) : 0;
+}
+
+int ParadoxSession::ReadRawBlock(int number, char *data, pxdatablockinfo_t &info) {
+    info.numrecords = -1;
+    return PX_get_rawdatablock(pxdoc, number, data, &info);
+}
+
+bool ParadoxSession::ProcessBlocks(int from, int to, int threads, Gate<int, char *> read,
+                                   Event<int, int, const char *> process, Gate<int, int> progress) {
+    // the blocks of a round are read at once
+    int n = max(threads, 1);
+    int round = n * RoundBlocks;
+    int blocksize = GetBlockSize();
+    Buffer<char> data(round * blocksize);
+    for (int first = from; first < to; first += round) {
+        if (progress && progress(first - from, to - from)) {
+            return false;
+        }
+
+        int last = min(to, first + round);
+        for (int number = first; number < last; ++number) {
+            if (!read(number, ~data + (number - first) * blocksize)) { // NOLINT: C code
+                return false;
             }
-            record.Add(val);
-            break;
-        }
-        case pxfDate: {
-            long value = 0;
-            if (0 < PX_get_data_long(pxdoc, &data[offset], pxf->px_flen, &value)) {
-                Date d;
-                if (value > 0) {
-                    char const *fmt = "d/m/Y";
-                    // NOLINTNEXTLINE: date calculation
-                    char *str = PX_timestamp2string(pxdoc, (double)value * 1000.0 * 86400.0, fmt);
-                    StrToDate("dmy", d, str, Date(1900, 1, 1)); // NOLINT: default date
-                    pxdoc->free(pxdoc, str);
+        }
+
+        CoWork co;
+        for (int t = 0; t < n && first + t * RoundBlocks < last; ++t) {
+            int start = first + t * RoundBlocks;
+            int end = min(last, start + RoundBlocks);
+            co & [=, &process, &data] {
+                for (int number = start; number < end; ++number) {
+                    process(t, number, ~data + (number - first) * blocksize); // NOLINT: C code
                 }
-                val = d;
-            }
-            record.Add(val);
-            break;
+            };
         }
-        case pxfShort: {
-            short int value = 0;
-            if (0 < PX_get_data_short(pxdoc, &data[offset], pxf->px_flen, &value)) {
-                val = value;
-            }
-            record.Add(val);
-            break;
-        }
-        case pxfAutoInc:
-        case pxfLong: {
-            long value = 0;
-            if (0 < PX_get_data_long(pxdoc, &data[offset], pxf->px_flen, &value)) {
-                val = (int)value;
-            }
-            record.Add(val);
-            break;
-        }
-        case pxfTimestamp: {
-            double value = 0.0;
-            if (0 < PX_get_data_double(pxdoc, &data[offset], pxf->px_flen, &value)) {
-                char const *fmt = "d/m/Y H:i:s";
-                char *str = PX_timestamp2string(pxdoc, value, fmt);
-                Time t;
-                StrToTime("dmy", t, str);
-                val = t;
-                pxdoc->free(pxdoc, str);
-            }
-            record.Add(val);
-            break;
-        }
-        case pxfTime: {
-            long value = 0;
-            if (0 < PX_get_data_long(pxdoc, &data[offset], pxf->px_flen, &value)) {
-                char const *fmt = "H:i:s";
-                char *str = PX_timestamp2string(pxdoc, (double)value, fmt);
-                val = str;
-                pxdoc->free(pxdoc, str);
-            }
-            record.Add(val);
-            break;
-        }
-        case pxfCurrency:
-        case pxfNumber: {
-            double value = 0.0;
-            if (0 < PX_get_data_double(pxdoc, &data[offset], pxf->px_flen, &value)) {
-                val = value;
-            }
-            record.Add(val);
-            break;
-        }
-        case pxfLogical: {
-            char value = 0;
-            val = false;
-            if (0 < PX_get_data_byte(pxdoc, &data[offset], pxf->px_flen, &value)) {
-                if (value > 0) {
-                    val = true;
+        co.Finish();
+    }
+    return true;
+}
+
+uint64 ParadoxSession::Hash(const char *data, int size, uint64 seed) {
+    uint64 h = 0xcbf29ce484222325ULL ^ seed; // NOLINT: FNV offset basis
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        h = (h ^ Peek64le(data + i)) * 0x100000001b3ULL; // NOLINT: FNV prime
+    }
+    for (; i < size; ++i) {
+        h = (h ^ byte(data[i])) * 0x100000001b3ULL; // NOLINT: FNV prime
+    }
+    h ^= h >> 33;               // NOLINT: fmix64
+    h *= 0xff51afd7ed558ccdULL; // NOLINT: fmix64
+    h ^= h >> 33;               // NOLINT: fmix64
+    h *= 0xc4ceb9fe1a85ec53ULL; // NOLINT: fmix64
+    h ^= h >> 33;               // NOLINT: fmix64
+    return h;
+}
+
+uint64 ParadoxSession::MakeBlockHash(const char *data, int size) {
+    // the size makes a block with fewer records different
+    uint64 h = Hash(data, size, uint64(size));
+    // 0 means a block which was not read
+    return h != 0 ? h : 1;
+}
+
+const char *ParadoxSession::GetRecordData(int row) {
+    if (row < 0 || row >= GetNumRecords()) {
+        return nullptr;
+    }
+
+    int block = FindUpperBound(blockstart, row) - 1;
+    if (block < 0) {
+        return nullptr;
+    }
+
+    if (block != blockdatanr) {
+        blockdata.Alloc(GetBlockSize());
+        blockdatacount = ReadBlock(block, ~blockdata);
+        blockdatanr = blockdatacount < 0 ? -1 : block;
+    }
+
+    int slot = row - blockstart[block];
+    if (blockdatanr < 0 || slot >= blockdatacount) {
+        return nullptr;
+    }
+
+    return ~blockdata + slot * PX_get_recordsize(pxdoc); // NOLINT: C code
+}
+
+bool ParadoxSession::Scan(Function<bool(int, const char *)> record) {
+    int recordsize = PX_get_recordsize(pxdoc);
+    Buffer<char> data(GetBlockSize());
+
+    // the memory decoded from one block is reused for the next one
+    PX_arena_begin(pxdoc);
+    bool ok = true;
+    for (int block = 0; ok && block < blockindex.GetCount(); ++block) {
+        int count = ReadBlock(block, ~data);
+        if (count < 0) {
+            PX_arena_end(pxdoc);
+            return false;
+        }
+        int64 start = usecs();
+        for (int i = 0; ok && i < count; ++i) {
+            ok = record(blockstart[block] + i, ~data + i * recordsize); // NOLINT: C code
+        }
+        AddTime(PhaseScan, usecs(start));
+        PX_arena_reset(pxdoc);
+    }
+    PX_arena_end(pxdoc);
+
+    return true;
+}
+
+void ParadoxSession::BuildZone(ParadoxBlockZone &zone, const char *data, int count) {
+    int recordsize = PX_get_recordsize(pxdoc);
+    int numfields = PX_get_num_fields(pxdoc);
+    pxfield_t *fields = PX_get_fields(pxdoc);
+
+    zone.minimum.Alloc(recordsize, 0);
+    zone.maximum.Alloc(recordsize, 0);
+    zone.flags.Clear();
+    zone.flags.SetCount(numfields, 0);
+    for (int f = 0; f < numfields; ++f) {
+        int offset = fieldoffset[f];
+        int length = fields[f].px_flen; // NOLINT: C code
+        bool alpha = fields[f].px_ftype == pxfAlpha; // NOLINT: C code
+        bool blob = IsBlobField(f);
+        byte &flags = zone.flags[f];
+        char *minimum = ~zone.minimum + offset; // NOLINT: C code
+        char *maximum = ~zone.maximum + offset; // NOLINT: C code
+
+        for (int i = 0; i < count; ++i) {
+            const char *p = data + i * recordsize + offset; // NOLINT: C code
+
+            // the empty values are the same as in ParadoxFilter
+            bool null = true;
+            if (alpha) {
+                null = p[0] == '\0'; // NOLINT: C code
+            } else if (blob) {
+                null = length < 10 || Peek32le(p + length - 10 + 4) == 0; // NOLINT: blob pointer size
+            } else {
+                for (int j = 0; null && j < length; ++j) {
+                    null = p[j] == '\0'; // NOLINT: C code
                 }
             }
-            record.Add(val);
-            break;
-        }
-        case pxfGraphic:
-        case pxfBLOb:
-        case pxfFmtMemoBLOb:
-        case pxfMemoBLOb:
-        case pxfOLE: {
-            char *blobdata = nullptr;
-            int mod_nr = 0;
-            int size = 0;
-            int ret = 0;
-
-            if (pxf->px_ftype == pxfGraphic) {
-                ret = PX_get_data_graphic(pxdoc, &data[offset], pxf->px_flen, &mod_nr, &size, &blobdata);
-            } else {
-                ret = PX_get_data_blob(pxdoc, &data[offset], pxf->px_flen, &mod_nr, &size, &blobdata);
+            if (null) {
+                flags |= ParadoxBlockZone::NULLS;
+                continue;
             }
 
-            if ((ret > 0) && (blobdata != nullptr)) {
-                if (pxf->px_ftype == pxfFmtMemoBLOb || pxf->px_ftype == pxfMemoBLOb) {
-                    String out(blobdata, size);
-                    val = Upp::ToUnicode(out, codepage);
-                } else {
-                    String blobprefix = GetTableName();
-                    String blobextension = "blob";
-                    String filename = Format("%s_%d.%s", blobprefix, mod_nr, blobextension);
-                    val = filename;
-                }
-                pxdoc->free(pxdoc, blobdata);
+            // blob data are not compared, only their presence is kept
+            if (blob) {
+                flags |= ParadoxBlockZone::VALUES;
+            } else if (!(flags & ParadoxBlockZone::VALUES)) {
+                memcpy(minimum, p, length);
+                memcpy(maximum, p, length);
+                flags |= ParadoxBlockZone::VALUES;
+            } else if (memcmp(p, minimum, length) < 0) {
+                memcpy(minimum, p, length);
+            } else if (memcmp(p, maximum, length) > 0) {
+                memcpy(maximum, p, length);
             }
-            record.Add(val);
-            break;
         }
-        case pxfBytes: {
-            char value = 0;
-            if (0 < PX_get_data_byte(pxdoc, &data[offset], pxf->px_fdc, &value)) {
-                val = value;
-            }
-            record.Add(val);
-            break;
+    }
+    zone.valid = true;
+}
+
+bool ParadoxSession::Scan(const ParadoxFilter &filter, Function<bool(int, const char *)> record) {
+    Vector<int> blocks;
+    for (int block = 0; block < blockindex.GetCount(); ++block) {
+        blocks.Add(block);
+    }
+    return Scan(filter, blocks, record);
+}
+
+bool ParadoxSession::Scan(const ParadoxFilter &filter, const Vector<int> &blocks, Function<bool(int, const char *)> record) {
+    int recordsize = PX_get_recordsize(pxdoc);
+    Buffer<char> data(GetBlockSize());
+
+    if (zones.GetCount() != blockindex.GetCount()) {
+        zones.Clear();
+        zones.SetCount(blockindex.GetCount());
+    }
+
+    PX_arena_begin(pxdoc);
+    bool ok = true;
+    for (int n = 0; ok && n < blocks.GetCount(); ++n) {
+        int block = blocks[n];
+        if (block < 0 || block >= blockindex.GetCount()) {
+            continue;
         }
-        case pxfBCD: {
-            char *value = nullptr;
-            // NOLINTNEXTLINE: C code
-            if (0 < PX_get_data_bcd(pxdoc, (unsigned char *)&data[offset], pxf->px_fdc, &value)) {
-                val = value;
-                pxdoc->free(pxdoc, value);
-            }
-            record.Add(val);
-            break;
+        ParadoxBlockZone &zone = zones[block];
+        if (zone.valid && !filter.MatchZone(zone)) {
+            ++skippedblocks;
+            continue;
         }
-        default:
-            record.Add(val);
-            break;
+
+        int count = ReadBlock(block, ~data);
+        if (count < 0) {
+            PX_arena_end(pxdoc);
+            return false;
+        }
+        if (!zone.valid) {
+            BuildZone(zone, ~data, count);
         }
+        int64 start = usecs();
+        for (int i = 0; ok && i < count; ++i) {
+            const char *rec = ~data + i * recordsize; // NOLINT: C code
+            if (filter.Match(rec)) {
+                ok = record(blockstart[block] + i, rec);
+            }
+        }
+        AddTime(PhaseScan, usecs(start));
+        PX_arena_reset(pxdoc);
+    }
+    PX_arena_end(pxdoc);
+
+    return true;
+}
+
+Vector<int> ParadoxSession::Select(const ParadoxFilter &filter) {
+    Vector<int> rows;
+
+    Scan(filter, [&](int row, const char *) {
+        rows.Add(row);
+        return true;
+    });
+
+    return rows;
+}
+
+void ParadoxSession::BuildFieldIndex() {
+    fieldoffset.Clear();
+
+    int offset = 0;
+    pxfield_t *pxf = PX_get_fields(pxdoc);
+    for (int i = 0; i < PX_get_num_fields(pxdoc); ++i) {
+        fieldoffset.Add(offset);
         offset += pxf->px_flen;
         ++pxf; // NOLINT: C code
     }
-    return record;
 }
 
-bool ParadoxSession::DelRow(int row) {
-    if (row < 0 || row > GetNumRecords()) {
-        return false;
-    }
+Vector<Value> ParadoxSession::GetRow(int row, byte charset) {
+    const char *data = GetRecordData(row);
 
-    pxdatablockinfo_t pxdbinfo;
-    int isdeleted = 0;
-    int recordsize = PX_get_recordsize(pxdoc);
+    if (nullptr == data) {
+        return {};
+    }
 
-    StringBuffer data(recordsize);
-    if (nullptr == PX_get_record2(pxdoc, row, data, &isdeleted, &pxdbinfo)) {
-        return false;
+    Vector<Value> record = DecodeRecord(data, charset);
+    String text;
+    for (int i = 0; !lazyblobs && !pending.IsEmpty() && i < record.GetCount(); ++i) {
+        if (GetPendingBlob(row, i, text)) {
+            record[i] = Upp::ToUnicode(text, GetCharset(charset));
+        }
     }
+    return record;
+}
+
+Vector<Value> ParadoxSession::GetRow(int row, const Vector<int> &fields, byte charset) {
+    const char *data = GetRecordData(row);
 
-    bool result = false;
-    int ret = PX_delete_record(pxdoc, row);
-    if (ret > -1) {
-        result = true;
+    if (nullptr == data) {
+        return {};
     }
 
-    return result;
+    Vector<Value> record = DecodeRecord(data, fields, charset);
+    String text;
+    for (int i = 0; !lazyblobs && !pending.IsEmpty() && i < record.GetCount(); ++i) {
+        if (GetPendingBlob(row, fields[i], text)) {
+            record[i] = Upp::ToUnicode(text, GetCharset(charset));
+        }
+    }
+    return record;
 }
 
-bool ParadoxSession::SetRowCol(int row, int col, const Value &value) {
-    if (col >= PX_get_num_fields(pxdoc) || row < 0 || row > GetNumRecords()) {
-        return false;
+Vector<Value> ParadoxSession::DecodeRecord(const char *data, byte charset) {
+    Vector<Value> record;
+    byte codepage = GetCharset(charset);
+
+    // memory of the decoded values is reused by the next record
+    PX_arena_begin(pxdoc);
+    for (int i = 0; i < fieldoffset.GetCount(); ++i) {
+        record.Add(DecodeField(data, i, codepage));
     }
+    PX_arena_end(pxdoc);
+    ++decodedrecords;
+    return record;
+}
 
-    pxdatablockinfo_t pxdbinfo;
-    int isdeleted = 0;
-    int recordsize = PX_get_recordsize(pxdoc);
+Vector<Value> ParadoxSession::DecodeRecord(const char *data, const Vector<int> &fields, byte charset) {
+    Vector<Value> record;
+    byte codepage = GetCharset(charset);
 
-    StringBuffer data(recordsize);
+    // memory of the decoded values is reused by the next record
+    PX_arena_begin(pxdoc);
+    for (int field : fields) {
+        record.Add(DecodeField(data, field, codepage));
+    }
+    PX_arena_end(pxdoc);
+    ++decodedrecords;
+    return record;
+}
 
-    if (nullptr == PX_get_record2(pxdoc, row, data, &isdeleted, &pxdbinfo)) {
-        return false;
+Value ParadoxSession::DecodeField(const char *data, int field, byte codepage) {
+    Value val;
+
+    if (field < 0 || field >= fieldoffset.GetCount()) {
+        return val;
     }
 
-    bool result = false;
-    int offset = 0;
-    pxfield_t *pxf = PX_get_fields(pxdoc);
-    byte codepage = CharsetByName(GetCharsetName());
+    // other fields are skipped by their offset only
+    pxfield_t *pxf = PX_get_fields(pxdoc) + field;             // NOLINT: C code
+    auto *rec = const_cast<char *>(data) + fieldoffset[field]; // NOLINT: C code does not use const
 
-    for (int i = 0; i < PX_get_num_fields(pxdoc); ++i) {
-        if (i < col) {
-            offset += pxf->px_flen;
-            ++pxf; // NOLINT: C code
-            continue;
+    if (pxf->px_ftype >= 0 && pxf->px_ftype <= pxfBytes) {
+        ++decodedfields[int(pxf->px_ftype)];
+    }
+
+    switch (pxf->px_ftype) {
+    case pxfAlpha: {
+        char *value = nullptr;
+        if (0 < PX_get_data_alpha(pxdoc, rec, pxf->px_flen, &value)) {
+            val = Upp::ToUnicode(value, codepage);
+            pxdoc->free(pxdoc, value);
         }
-        if (i > col) {
-            break;
+        break;
+    }
+    case pxfDate: {
+        long value = 0;
+        if (0 < PX_get_data_long(pxdoc, rec, pxf->px_flen, &value)) {
+            Date d;
+            if (value > 0) {
+                char const *fmt = "d/m/Y";
+                // NOLINTNEXTLINE: date calculation
+                char *str = PX_timestamp2string(pxdoc, (double)value * 1000.0 * 86400.0, fmt);
+                StrToDate("dmy", d, str, Date(1900, 1, 1)); // NOLINT: default date
+                pxdoc->free(pxdoc, str);
+            }
+            val = d;
         }
-
-        switch (pxf->px_ftype) {
-        case pxfAlpha: {
-            String val = Upp::FromUnicode((WString)value, codepage);
-            PX_put_data_alpha(pxdoc, &data[offset], pxf->px_flen, StringBuffer(val).Begin());
-            break;
+        break;
+    }
+    case pxfShort: {
+        short int value = 0;
+        if (0 < PX_get_data_short(pxdoc, rec, pxf->px_flen, &value)) {
+            val = value;
         }
-        case pxfDate: {
-            Date date;
-            if (value.GetType() == DATE_V) {
-                date = value;
-            } else {
-                date = ScanDate(value.ToString());
+        break;
+    }
+    case pxfAutoInc:
+    case pxfLong: {
+        long value = 0;
+        if (0 < PX_get_data_long(pxdoc, rec, pxf->px_flen, &value)) {
+            val = (int)value;
+        }
+        break;
+    }
+    case pxfTimestamp: {
+        double value = 0.0;
+        if (0 < PX_get_data_double(pxdoc, rec, pxf->px_flen, &value)) {
+            char const *fmt = "d/m/Y H:i:s";
+            char *str = PX_timestamp2string(pxdoc, value, fmt);
+            Time t;
+            StrToTime("dmy", t, str);
+            val = t;
+            pxdoc->free(pxdoc, str);
+        }
+        break;
+    }
+    case pxfTime: {
+        long value = 0;
+        if (0 < PX_get_data_long(pxdoc, rec, pxf->px_flen, &value)) {
+            char const *fmt = "H:i:s";
+            char *str = PX_timestamp2string(pxdoc, (double)value, fmt);
+            val = str;
+            pxdoc->free(pxdoc, str);
+        }
+        break;
+    }
+    case pxfCurrency:
+    case pxfNumber: {
+        double value = 0.0;
+        if (0 < PX_get_data_double(pxdoc, rec, pxf->px_flen, &value)) {
+            val = value;
+        }
+        break;
+    }
+    case pxfLogical: {
+        char value = 0;
+        val = false;
+        if (0 < PX_get_data_byte(pxdoc, rec, pxf->px_flen, &value)) {
+            if (value > 0) {
+                val = true;
             }
-            long val = PX_GregorianToSdn(date.year, date.month, date.day) - CalendarsDiff;
-            PX_put_data_long(pxdoc, &data[offset], len4, val);
-            break;
-        }
-        case pxfShort: {
-            int rec = 0;
-            if (value.GetType() == INT_V) {
-                rec = value;
-            } else {
-                rec = ScanInt(value.ToString());
+        }
+        break;
+    }
+    case pxfGraphic:
+    case pxfBLOb:
+    case pxfFmtMemoBLOb:
+    case pxfMemoBLOb:
+    case pxfOLE: {
+        if (lazyblobs) {
+            // size of the blob data is stored behind the pointer to the blob file
+            const int leader = pxf->px_flen - 10; // NOLINT: blob pointer size
+            int size = leader < 0 ? 0 : Peek32le(rec + leader + 4); // NOLINT: C code
+            if (size > 0) {
+                val = size;
             }
-            PX_put_data_short(pxdoc, &data[offset], len2, short(rec));
-            break;
-        }
-        case pxfAutoInc:
-        case pxfLong: {
-            int rec = 0;
-            if (value.GetType() == INT_V) {
-                rec = value;
-            } else {
-                rec = ScanInt(value.ToString());
+        } else {
+            val = ReadBlob(data, field, codepage);
+        }
+        break;
+    }
+    case pxfBytes: {
+        char value = 0;
+        if (0 < PX_get_data_byte(pxdoc, rec, pxf->px_fdc, &value)) {
+            val = value;
+        }
+        break;
+    }
+    case pxfBCD: {
+        char *value = nullptr;
+        // NOLINTNEXTLINE: C code
+        if (0 < PX_get_data_bcd(pxdoc, (unsigned char *)rec, pxf->px_fdc, &value)) {
+            val = value;
+            pxdoc->free(pxdoc, value);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return val;
+}
+
+Value ParadoxSession::ReadBlob(const char *data, int field, byte codepage) {
+    Value val;
+
+    if (!IsBlobField(field)) {
+        return val;
+    }
+
+    pxfield_t *pxf = PX_get_fields(pxdoc) + field;             // NOLINT: C code
+    auto *rec = const_cast<char *>(data) + fieldoffset[field]; // NOLINT: C code does not use const
+
+    // size and modification number of the blob are stored behind the pointer to the blob file
+    const int leader = pxf->px_flen - 10; // NOLINT: blob pointer size
+    if (leader < 0 || Peek32le(rec + leader + 4) <= 0) { // NOLINT: C code
+        return val;
+    }
+
+    if (pxf->px_ftype != pxfFmtMemoBLOb && pxf->px_ftype != pxfMemoBLOb) {
+        // binary data are shown as a file name only, so they are not read at all
+        return GetBlobName(data, field);
+    }
+
+    // data bigger than the leader are stored in the blob file, a value of
+    // the transaction is not there yet
+    if (Peek32le(rec + leader + 4) > leader) { // NOLINT: C code
+        if (Peek32le(rec + leader) == 0) {     // NOLINT: C code
+            return val;
+        }
+        OpenBlobFile();
+    }
+
+    char *blobdata = nullptr;
+    int mod_nr = 0;
+    int size = 0;
+
+    if (0 < PX_get_data_blob(pxdoc, rec, pxf->px_flen, &mod_nr, &size, &blobdata) && blobdata != nullptr) {
+        String out(blobdata, size);
+        val = Upp::ToUnicode(out, codepage);
+        pxdoc->free(pxdoc, blobdata);
+    }
+
+    return val;
+}
+
+Value ParadoxSession::GetBlob(int row, int col, byte charset) {
+    const char *data = GetRecordData(row);
+
+    if (nullptr == data) {
+        return {};
+    }
+
+    byte codepage = GetCharset(charset);
+    String text;
+    if (GetPendingBlob(row, col, text)) {
+        return Upp::ToUnicode(text, codepage);
+    }
+    return IsBlobField(col) ? ReadBlob(data, col, codepage) : DecodeField(data, col, codepage);
+}
+
+char ParadoxSession::GetFieldType(int col) const {
+    if (col < 0 || col >= PX_get_num_fields(pxdoc)) {
+        return 0;
+    }
+    return PX_get_fields(pxdoc)[col].px_ftype; // NOLINT: C code
+}
+
+bool ParadoxSession::IsBlobField(int col) const {
+    if (col < 0 || col >= PX_get_num_fields(pxdoc)) {
+        return false;
+    }
+
+    switch (PX_get_fields(pxdoc)[col].px_ftype) { // NOLINT: C code
+    case pxfMemoBLOb:
+    case pxfBLOb:
+    case pxfFmtMemoBLOb:
+    case pxfOLE:
+    case pxfGraphic:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool ParadoxSession::IsValidData(const char *data, int col) const {
+    if (col < 0 || col >= fieldoffset.GetCount()) {
+        return false;
+    }
+    const pxfield_t &f = PX_get_fields(pxdoc)[col]; // NOLINT: C code
+    const char *p = data + fieldoffset[col];        // NOLINT: C code
+    int width = f.px_flen;
+
+    bool null = true;
+    for (int i = 0; null && i < width; ++i) {
+        null = p[i] == '\0'; // NOLINT: C code
+    }
+    if (null) {
+        return true;
+    }
+
+    if (IsBlobField(col)) {
+        // the size of the data is behind the pointer to the blob file
+        return width >= 10 && Peek32le(p + width - 10 + 4) >= 0; // NOLINT: blob pointer size
+    }
+
+    switch (f.px_ftype) {
+    case pxfAlpha: {
+        // the text is padded by zeros and has no control characters
+        int i = 0;
+        for (; i < width && p[i] != '\0'; ++i) {
+            if (byte(p[i]) < ' ' && p[i] != '\t') { // NOLINT: C code
+                return false;
             }
-            PX_put_data_long(pxdoc, &data[offset], len4, rec);
-            break;
         }
-        case pxfTimestamp: {
-            Time t;
-            if (value.GetType() == TIME_V) {
-                t = value;
-            } else {
-                t = ScanTime(value.ToString());
+        for (; i < width; ++i) {
+            if (p[i] != '\0') { // NOLINT: C code
+                return false;
             }
-            long val = PX_GregorianToSdn(t.year, t.month, t.day) - CalendarsDiff;
-            // NOLINTNEXTLINE: t calculation
-            double rec = (double(val) * 86400 + t.hour * 3600 + t.minute * 60 + t.second) * 1000.0;
-            PX_put_data_double(pxdoc, &data[offset], len8, rec);
-            break;
         }
-        case pxfTime: {
-            Time t;
-            if (value.GetType() == TIME_V) {
-                t = value;
-            } else {
-                t = ScanTime(value.ToString());
+        return true;
+    }
+    case pxfLogical:
+        return byte(p[0]) == 0x80 || byte(p[0]) == 0x81; // NOLINT: false and true
+    case pxfAutoInc:
+        return sGetInteger(p, width) > 0;
+    case pxfDate: {
+        int64 days = sGetInteger(p, width);
+        return days > 0 && days <= MaxDate;
+    }
+    case pxfTime: {
+        int64 msecs = sGetInteger(p, width);
+        return msecs >= 0 && msecs < DayMsecs;
+    }
+    case pxfNumber:
+    case pxfCurrency:
+        return width == 8 && IsFin(sGetDouble(p)); // NOLINT: size of double
+    case pxfTimestamp: {
+        double msecs = width == 8 ? sGetDouble(p) : -1; // NOLINT: size of double
+        return IsFin(msecs) && msecs > 0 && msecs < (MaxDate + 1.0) * DayMsecs;
+    }
+    case pxfBCD:
+        // the first byte has the sign and the number of the decimals
+        return (p[0] & 0x40) && (p[0] & 0x3f) == f.px_fdc; // NOLINT: BCD header
+    default:
+        return true;
+    }
+}
+
+String ParadoxSession::GetBlobFilePath() const {
+    if (FileExists(blobfilepath)) {
+        return blobfilepath;
+    }
+
+    String mbfile = ForceExt(blobfilepath, ".MB");
+    return FileExists(mbfile) ? mbfile : String();
+}
+
+bool ParadoxSession::OpenBlobFile() {
+    if (!blobfilechecked) {
+        blobfilechecked = true;
+
+        String mbfile = GetBlobFilePath();
+        if (!IsNull(mbfile)) {
+            PX_set_blob_file(pxdoc, mbfile);
+        }
+    }
+
+    return IsBlobOpen();
+}
+
+String ParadoxSession::GetBlobName(const char *data, int field) {
+    pxfield_t *pxf = PX_get_fields(pxdoc);
+    const int leader = pxf[field].px_flen - 10; // NOLINT: blob pointer size
+    if (!IsBlobField(field) || leader < 0) {
+        return Null;
+    }
+
+    // the same blob may be pointed to by several records, the whole field
+    // data tells the blobs with the same modification number apart
+    auto add = [&](const char *rec, int f) {
+        const char *p = rec + fieldoffset[f];        // NOLINT: C code
+        const int len = pxf[f].px_flen;              // NOLINT: C code
+        int mod_nr = Peek16le(p + len - 10 + 8);     // NOLINT: blob pointer
+        return blobnames.GetAdd(mod_nr).FindAdd(String(p, len));
+    };
+
+    if (!blobnamesready) {
+        blobnamesready = true;
+        blobnames.Clear();
+        Vector<int> fields;
+        for (int i = 0; i < GetNumFields(); ++i) {
+            char type = pxf[i].px_ftype; // NOLINT: C code
+            if ((type == pxfBLOb || type == pxfOLE || type == pxfGraphic) && pxf[i].px_flen >= 10) { // NOLINT: C code
+                fields.Add(i);
             }
-            // NOLINTNEXTLINE: t calculation
-            long val = t.hour * 3600000 + t.minute * 60000 + t.second * 1000;
-            PX_put_data_long(pxdoc, &data[offset], len4, val);
-            break;
-        }
-        case pxfCurrency:
-        case pxfNumber: {
-            double rec = 0.0;
-            if (value.GetType() == DOUBLE_V) {
-                rec = value;
-            } else {
-                rec = ScanDouble(value.ToString());
+        }
+        int recordsize = PX_get_recordsize(pxdoc);
+        Buffer<char> block(GetBlockSize());
+        for (int b = 0; b < blockindex.GetCount(); ++b) {
+            int count = ReadBlock(b, ~block);
+            for (int i = 0; i < count; ++i) {
+                const char *rec = ~block + i * recordsize; // NOLINT: C code
+                for (int f : fields) {
+                    if (Peek32le(rec + fieldoffset[f] + pxf[f].px_flen - 10 + 4) > 0) { // NOLINT: blob pointer
+                        add(rec, f);
+                    }
+                }
             }
-            PX_put_data_double(pxdoc, &data[offset], len8, rec);
-            break;
         }
-        case pxfLogical: {
-            char val = 0;
-            if ((value.GetType() == BOOL_V) && (value == true)) {
+    }
+
+    const char *p = data + fieldoffset[field];  // NOLINT: C code
+    int mod_nr = Peek16le(p + leader + 8);      // NOLINT: C code
+    int n = add(data, field);
+    return n == 0 ? Format("%s_%d.blob", GetTableName(), mod_nr) : Format("%s_%d_%d.blob", GetTableName(), mod_nr, n);
+}
+
+String ParadoxSession::EncodeValue(int col, const Value &value, byte charset) {
+    if (col < 0 || col >= PX_get_num_fields(pxdoc)) {
+        return Null;
+    }
+
+    pxfield_t *pxf = PX_get_fields(pxdoc) + col; // NOLINT: C code
+    byte codepage = GetCharset(charset);
+
+    StringBuffer buffer(pxf->px_flen);
+    memset(buffer, 0, pxf->px_flen);
+    char *data = buffer;
+
+    switch (pxf->px_ftype) {
+    case pxfAlpha: {
+        String val = Upp::FromUnicode((WString)value, codepage);
+        PX_put_data_alpha(pxdoc, data, pxf->px_flen, StringBuffer(val).Begin());
+        break;
+    }
+    case pxfDate: {
+        Date date;
+        if (value.GetType() == DATE_V) {
+            date = value;
+        } else {
+            date = ScanDate(value.ToString());
+        }
+        long val = PX_GregorianToSdn(date.year, date.month, date.day) - CalendarsDiff;
+        PX_put_data_long(pxdoc, data, len4, val);
+        break;
+    }
+    case pxfShort: {
+        int rec = 0;
+        if (value.GetType() == INT_V) {
+            rec = value;
+        } else {
+            rec = ScanInt(value.ToString());
+        }
+        PX_put_data_short(pxdoc, data, len2, short(rec));
+        break;
+    }
+    case pxfAutoInc:
+    case pxfLong: {
+        int rec = 0;
+        if (value.GetType() == INT_V) {
+            rec = value;
+        } else {
+            rec = ScanInt(value.ToString());
+        }
+        PX_put_data_long(pxdoc, data, len4, rec);
+        break;
+    }
+    case pxfTimestamp: {
+        Time t;
+        if (value.GetType() == TIME_V) {
+            t = value;
+        } else {
+            t = ScanTime(value.ToString());
+        }
+        long val = PX_GregorianToSdn(t.year, t.month, t.day) - CalendarsDiff;
+        // NOLINTNEXTLINE: t calculation
+        double rec = (double(val) * 86400 + t.hour * 3600 + t.minute * 60 + t.second) * 1000.0;
+        PX_put_data_double(pxdoc, data, len8, rec);
+        break;
+    }
+    case pxfTime: {
+        Time t;
+        if (value.GetType() == TIME_V) {
+            t = value;
+        } else {
+            t = ScanTime(value.ToString());
+        }
+        // NOLINTNEXTLINE: t calculation
+        long val = t.hour * 3600000 + t.minute * 60000 + t.second * 1000;
+        PX_put_data_long(pxdoc, data, len4, val);
+        break;
+    }
+    case pxfCurrency:
+    case pxfNumber: {
+        double rec = 0.0;
+        if (value.GetType() == DOUBLE_V) {
+            rec = value;
+        } else {
+            rec = ScanDouble(value.ToString());
+        }
+        PX_put_data_double(pxdoc, data, len8, rec);
+        break;
+    }
+    case pxfLogical: {
+        char val = 0;
+        if ((value.GetType() == BOOL_V) && (value == true)) {
+            val = 1;
+        } else {
+            String str = Upp::FromUnicode((WString)value, codepage);
+            str = ToLower(TrimBoth(str));
+            if (str.IsEqual("1") || str.IsEqual("true") || str.IsEqual("t")) {
                 val = 1;
-            } else {
-                String str = Upp::FromUnicode((WString)value, codepage);
-                str = ToLower(TrimBoth(str));
-                if (str.IsEqual("1") || str.IsEqual("true") || str.IsEqual("t")) {
-                    val = 1;
-                }
             }
-            PX_put_data_byte(pxdoc, &data[offset], len1, val);
-            break;
         }
-        case pxfFmtMemoBLOb:
-        case pxfMemoBLOb: {
-            String val = Upp::FromUnicode((WString)value, codepage);
-            PX_put_data_blob(pxdoc, &data[offset], pxf->px_flen, StringBuffer(val).Begin(), val.GetCount());
-            break;
+        PX_put_data_byte(pxdoc, data, len1, val);
+        break;
+    }
+    case pxfFmtMemoBLOb:
+    case pxfMemoBLOb: {
+        String val = Upp::FromUnicode((WString)value, codepage);
+        OpenBlobFile();
+        PX_put_data_blob(pxdoc, data, pxf->px_flen, StringBuffer(val).Begin(), val.GetCount());
+        break;
+    }
+    case pxfBytes: {
+        String val = Upp::FromUnicode((WString)value, codepage);
+        PX_put_data_bytes(pxdoc, data, min(val.GetCount(), pxf->px_flen), StringBuffer(val).Begin());
+        break;
+    }
+    case pxfBCD: {
+        String val = Upp::FromUnicode((WString)value, codepage);
+        PX_put_data_bcd(pxdoc, data, pxf->px_fdc, StringBuffer(val).Begin());
+        break;
+    }
+    default:
+        break;
+    }
+
+    return String(buffer);
+}
+
+bool ParadoxSession::DelRows(const Vector<int> &rows) {
+    if (!IsOpen() || !WriteBlocks()) {
+        return false;
+    }
+
+    // the records are grouped by the data block, each block is compacted once
+    VectorMap<int, Vector<int>> blocks;
+    for (int row : rows) {
+        if (row < 0 || row >= GetNumRecords()) {
+            return false;
         }
-        case pxfBytes: {
-            String val = Upp::FromUnicode((WString)value, codepage);
-            PX_put_data_bytes(pxdoc, &data[offset], val.GetCount(), StringBuffer(val).Begin());
-            break;
+        int block = FindUpperBound(blockstart, row) - 1;
+        blocks.GetAdd(block).Add(row - blockstart[block]);
+    }
+
+    bool result = true;
+    for (int i = 0; i < blocks.GetCount(); ++i) {
+        Vector<int> &slots = blocks[i];
+        Sort(slots);
+        if (PX_delete_datablock_records(pxdoc, blockindex[blocks.GetKey(i)], slots.begin(), slots.GetCount()) < 0) {
+            result = false;
         }
-        case pxfBCD: {
-            String val = Upp::FromUnicode((WString)value, codepage);
-            PX_put_data_bcd(pxdoc, &data[offset], val.GetCount(), StringBuffer(val).Begin());
-            break;
+    }
+
+    // header of the file is written once for all blocks
+    if (PX_write_header(pxdoc) < 0 || PX_commit_journal(pxdoc) < 0) {
+        result = false;
+    }
+
+    InvalidateBlocks();
+    return result;
+}
+
+bool ParadoxSession::Pack() {
+    if (!CanPack() || !WriteBlocks()) {
+        return false;
+    }
+
+    bool result = PX_pack(pxdoc) > -1 && PX_commit_journal(pxdoc) > -1;
+    InvalidateBlocks();
+    return result;
+}
+
+bool ParadoxSession::AppendRecords(const char *data, int count) {
+    if (!IsOpen() || !WriteBlocks()) {
+        return false;
+    }
+
+    bool result = PX_append_records(pxdoc, data, count) > -1 && PX_write_header(pxdoc) > -1 &&
+                  PX_commit_journal(pxdoc) > -1;
+    InvalidateBlocks();
+    return result;
+}
+
+bool ParadoxSession::SetRowCol(int row, int col, const Value &value) {
+    if (col < 0 || col >= PX_get_num_fields(pxdoc) || row < 0 || row >= GetNumRecords()) {
+        return false;
+    }
+
+    int block = FindUpperBound(blockstart, row) - 1;
+    if (block < 0) {
+        return false;
+    }
+
+    if (pending.Find(block) < 0) {
+        Buffer<char> data(GetBlockSize());
+        int count = ReadBlock(block, ~data);
+        if (count < 0) {
+            return false;
+        }
+        PendingBlock &p = pending.Add(block);
+        p.data = pick(data);
+        p.count = count;
+    }
+
+    PendingBlock &p = pending.Get(block);
+    int slot = row - blockstart[block];
+    if (slot >= p.count) {
+        return false;
+    }
+
+    // a long memo is kept until the commit, the record gets its leader and size only
+    String val;
+    int key = slot * GetNumFields() + col;
+    int leader = PX_get_fields(pxdoc)[col].px_flen - 10; // NOLINT: blob pointer size
+    char type = GetFieldType(col);
+    String text = (type == pxfMemoBLOb || type == pxfFmtMemoBLOb) ? Upp::FromUnicode((WString)value, GetCharset()) : String();
+    if (leader >= 0 && text.GetCount() > leader) {
+        p.blobs.GetAdd(key) = text;
+        StringBuffer buffer(leader + 10); // NOLINT: blob pointer size
+        char *data = buffer;
+        memset(data, 0, leader + 10); // NOLINT: blob pointer size
+        memcpy(data, text, leader);
+        Poke32le(data + leader + 4, text.GetCount()); // NOLINT: C code
+        val = buffer;
+    } else {
+        p.blobs.RemoveKey(key);
+        val = EncodeValue(col, value);
+    }
+    memcpy(~p.data + slot * PX_get_recordsize(pxdoc) + GetFieldOffset(col), val, val.GetCount()); // NOLINT: C code
+    blockdatanr = -1;
+    blobnamesready = false;
+    if (block < zones.GetCount()) {
+        zones[block].valid = false;
+    }
+
+    // without a transaction the edit is written at once
+    return translevel > 0 || WriteBlocks();
+}
+
+void ParadoxSession::Commit() {
+    if (translevel > 0 && --translevel == 0) {
+        ClearError();
+        if (!WriteBlocks()) {
+            SetError(t_("Writing of the modified records has failed"), "COMMIT");
         }
-        default:
-            break;
+    }
+}
+
+bool ParadoxSession::GetPendingBlob(int row, int col, String &text) const {
+    int block = FindUpperBound(blockstart, row) - 1;
+    int q = block < 0 ? -1 : pending.Find(block);
+    if (q < 0) {
+        return false;
+    }
+
+    int i = pending[q].blobs.Find((row - blockstart[block]) * GetNumFields() + col);
+    if (i < 0) {
+        return false;
+    }
+    text = pending[q].blobs[i];
+    return true;
+}
+
+void ParadoxSession::Rollback() {
+    translevel = 0;
+    // the zones and blob names were made from the discarded records
+    for (int i = 0; i < pending.GetCount(); ++i) {
+        int block = pending.GetKey(i);
+        if (block < zones.GetCount()) {
+            zones[block].valid = false;
         }
-        offset += pxf->px_flen;
-        ++pxf; // NOLINT: C code
+    }
+    blobnamesready = false;
+    pending.Clear();
+    blockdatanr = -1;
+}
+
+bool ParadoxSession::WriteBlocks() {
+    if (pending.IsEmpty()) {
+        return true;
+    }
+
+    // the blocks are written in the order of the file
+    auto *pindex = static_cast<pxpindex_t *>(pxdoc->px_indexdata);
+    Vector<int> blocks = clone(pending.GetKeys());
+    Sort(blocks, [&](int a, int b) { return pindex[blockindex[a]].blocknumber < pindex[blockindex[b]].blocknumber; });
+
+    bool result = true;
+    int numfields = GetNumFields();
+    for (int block : blocks) {
+        PendingBlock &p = pending.Get(block);
+        for (int i = 0; i < p.blobs.GetCount(); ++i) {
+            int slot = p.blobs.GetKey(i) / numfields;
+            int col = p.blobs.GetKey(i) % numfields;
+            char *rec = ~p.data + slot * PX_get_recordsize(pxdoc) + GetFieldOffset(col); // NOLINT: C code
+            OpenBlobFile();
+            // NOLINTNEXTLINE: C code
+            if (PX_put_data_blob(pxdoc, rec, PX_get_fields(pxdoc)[col].px_flen, StringBuffer(p.blobs[i]).Begin(), p.blobs[i].GetCount()) < 0) {
+                result = false;
+            }
+        }
+        if (PX_put_datablock(pxdoc, blockindex[block], ~p.data, p.count) < 0) {
+            result = false;
+        }
+        blockhash[block] = MakeBlockHash(~p.data, p.count * PX_get_recordsize(pxdoc));
     }
 
-    if (PX_put_recordn(pxdoc, data, row) > -1) {
-        result = true;
+    // header of the file is written once for all blocks, the journal
+    // makes the writing of all of them durable at once
+    if (PX_write_header(pxdoc) < 0 || PX_commit_journal(pxdoc) < 0) {
+        result = false;
     }
 
+    pending.Clear();
+    blockdatanr = -1;
+    KeepFileStamp();
     return result;
 }
 
@@ -1,7 +1,9 @@
 #ifndef PxSessionView_h_
 #define PxSessionView_h_
 
+#ifdef flagGUI
 #include <CtrlLib/CtrlLib.h>
+#endif
 #include <Sql/Sql.h>
 
 extern "C" {
@@ -10,32 +12,106 @@ extern "C" {
 
 namespace Upp {
 
-class ParadoxSession {
+class ParadoxFilter;
+
+// Definition of a field of a new table
+struct ParadoxField : Moveable<ParadoxField> {
+    String name;
+    char type = pxfAlpha;
+    int length = 0;
+    int decimals = 0;
+};
+
+// Smallest and largest raw data of each field in one data block, empty values
+// are not included. Used by the filtered scan to skip the blocks which
+// cannot have a matching record.
+struct ParadoxBlockZone {
+    enum { NULLS = 1, VALUES = 2 };
+
+    bool valid = false;
+    Buffer<char> minimum; // records made of the smallest and largest data of each field
+    Buffer<char> maximum;
+    Vector<byte> flags; // NULLS and VALUES found in each field
+};
+
+// Data blocks found different by ParadoxSession::Reload()
+struct ParadoxChanges {
+    bool fields = false;  // the fields have changed, no block is the same
+    Vector<int> oldstart; // number of the first record of each block before the reload
+    Vector<int> changed;  // blocks of the reloaded table which differ from the block at the same place before
+};
+
+// Time and size of a table file with the number of records and the update
+// time from its header, which change also when an edit of the file keeps
+// its time and size
+struct ParadoxFileStamp {
+    Time time;
+    int64 length = -1;
+    int records = -1;
+    int updatetime = 0;
+
+    bool operator==(const ParadoxFileStamp &s) const {
+        return time == s.time && length == s.length && records == s.records && updatetime == s.updatetime;
+    }
+    bool operator!=(const ParadoxFileStamp &s) const {
+        return !(*this == s);
+    }
+};
+
+class ParadoxSession : public SqlSession {
   public:
     ParadoxSession();
-    virtual ~ParadoxSession();
+    ~ParadoxSession() override;
 
-    virtual bool IsOpen() const {
+    // Sessions created later allocate their memory by the pxlib memory
+    // profiler, which keeps the statistics of each caller after PX_mp_init()
+    static void MemoryProfile(bool b = true) {
+        memprofile = b;
+    }
+
+    // FNV-1a of 8 byte words with the finalizer of MurmurHash3, used for the
+    // blocks, records and keys of the tables, the high bits are well mixed
+    static uint64 Hash(const char *data, int size, uint64 seed = 0);
+
+    // Phases of the work with the table measured by the statistics, the scan
+    // is timed once per data block and includes the work of the consumer
+    enum { PhaseOpen, PhaseIndex, PhaseScan, PhaseExport, PhaseHttp, PhaseCount };
+
+    bool IsOpen() const override {
         return open && (nullptr != pxdoc->px_stream || (nullptr != pxdoc->px_blob && nullptr != pxdoc->px_blob->mb_stream));
     }
 
     // No users in paradox!
-    virtual Vector<String> EnumUsers() {
+    Vector<String> EnumUsers() override {
         NEVER();
         return {};
     }
     // No databases in paradox!
-    virtual Vector<String> EnumDatabases() {
+    Vector<String> EnumDatabases() override {
         NEVER();
         return {};
     }
-    virtual Vector<String> EnumTables(String database);
+    // Tables are the .db files of the directory (database), the directory
+    // of the opened table is used when database is Null
+    Vector<String> EnumTables(String database) override;
     // NOLINTNEXTLINE - No views in paradox!
-    virtual Vector<String> EnumViews(String database) {
+    Vector<String> EnumViews(String database) override {
         NEVER();
         return {};
     }
-    virtual Vector<SqlColumnInfo> EnumColumns(String database, String table);
+    Vector<SqlColumnInfo> EnumColumns(String database, String table) override;
+
+    // Cell edits of a transaction are kept in memory and the modified data
+    // blocks are written at the commit, each of them once. An error of the
+    // commit is reported by GetLastError().
+    void Begin() override {
+        ++translevel;
+    }
+    void Commit() override;
+    void Rollback() override;
+    int GetTransactionLevel() const override {
+        return translevel;
+    }
 
     virtual bool IsBlobOpen() const {
         return (nullptr != pxdoc->px_blob && nullptr != pxdoc->px_blob->mb_stream);
@@ -45,7 +121,12 @@ class ParadoxSession {
         return nullptr != pxdoc->px_blob;
     }
 
+  protected:
+    SqlConnection *CreateConnection() override;
+
   private:
+    static bool memprofile;
+
     bool open = false;
     pxdoc_t *pxdoc = nullptr;
 
@@ -57,11 +138,93 @@ class ParadoxSession {
 
     String filepath;
     String blobfilepath;
+    String directory;
+    byte tablecharset = 0;
+
+    // Level 1 entries of the primary index and the number of the first
+    // record in each of them. Used to locate a record without walking
+    // the block list.
+    Vector<int> blockindex;
+    Vector<int> blockstart;
+
+    // Checksum of the records of each data block read from the file, 0 when
+    // the block was not read yet. Used by Reload() to find the changed blocks.
+    Vector<uint64> blockhash;
+
+    // Stamp of the file after the last read or write by the session
+    ParadoxFileStamp filestamp;
+    static constexpr int NumRecordsOffset = 0x06; // NOLINT: header of the file
+    static constexpr int UpdateTimeOffset = 0x60; // NOLINT: data header of the file
+    static constexpr int RoundBlocks = 16;        // NOLINT: blocks of one thread in a round
+
+    // Zone of each data block, made by the first filtered scan of the block
+    Array<ParadoxBlockZone> zones;
+
+    // Different pointers to binary blobs by their modification number, made
+    // by the first GetBlobName(), the n-th one gets _<n> in its name
+    VectorMap<int, Index<String>> blobnames;
+    bool blobnamesready = false;
+
+    // Data block kept in memory by GetRecordData()
+    Buffer<char> blockdata;
+    int blockdatanr = -1;
+    int blockdatacount = 0;
+
+    // Offset of each field in the record
+    Vector<int> fieldoffset;
+
+    bool lazyblobs = false;
+    bool blobfilechecked = false;
+    bool journal = false;
+
+    // Statistics of the open table, the I/O counters are kept by pxlib
+    int64 phasetime[PhaseCount] = {};
+    int64 decodedfields[pxfBytes + 1] = {}; // by the field type
+    int64 decodedrecords = 0;
+    int64 skippedblocks = 0;
+
+    // Records of the data blocks modified in the transaction, the memo
+    // values longer than the leader go to the .mb file with WriteBlocks()
+    struct PendingBlock {
+        Buffer<char> data;
+        int count = 0;
+        VectorMap<int, String> blobs; // by slot * fields + col
+    };
+    ArrayMap<int, PendingBlock> pending;
+    int translevel = 0;
+
+    bool WriteBlocks();
+    bool GetPendingBlob(int row, int col, String &text) const;
+
+    void BuildFieldIndex();
+    void BuildBlockIndex();
+    void InvalidateBlocks() {
+        BuildBlockIndex();
+        blockdatanr = -1;
+        zones.Clear();
+        blobnamesready = false;
+        KeepFileStamp();
+    }
+    void KeepFileStamp() {
+        filestamp = ReadFileStamp(filepath);
+    }
+    static ParadoxFileStamp ReadFileStamp(const String &path);
+    static pxdoc_t *NewDocument();
+    bool OpenFile();
+    static uint64 MakeBlockHash(const char *data, int size);
+    void BuildZone(ParadoxBlockZone &zone, const char *data, int count);
+    const char *GetRecordData(int row);
+    bool OpenBlobFile();
+    Value ReadBlob(const char *data, int field, byte codepage);
 
     static void ErrorHandler(pxdoc_t *p, int error, const char *str, void *data) {
         (void)p;
         (void)data;
+#ifdef flagGUI
         PromptOK(Format("PXLib: %s (%d)", str, error));
+#else
+        Cerr() << "PXLib: " << str << " (" << error << ")\n";
+#endif
     }
     dword GetInfoType(char px_ftype);
 
@@ -72,6 +235,13 @@ class ParadoxSession {
     String GetFileName() const {
         return Upp::GetFileName(filepath);
     }
+    String GetDirectory() const {
+        return directory;
+    }
+    void SetDirectory(const String &dir) {
+        directory = dir;
+    }
+    String FindTable(const String &table) const;
 
     int GetNumRecords() const {
         return PX_get_num_records(pxdoc);
@@ -184,11 +354,156 @@ class ParadoxSession {
         PX_close(pxdoc);
     }
     bool Open(const char *filename);
+    // True when the file was modified by another program since it was read
+    bool IsFileChanged() const {
+        return open && ReadFileStamp(filepath) != filestamp;
+    }
+    // The session is used by another thread, its errors are not shown by
+    // dialogs and its memory is not profiled. Called right after the session
+    // was made.
+    ParadoxSession &Background();
+    // Opens the file without replaying its journal and reads all data blocks
+    // to get their checksums, called by the thread of a background session
+    bool ReadForReload(const String &path);
+    // Takes the document of the session read by ReadForReload() and compares
+    // its data blocks with the ones read before. Fails while a transaction is
+    // running, the table stays as it was then.
+    bool Reload(ParadoxChanges &changes, ParadoxSession &next);
+    bool Reload(ParadoxChanges &changes) {
+        ParadoxSession next;
+        next.Background();
+        return next.ReadForReload(filepath) && Reload(changes, next);
+    }
+    // Creates a new table, a .mb file is created when there is a blob field
+    bool Create(const char *filename, const Vector<ParadoxField> &fields, int codepage = 1252);
+
+    int GetBlockCount() const {
+        return blockindex.GetCount();
+    }
+    // Checksum of the records of the data block read last, 0 when the block was not read
+    uint64 GetBlockHash(int block) const {
+        return (block >= 0 && block < blockhash.GetCount()) ? blockhash[block] : 0;
+    }
+    // Number of the first record of the data block
+    int GetBlockStart(int block) const {
+        return (block >= 0 && block < blockstart.GetCount()) ? blockstart[block] : -1;
+    }
+    int GetBlockSize() const {
+        return GetMaxTableSize() * 0x400; // NOLINT: block size in kB
+    }
+    int ReadBlock(int block, char *data);
+    // Number of the data block in the file, the first block is 1
+    int GetBlockNumber(int block) const;
+    // Number of the data blocks stored in the file, also the ones which are
+    // not in the list of the table
+    int GetFileBlockCount() const;
+    // Reads all record slots of the data block number of the file, the slots
+    // behind the records in use keep the data of deleted records. Info gets
+    // the header of the block, its numrecords is -1 for a broken addDataSize.
+    // Returns the number of the slots or -1 when the block cannot be read.
+    int ReadRawBlock(int number, char *data, pxdatablockinfo_t &info);
+    // Reads the blocks from..to-1 in rounds by read(number, data), which
+    // returns false to stop, and passes each round to the threads, every one
+    // gets a continuous part of it in process(thread, number, data). Progress
+    // gets the number of read and all blocks and returns true to cancel.
+    // Returns false when it was stopped.
+    bool ProcessBlocks(int from, int to, int threads, Gate<int, char *> read, Event<int, int, const char *> process,
+                       Gate<int, int> progress = Null);
+    bool Scan(Function<bool(int, const char *)> record);
+    // Only the records accepted by the compiled filter are passed, the data
+    // blocks whose zone does not match the filter are not read
+    bool Scan(const ParadoxFilter &filter, Function<bool(int, const char *)> record);
+    // Scans the listed data blocks only
+    bool Scan(const ParadoxFilter &filter, const Vector<int> &blocks, Function<bool(int, const char *)> record);
+    Vector<int> Select(const ParadoxFilter &filter);
+
+    byte GetCharset(byte charset = 0) const {
+        return charset > 0 ? charset : tablecharset;
+    }
+    int GetFieldOffset(int col) const {
+        return (col >= 0 && col < fieldoffset.GetCount()) ? fieldoffset[col] : 0;
+    }
+    // The projection variants decode only the listed fields, in that order
+    Vector<Value> DecodeRecord(const char *data, byte charset = 0);
+    Vector<Value> DecodeRecord(const char *data, const Vector<int> &fields, byte charset = 0);
+    Value DecodeField(const char *data, int field, byte codepage);
+    String EncodeValue(int col, const Value &value, byte charset = 0);
+
+    // Blob fields are decoded to the size of their data only, the data
+    // itself is read by GetBlob() when it is needed
+    ParadoxSession &LazyBlobs(bool b = true) {
+        lazyblobs = b;
+        return *this;
+    }
+    bool IsLazyBlobs() const {
+        return lazyblobs;
+    }
+    bool IsBlobField(int col) const;
+    // Paradox type of the field (pxfAlpha, ...), 0 for an invalid field
+    char GetFieldType(int col) const;
+    // True when the raw data of the field is empty or valid for its type
+    bool IsValidData(const char *data, int col) const;
+    // Path of the existing .mb file of the table, Null when there is none
+    String GetBlobFilePath() const;
+    // Name shown for the binary blob of the field (BLOb, OLE, graphic) and of
+    // the file written by ParadoxBlobExtractor: <table>_<mod_nr>.blob, or
+    // <table>_<mod_nr>_<n>.blob for the n-th other blob with the same number
+    String GetBlobName(const char *data, int field);
+
+    // Writes to the .DB and .mb file, including Pack(), are collected in
+    // memory and written to the .jnl file first when they are committed,
+    // the journal of an interrupted commit is replayed by Open()
+    ParadoxSession &Journal(bool b = true);
+    bool IsJournal() const {
+        return journal;
+    }
+    String GetJournalPath() const {
+        return AppendFileName(Upp::GetFileDirectory(filepath), Upp::GetFileTitle(filepath) + ".jnl");
+    }
+    Value GetBlob(int row, int col, byte charset = 0);
 
     Vector<Value> GetRow(int row, byte charset = 0);
-    bool DelRow(int row);
+    Vector<Value> GetRow(int row, const Vector<int> &fields, byte charset = 0);
+    // Pending edits of a transaction are written before the rows are deleted
+    bool DelRows(const Vector<int> &rows);
+    bool DelRow(int row) {
+        return DelRows(Vector<int>{row});
+    }
+    // Moves the records to completely filled data blocks and truncates the
+    // file, the order and the numbers of the records do not change
+    bool Pack();
+    // A keyed table is not packed, its .px index would be out of date
+    bool CanPack() const {
+        return open && GetFileType() == pxfFileTypNonIndexDB;
+    }
+    // Appends count records encoded by EncodeValue() to the end of the table,
+    // new data blocks are written at once
+    bool AppendRecords(const char *data, int count);
     bool SetRowCol(int row, int col, const Value &value);
 
+    // Time of the phase in microseconds
+    void AddTime(int phase, int64 usec) {
+        if (phase >= 0 && phase < PhaseCount) {
+            phasetime[phase] += usec;
+        }
+    }
+    int64 GetTime(int phase) const {
+        return (phase >= 0 && phase < PhaseCount) ? phasetime[phase] : 0;
+    }
+    int64 GetDecodedRecords() const {
+        return decodedrecords;
+    }
+    int64 GetSkippedBlocks() const {
+        return skippedblocks;
+    }
+    int64 GetDecodedFields(int type) const {
+        return (type >= 0 && type <= pxfBytes) ? decodedfields[type] : 0;
+    }
+    const pxstats_t &GetIOStatistics() const {
+        return pxdoc->px_stats;
+    }
+    void ResetStatistics();
+
     operator pxdoc_t *() {
         return pxdoc;
     }
@@ -0,0 +1,482 @@
+#include "PxSql.h"
+
+using namespace Upp;
+
+struct ParadoxConnection::Query {
+    ParadoxSession *px = nullptr;
+    bool all = false;
+    bool count = false;
+    Vector<String> columns;
+    Vector<String> aliases;
+    Vector<int> fields;
+    ParadoxFilter filter;
+    Vector<int> order;
+    Vector<bool> desc;
+    int limit = -1;
+    int offset = 0;
+    bool unknown = false; // a comparison with NULL, no record matches
+};
+
+static bool sKeyword(CParser &p, const char *keyword) {
+    CParser::Pos pos = p.GetPos();
+    if (p.IsId() && ToUpper(p.ReadId()) == keyword) {
+        return true;
+    }
+    p.SetPos(pos);
+    return false;
+}
+
+// Paradox field names may contain spaces, so "quoted" and [bracketed]
+// identifiers are accepted too.
+static String sReadName(CParser &p) {
+    if (p.IsString()) {
+        return p.ReadString();
+    }
+    if (p.IsChar('[')) {
+        CParser::Pos pos = p.GetPos();
+        const char *begin = pos.ptr + 1; // NOLINT: C code
+        const char *end = strchr(begin, ']');
+        if (nullptr == end) {
+            p.ThrowError(t_("Missing ]"));
+        }
+        pos.ptr = end + 1; // NOLINT: C code
+        p.SetPos(pos);
+        p.Spaces();
+        return TrimBoth(String(begin, end));
+    }
+    String name = p.ReadId();
+    if (p.Char('.')) { // table.db
+        name << '.' << p.ReadId();
+    }
+    return name;
+}
+
+static int sFindField(const Vector<SqlColumnInfo> &columns, const String &name) {
+    String upper = ToUpper(name);
+    for (int i = 0; i < columns.GetCount(); ++i) {
+        if (ToUpper(columns[i].name) == upper) {
+            return i;
+        }
+    }
+    throw CParser::Error(Format(t_("Unknown column '%s'"), name));
+}
+
+// Date and time constants are written as 'YYYY-MM-DD' and 'YYYY-MM-DD HH:MM:SS'
+// (or 'HH:MM:SS' for time fields).
+static Value sConvert(const Value &value, char px_ftype) {
+    if (!IsString(value)) {
+        return value;
+    }
+
+    String text = value;
+    switch (px_ftype) {
+    case pxfDate: {
+        Date d;
+        if (nullptr == StrToDate("ymd", d, text)) {
+            throw CParser::Error(Format(t_("Invalid date '%s'"), text));
+        }
+        return d;
+    }
+    case pxfTimestamp: {
+        Time t;
+        if (nullptr == StrToTime("ymd", t, text)) {
+            throw CParser::Error(Format(t_("Invalid time '%s'"), text));
+        }
+        return t;
+    }
+    case pxfTime: {
+        Time t = ToTime(GetSysDate());
+        CParser p(text);
+        t.hour = p.ReadInt();
+        p.PassChar(':');
+        t.minute = p.ReadInt();
+        if (p.Char(':')) {
+            t.second = p.ReadInt();
+        }
+        return t;
+    }
+    default:
+        return value;
+    }
+}
+
+void ParadoxConnection::SetParam(int i, const Value &r) {
+    param.At(i) = r;
+}
+
+Value ParadoxConnection::ReadConstant(CParser &p, int &paramnr) {
+    if (p.Char('?')) {
+        int i = paramnr++;
+        return i < param.GetCount() ? param[i] : Value();
+    }
+    if (p.IsChar('\'')) {
+        return p.ReadString('\'');
+    }
+    if (p.IsString()) {
+        return p.ReadString();
+    }
+    if (sKeyword(p, "NULL")) {
+        return Null;
+    }
+    if (sKeyword(p, "TRUE")) {
+        return true;
+    }
+    if (sKeyword(p, "FALSE")) {
+        return false;
+    }
+
+    bool negative = p.Char('-');
+    if (!p.IsNumber()) {
+        p.ThrowError(t_("Missing constant"));
+    }
+    double number = p.ReadDouble();
+    if (negative) {
+        number = -number;
+    }
+    if (number == floor(number) && fabs(number) < INT_MAX) {
+        return (int)number;
+    }
+    return number;
+}
+
+ParadoxSession &ParadoxConnection::OpenTable(const String &table) {
+    String title = ToUpper(GetFileTitle(table));
+
+    if (session.IsOpen() && ToUpper(GetFileTitle(session.GetFilePath())) == title) {
+        return session;
+    }
+
+    String path = session.FindTable(table);
+    if (IsNull(path)) {
+        throw CParser::Error(Format(t_("Table '%s' not found"), table));
+    }
+
+    if (other.IsEmpty() || other->GetFilePath() != path) {
+        other.Clear();
+        if (!other.Create().Open(path)) {
+            other.Clear();
+            throw CParser::Error(Format(t_("Could not open table '%s'"), table));
+        }
+    }
+
+    return *other;
+}
+
+void ParadoxConnection::Parse(CParser &p, Query &q) {
+    int paramnr = 0;
+
+    if (!sKeyword(p, "SELECT")) {
+        p.ThrowError(t_("Only SELECT statements are supported"));
+    }
+
+    CParser::Pos pos = p.GetPos();
+    if (sKeyword(p, "COUNT") && p.Char('(')) {
+        p.PassChar('*');
+        p.PassChar(')');
+        q.count = true;
+    } else {
+        p.SetPos(pos);
+        if (p.Char('*')) {
+            q.all = true;
+        } else {
+            do {
+                q.columns.Add(sReadName(p));
+                q.aliases.Add(sKeyword(p, "AS") ? sReadName(p) : q.columns.Top());
+            } while (p.Char(','));
+        }
+    }
+
+    if (!sKeyword(p, "FROM")) {
+        p.ThrowError(t_("Missing FROM"));
+    }
+
+    q.px = &OpenTable(sReadName(p));
+    Vector<SqlColumnInfo> columns = q.px->EnumColumns(Null, Null);
+    pxfield_t *pxf = PX_get_fields(*q.px);
+
+    if (q.all) {
+        for (int i = 0; i < columns.GetCount(); ++i) {
+            q.fields.Add(i);
+            q.aliases.Add(columns[i].name);
+        }
+    } else {
+        for (const String &name : q.columns) {
+            q.fields.Add(sFindField(columns, name));
+        }
+    }
+
+    if (sKeyword(p, "WHERE")) {
+        do {
+            int field = sFindField(columns, sReadName(p));
+            char ftype = pxf[field].px_ftype; // NOLINT: C code
+            // the result of a comparison with NULL is unknown, not IS NULL;
+            // an empty text is the same as NULL in a Paradox table
+            auto constant = [&] {
+                Value v = sConvert(ReadConstant(p, paramnr), ftype);
+                if (IsNull(v) && !IsString(v)) {
+                    q.unknown = true;
+                }
+                return v;
+            };
+
+            if (sKeyword(p, "IS")) {
+                bool negate = sKeyword(p, "NOT");
+                if (!sKeyword(p, "NULL")) {
+                    p.ThrowError(t_("Missing NULL"));
+                }
+                if (negate) {
+                    q.filter.NotNull(field);
+                } else {
+                    q.filter.IsNull(field);
+                }
+            } else if (sKeyword(p, "BETWEEN")) {
+                Value low = constant();
+                if (!sKeyword(p, "AND")) {
+                    p.ThrowError(t_("Missing AND"));
+                }
+                Value high = constant();
+                q.filter.Range(field, low, high);
+            } else if (sKeyword(p, "LIKE")) {
+                // only leading and trailing % are supported, other characters match literally
+                String text = AsString(constant());
+                bool contains = text.StartsWith("%");
+                if (contains) {
+                    text.Remove(0);
+                }
+                bool prefix = text.EndsWith("%");
+                if (prefix) {
+                    text.Trim(text.GetCount() - 1);
+                }
+                if (text.Find('%') >= 0 || (contains && !prefix && !text.IsEmpty())) {
+                    p.ThrowError(t_("Unsupported LIKE pattern"));
+                }
+                if ((contains || prefix) && text.IsEmpty()) {
+                    q.filter.NotNull(field); // '%' matches any value
+                } else if (contains) {
+                    q.filter.Contains(field, text);
+                } else if (prefix) {
+                    q.filter.Prefix(field, text);
+                } else {
+                    q.filter.Equal(field, text);
+                }
+            } else if (p.Char2('<', '=')) {
+                q.filter.Range(field, Null, constant());
+            } else if (p.Char2('>', '=')) {
+                q.filter.Range(field, constant(), Null);
+            } else if (p.IsChar2('<', '>') || p.IsChar2('!', '=')) {
+                p.ThrowError(t_("Operator <> is not supported"));
+            } else if (p.Char('<')) {
+                q.filter.Range(field, Null, constant(), true, false);
+            } else if (p.Char('>')) {
+                q.filter.Range(field, constant(), Null, false, true);
+            } else if (p.Char('=')) {
+                q.filter.Equal(field, constant());
+            } else {
+                p.ThrowError(t_("Unsupported condition"));
+            }
+        } while (sKeyword(p, "AND"));
+    }
+
+    if (sKeyword(p, "ORDER")) {
+        if (!sKeyword(p, "BY")) {
+            p.ThrowError(t_("Missing BY"));
+        }
+        do {
+            if (p.IsNumber()) {
+                int n = p.ReadInt();
+                if (n < 1 || n > q.fields.GetCount()) {
+                    p.ThrowError(Format(t_("ORDER BY position %d is out of range"), n));
+                }
+                q.order.Add(q.fields[n - 1]);
+            } else {
+                String name = sReadName(p);
+                int alias = FindIndex(q.aliases, name);
+                q.order.Add(alias >= 0 ? q.fields[alias] : sFindField(columns, name));
+            }
+            bool desc = sKeyword(p, "DESC");
+            if (!desc) {
+                sKeyword(p, "ASC");
+            }
+            q.desc.Add(desc);
+        } while (p.Char(','));
+    }
+
+    if (sKeyword(p, "LIMIT")) {
+        q.limit = max(0, p.ReadInt());
+        if (sKeyword(p, "OFFSET")) {
+            q.offset = max(0, p.ReadInt());
+        }
+    }
+
+    p.Char(';');
+    if (!p.IsEof()) {
+        p.ThrowError(t_("Unexpected text at the end of the statement"));
+    }
+}
+
+void ParadoxConnection::Run(ParadoxSession &px, Query &q) {
+    if (!q.filter.Compile(px)) {
+        throw CParser::Error(q.filter.GetError());
+    }
+
+    // no record is read when a condition is unknown
+    auto scan = [&](auto &&consumer) {
+        if (!q.unknown) {
+            px.Scan(q.filter, consumer);
+        }
+    };
+
+    if (q.count) {
+        int count = 0;
+        scan([&](int, const char *) {
+            ++count;
+            return true;
+        });
+        SqlColumnInfo &ci = info.Add();
+        ci.name = "COUNT(*)";
+        ci.type = INT_V;
+        rows.Add().Add(count);
+        return;
+    }
+
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    for (int i = 0; i < q.fields.GetCount(); ++i) {
+        SqlColumnInfo &ci = info.Add(columns[q.fields[i]]);
+        ci.name = q.aliases[i];
+    }
+
+    // only the selected and the sort fields are decoded
+    Index<int> used;
+    for (int field : q.fields) {
+        used.FindAdd(field);
+    }
+    for (int field : q.order) {
+        used.FindAdd(field);
+    }
+    const Vector<int> &projection = used.GetKeys();
+
+    Vector<int> rownr; // record number of each result row
+    auto project = [&](const Vector<Value> &record, int recnr) {
+        Vector<Value> &row = rows.Add();
+        for (int field : q.fields) {
+            row.Add(record[used.Find(field)]);
+        }
+        rownr.Add(recnr);
+    };
+
+    if (q.order.IsEmpty()) {
+        // without ORDER BY the scan can stop as soon as LIMIT rows are found
+        int skip = q.offset;
+        scan([&](int recnr, const char *data) {
+            if (q.limit >= 0 && rows.GetCount() >= q.limit) {
+                return false;
+            }
+            if (skip > 0) {
+                --skip;
+            } else {
+                project(px.DecodeRecord(data, projection), recnr);
+            }
+            return true;
+        });
+        ReadBlobs(px, q, rownr);
+        return;
+    }
+
+    Vector<Vector<Value>> records;
+    Vector<int> recordnr;
+    scan([&](int recnr, const char *data) {
+        records.Add(px.DecodeRecord(data, projection));
+        recordnr.Add(recnr);
+        return true;
+    });
+
+    Vector<int> order;
+    for (int i = 0; i < records.GetCount(); ++i) {
+        order.Add(i);
+    }
+    StableSort(order, [&](int a, int b) {
+        for (int i = 0; i < q.order.GetCount(); ++i) {
+            int field = used.Find(q.order[i]);
+            int c = StdValueCompare(records[a][field], records[b][field]);
+            if (c != 0) {
+                return q.desc[i] ? c > 0 : c < 0;
+            }
+        }
+        return false;
+    });
+
+    int end = q.limit < 0 ? order.GetCount() : min(order.GetCount(), q.offset + q.limit);
+    for (int i = q.offset; i < end; ++i) {
+        project(records[order[i]], recordnr[order[i]]);
+    }
+    ReadBlobs(px, q, rownr);
+}
+
+void ParadoxConnection::ReadBlobs(ParadoxSession &px, const Query &q, const Vector<int> &rownr) {
+    if (!px.IsLazyBlobs()) {
+        return;
+    }
+
+    // blob data are read for the result rows only
+    for (int i = 0; i < q.fields.GetCount(); ++i) {
+        if (px.IsBlobField(q.fields[i])) {
+            for (int r = 0; r < rows.GetCount(); ++r) {
+                rows[r][i] = px.GetBlob(rownr[r], q.fields[i]);
+            }
+        }
+    }
+}
+
+bool ParadoxConnection::Execute() {
+    Cancel();
+    info.Clear();
+
+    try {
+        Query q;
+        CParser p(statement);
+        Parse(p, q);
+        Run(*q.px, q);
+    } catch (CParser::Error &e) {
+        rows.Clear();
+        info.Clear();
+        session.SetError(e, statement);
+        return false;
+    }
+
+    return true;
+}
+
+int ParadoxConnection::GetRowsProcessed() const {
+    return rows.GetCount();
+}
+
+bool ParadoxConnection::Fetch() {
+    if (current + 1 < rows.GetCount()) {
+        ++current;
+        return true;
+    }
+    return false;
+}
+
+void ParadoxConnection::GetColumn(int i, Ref r) const {
+    if (current >= 0 && current < rows.GetCount() && i >= 0 && i < rows[current].GetCount()) {
+        r.SetValue(rows[current][i]);
+    } else {
+        r.SetNull();
+    }
+}
+
+void ParadoxConnection::Cancel() {
+    rows.Clear();
+    current = -1;
+}
+
+SqlSession &ParadoxConnection::GetSession() const {
+    return session;
+}
+
+String ParadoxConnection::ToString() const {
+    return statement;
+}
+
+// vim: ts=4 sw=4 expandtab
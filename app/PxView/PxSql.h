@@ -0,0 +1,54 @@
+#ifndef PxSql_h_
+#define PxSql_h_
+
+#include "PxFilter.h"
+#include "PxSession.h"
+
+namespace Upp {
+
+// Read-only SQL access to the Paradox tables in the directory of a
+// ParadoxSession. Supported statement:
+//
+//   SELECT * | COUNT(*) | column [AS alias], ...
+//   FROM table
+//   [WHERE condition [AND condition ...]]
+//   [ORDER BY column | position [ASC | DESC], ...]
+//   [LIMIT count [OFFSET skip]]
+//
+// Conditions (=, <, <=, >, >=, BETWEEN, LIKE, IS [NOT] NULL) are compiled to
+// a ParadoxFilter, so they are evaluated on the raw record data.
+class ParadoxConnection : public SqlConnection {
+  public:
+    explicit ParadoxConnection(ParadoxSession &session) : session(session) {}
+    ~ParadoxConnection() override = default;
+
+  protected:
+    void SetParam(int i, const Value &r) override;
+    bool Execute() override;
+    int GetRowsProcessed() const override;
+    bool Fetch() override;
+    void GetColumn(int i, Ref r) const override;
+    void Cancel() override;
+    SqlSession &GetSession() const override;
+    String ToString() const override;
+
+  private:
+    struct Query;
+
+    ParadoxSession &session;
+    One<ParadoxSession> other; // table of the directory other than the session one
+    Vector<Value> param;
+    Vector<Vector<Value>> rows;
+    int current = -1;
+
+    ParadoxSession &OpenTable(const String &table);
+    void Parse(CParser &p, Query &q);
+    Value ReadConstant(CParser &p, int &paramnr);
+    void Run(ParadoxSession &px, Query &q);
+    void ReadBlobs(ParadoxSession &px, const Query &q, const Vector<int> &rownr);
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
@@ -0,0 +1,357 @@
+#include "PxVerify.h"
+
+using namespace Upp;
+
+static const int SubBlobs = 64; // NOLINT: entries of a suballocated block
+
+void ParadoxVerifier::Findings::Add(int severity, int block, int slot, int field, const String &text) {
+    (severity == ParadoxProblem::FAILURE ? errors : warnings)++;
+    if (problems.GetCount() < limit) {
+        ParadoxProblem &p = problems.Add();
+        p.severity = severity;
+        p.block = block;
+        p.slot = slot;
+        p.field = field;
+        p.text = text;
+    }
+}
+
+void ParadoxVerifier::Merge(const Findings &f) {
+    errors += f.errors;
+    warnings += f.warnings;
+    for (int i = 0; i < f.problems.GetCount() && problems.GetCount() < maxproblems; ++i) {
+        problems.Add(f.problems[i]);
+    }
+}
+
+void ParadoxVerifier::CheckBlock(ParadoxSession &px, int number, const char *data, Block &b) {
+    if (b.records < 0) {
+        b.findings.Add(ParadoxProblem::FAILURE, number, -1, -1, t_("The size of the records in the data block is not valid"));
+        return;
+    }
+
+    int recordsize = px.GetRecordSize();
+    for (int slot = 0; slot < b.records; ++slot) {
+        const char *rec = data + slot * recordsize; // NOLINT: C code
+        for (int field = 0; field < px.GetNumFields(); ++field) {
+            if (!px.IsValidData(rec, field)) {
+                b.findings.Add(ParadoxProblem::FAILURE, number, slot, field, t_("The data of the field are not valid for its type"));
+                continue;
+            }
+            if (!px.IsBlobField(field)) {
+                continue;
+            }
+
+            ParadoxBlobExtractor::Pointer p;
+            int leader = ParadoxBlobExtractor::ReadPointer(px, rec, field, p);
+            if (leader < 0 || p.GetDataSize() <= leader) {
+                continue;
+            }
+            if (p.offset == 0) {
+                b.findings.Add(ParadoxProblem::FAILURE, number, slot, field, t_("The blob has no place in the blob file"));
+                continue;
+            }
+            BlobPointer &blob = b.blobs.Add();
+            static_cast<ParadoxBlobExtractor::Pointer &>(blob) = p;
+            blob.block = number;
+            blob.slot = slot;
+            blob.field = field;
+        }
+    }
+    b.checked = b.records;
+}
+
+void ParadoxVerifier::CheckChain(const ParadoxSession &px, Array<Block> &blocks, Findings &table) {
+    // blocks are numbered from 1, the list ends with 0
+    int count = blocks.GetCount() - 1;
+    int fileblocks = px.GetNumBlocks();
+    Vector<bool> listed;
+    listed.SetCount(count + 1, false);
+
+    int number = px.GetFirstBlock();
+    if (fileblocks > 0 && (number < 1 || number > count)) {
+        table.Add(ParadoxProblem::FAILURE, 0, -1, -1, Format(t_("The first data block %d is not in the file"), number));
+        number = 0;
+    }
+
+    int prev = 0;
+    int listcount = 0;
+    int64 records = 0;
+    while (number > 0) {
+        if (number > count) {
+            table.Add(ParadoxProblem::FAILURE, prev, -1, -1, Format(t_("The next data block %d is not in the file"), number));
+            break;
+        }
+        if (listed[number]) {
+            table.Add(ParadoxProblem::FAILURE, prev, -1, -1, Format(t_("The list of the data blocks returns to the data block %d"), number));
+            break;
+        }
+        listed[number] = true;
+        ++listcount;
+
+        Block &b = blocks[number];
+        if (b.prev != prev) {
+            table.Add(ParadoxProblem::WARNING, number, -1, -1, Format(t_("The previous data block is %d instead of %d"), b.prev, prev));
+        }
+        if (b.records == 0) {
+            table.Add(ParadoxProblem::WARNING, number, -1, -1, t_("The data block in the list has no records"));
+        }
+        records += max(b.records, 0);
+        prev = number;
+        number = b.next;
+    }
+
+    if (fileblocks > 0 && prev != px.GetLastBlock()) {
+        table.Add(ParadoxProblem::WARNING, 0, -1, -1, Format(t_("The last data block is %d, the header has %d"), prev, px.GetLastBlock()));
+    }
+    // pxlib reads only the number of the blocks in the header
+    if (listcount != fileblocks) {
+        table.Add(listcount > fileblocks ? ParadoxProblem::FAILURE : ParadoxProblem::WARNING, 0, -1, -1,
+                  Format(t_("The list has %d data blocks, the header has %d"), listcount, fileblocks));
+    }
+    if (records != px.GetNumRecords()) {
+        table.Add(ParadoxProblem::FAILURE, 0, -1, -1,
+                  Format(t_("The header has %d records, the data blocks in the list have %d"), px.GetNumRecords(), records));
+    }
+
+    // the records of the blocks out of the list are not a part of the table
+    for (int i = 1; i <= count; ++i) {
+        if (!listed[i]) {
+            Block &b = blocks[i];
+            b.findings = Findings();
+            b.findings.limit = table.limit;
+            b.blobs.Clear();
+            b.checked = 0;
+            if (i <= fileblocks) {
+                b.findings.Add(ParadoxProblem::WARNING, i, -1, -1, t_("The data block is not in the list"));
+            }
+        }
+    }
+}
+
+void ParadoxVerifier::CheckBlobs(const ParadoxSession &px, const Vector<BlobPointer> &blobs) {
+    if (blobs.IsEmpty()) {
+        return;
+    }
+    String mbfile = px.GetBlobFilePath();
+    if (IsNull(mbfile)) {
+        Findings missing;
+        missing.limit = maxproblems;
+        missing.Add(ParadoxProblem::FAILURE, 0, -1, -1, t_("The blob file of the DB does not exist"));
+        Merge(missing);
+        return;
+    }
+    int64 mblength = GetFileLength(mbfile);
+    auto encryption = static_cast<dword>(px.GetEncryption());
+
+    // the blobs are checked in the order of the .mb file
+    Vector<int> order;
+    Vector<int> groups = ParadoxBlobExtractor::GroupByBlock(blobs, order);
+    int groupcount = groups.GetCount() - 1;
+
+    auto work = [&](int from, int to, Findings &found) {
+        FileIn in;
+        if (!in.Open(mbfile)) {
+            found.Add(ParadoxProblem::FAILURE, 0, -1, -1, t_("The blob file of the DB could not be opened"));
+            return;
+        }
+        for (int g = from; g < to; ++g) {
+            int offset = blobs[order[groups[g]]].offset;
+            String block;
+            if (offset % ParadoxBlobExtractor::MbBlockSize == 0 && offset < mblength) {
+                block = ParadoxBlobExtractor::ReadMb(in, offset, int(min<int64>(ParadoxBlobExtractor::MbBlockSize, mblength - offset)), encryption);
+            }
+
+            for (int i = groups[g]; i < groups[g + 1]; ++i) {
+                const BlobPointer &b = blobs[order[i]];
+                auto problem = [&](int severity, const String &text) {
+                    found.Add(severity, b.block, b.slot, b.field, text);
+                };
+                if (i > groups[g] && b.index == blobs[order[i - 1]].index) {
+                    problem(ParadoxProblem::FAILURE, t_("The blob is used by another record too"));
+                    continue;
+                }
+                if (block.IsEmpty()) {
+                    problem(ParadoxProblem::FAILURE, Format(t_("The blob points to %d, which is not a block of the blob file"), offset));
+                    continue;
+                }
+
+                int type = byte(block[0]);
+                int blobsize = b.GetDataSize();
+                int size = 0;
+                int modnr = 0;
+                if (type == 2) { // NOLINT: single blob block
+                    // type, number of the 4k blocks, size and modification number
+                    int hsize = b.graphic ? 17 : 9; // NOLINT: header size
+                    if (b.index != ParadoxBlobExtractor::SingleBlock) {
+                        problem(ParadoxProblem::FAILURE, Format(t_("The blob has the index %d in a single blob block"), b.index));
+                        continue;
+                    }
+                    if (block.GetCount() < hsize) {
+                        problem(ParadoxProblem::FAILURE, t_("The blob data are behind the end of the blob file"));
+                        continue;
+                    }
+                    size = Peek32le(~block + 3);  // NOLINT: C code
+                    modnr = Peek16le(~block + 7); // NOLINT: C code
+                    int64 length = int64(Peek16le(~block + 1)) * ParadoxBlobExtractor::MbBlockSize; // NOLINT: C code
+                    if (offset + length > mblength || hsize + blobsize > length) {
+                        problem(ParadoxProblem::FAILURE, t_("The blob data are behind the end of the blob file"));
+                        continue;
+                    }
+                } else if (type == 3) { // NOLINT: suballocated block
+                    // table of 5 byte entries behind the 12 bytes of the block header
+                    int entry = 12 + b.index * 5; // NOLINT: block header
+                    if (b.index >= SubBlobs || entry + 5 > block.GetCount()) {
+                        problem(ParadoxProblem::FAILURE, Format(t_("The blob has the index %d in a suballocated block"), b.index));
+                        continue;
+                    }
+                    const auto *p = reinterpret_cast<const byte *>(~block) + entry; // NOLINT: C code
+                    if (p[0] == 0) {
+                        problem(ParadoxProblem::FAILURE, t_("The entry of the blob in the suballocated block is empty"));
+                        continue;
+                    }
+                    size = (p[1] - 1) * 16 + p[4]; // NOLINT: C code
+                    modnr = Peek16le(p + 2);       // NOLINT: C code
+                    if (p[0] * 16 + blobsize > block.GetCount()) { // NOLINT: C code
+                        problem(ParadoxProblem::FAILURE, t_("The blob data are behind the end of the suballocated block"));
+                        continue;
+                    }
+                } else {
+                    problem(ParadoxProblem::FAILURE, Format(type == 0 ? t_("The blob points to the header of the blob file")
+                                                           : type == 4 ? t_("The blob points to a free block") // NOLINT: free block
+                                                                       : t_("The blob points to a block of unknown type %d"), type));
+                    continue;
+                }
+
+                if (size != b.size) {
+                    problem(ParadoxProblem::FAILURE, Format(t_("The blob has %d bytes, the blob file has %d"), b.size, size));
+                } else if (modnr != b.modnr) {
+                    problem(ParadoxProblem::WARNING, Format(t_("The blob has the modification number %d, the blob file has %d"), b.modnr, modnr));
+                }
+            }
+        }
+    };
+
+    int n = ParadoxBlobExtractor::GetPartCount(groupcount, threads);
+    Array<Findings> found;
+    for (int k = 0; k < n; ++k) {
+        found.Add().limit = maxproblems;
+    }
+    CoWork co;
+    ParadoxBlobExtractor::Schedule(co, groupcount, n, [&](int k, int from, int to) { work(from, to, found[k]); });
+    co.Finish();
+
+    for (const Findings &f : found) {
+        Merge(f);
+    }
+    checkedblobs = blobs.GetCount();
+}
+
+bool ParadoxVerifier::Run(ParadoxSession &px, Gate<int, int> progress) {
+    error.Clear();
+    problems.Clear();
+    errors = 0;
+    warnings = 0;
+    checkedblocks = 0;
+    checkedrecords = 0;
+    checkedblobs = 0;
+
+    if (!px.IsOpen()) {
+        error = t_("The DB is not open");
+        return false;
+    }
+
+    Findings table;
+    table.limit = maxproblems;
+    int recordsize = px.GetRecordSize();
+    int fileblocks = px.GetNumBlocks();
+    int count = px.GetFileBlockCount();
+
+    // the header
+    int fieldsize = 0;
+    for (const SqlColumnInfo &c : px.EnumColumns(Null, Null)) {
+        fieldsize += c.width;
+    }
+    if (fieldsize != recordsize) {
+        table.Add(ParadoxProblem::FAILURE, 0, -1, -1, Format(t_("The record size is %d, the fields have %d bytes"), recordsize, fieldsize));
+    }
+    if (count < fileblocks) {
+        table.Add(ParadoxProblem::FAILURE, 0, -1, -1, Format(t_("The file has %d data blocks, the header has %d"), count, fileblocks));
+    } else if (count > fileblocks) {
+        table.Add(ParadoxProblem::WARNING, 0, -1, -1, Format(t_("The file has %d data blocks, the header has %d"), count, fileblocks));
+    }
+
+    Array<Block> blocks;
+    blocks.SetCount(count + 1);
+    bool ok = px.ProcessBlocks(
+        1, count + 1, max(threads > 0 ? threads : CPU_Cores(), 1),
+        [&](int number, char *data) {
+            pxdatablockinfo_t info;
+            if (px.ReadRawBlock(number, data, info) < 0) {
+                error = Format(t_("The data block %d could not be read"), number);
+                return false;
+            }
+            Block &b = blocks[number];
+            b.next = info.next;
+            b.prev = info.prev;
+            b.records = info.numrecords;
+            b.findings.limit = maxproblems;
+            return true;
+        },
+        [&](int, int number, const char *data) { CheckBlock(px, number, data, blocks[number]); },
+        [&](int done, int all) {
+            if (progress && progress(done, all)) {
+                error = t_("The computation was canceled");
+                return true;
+            }
+            return false;
+        });
+    if (!ok) {
+        return false;
+    }
+
+    CheckChain(px, blocks, table);
+
+    // the problems are kept in the order of the blocks
+    Vector<BlobPointer> blobs;
+    Merge(table);
+    for (int number = 1; number <= count; ++number) {
+        Block &b = blocks[number];
+        Merge(b.findings);
+        checkedrecords += b.checked;
+        blobs.Append(b.blobs);
+    }
+    checkedblocks = count;
+    blocks.Clear();
+
+    CheckBlobs(px, blobs);
+
+    StableSort(problems, [](const ParadoxProblem &a, const ParadoxProblem &b) {
+        return a.block != b.block ? a.block < b.block : a.slot != b.slot ? a.slot < b.slot : a.field < b.field;
+    });
+    return true;
+}
+
+String ParadoxVerifier::GetReport(ParadoxSession &px) const {
+    Vector<SqlColumnInfo> columns = px.EnumColumns(Null, Null);
+    String report;
+    for (const ParadoxProblem &p : problems) {
+        report << (p.severity == ParadoxProblem::FAILURE ? "error" : "warning");
+        if (p.block > 0) {
+            report << ", block " << p.block;
+        }
+        if (p.slot >= 0) {
+            report << ", record " << p.slot;
+        }
+        if (p.field >= 0 && p.field < columns.GetCount()) {
+            report << ", field " << columns[p.field].name;
+        }
+        report << ": " << p.text << "\n";
+    }
+    if (errors + warnings > problems.GetCount()) {
+        report << Format("%d more problems\n", errors + warnings - problems.GetCount());
+    }
+    return report;
+}
+
+// vim: ts=4 sw=4 expandtab
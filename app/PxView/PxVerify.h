@@ -0,0 +1,116 @@
+#ifndef PxVerify_h_
+#define PxVerify_h_
+
+#include "PxBlob.h"
+
+namespace Upp {
+
+// Problem found by ParadoxVerifier
+struct ParadoxProblem : Moveable<ParadoxProblem> {
+    enum { FAILURE, WARNING };
+
+    int severity = FAILURE;
+    int block = 0;   // number of the data block in the file, 0 for the whole table
+    int slot = -1;   // record in the block
+    int field = -1;
+    String text;
+};
+
+// Checks the structure of a table and of its blob file: the header, the list
+// of the data blocks (cycles, broken links, blocks out of the list), the
+// number of the records of each block and in the header, the raw data of the
+// fields and the blob pointers, which must point to a block of the .mb file
+// with the same size and modification number. All blocks of the file are read
+// once in their order by ParadoxSession::ProcessBlocks(), the blob file is
+// read in the groups of ParadoxBlobExtractor.
+class ParadoxVerifier {
+  public:
+    // 0 means the number of CPU cores
+    ParadoxVerifier &Threads(int n) {
+        threads = n;
+        return *this;
+    }
+    // Problems kept in the report, the other ones are only counted
+    ParadoxVerifier &MaxProblems(int n) {
+        maxproblems = n;
+        return *this;
+    }
+
+    // Returns false when the table could not be checked, progress gets the
+    // number of checked and all blocks and returns true to cancel
+    bool Run(ParadoxSession &px, Gate<int, int> progress = Null);
+
+    // Problems ordered by the data block and the record
+    const Vector<ParadoxProblem> &GetProblems() const {
+        return problems;
+    }
+    int GetErrorCount() const {
+        return errors;
+    }
+    int GetWarningCount() const {
+        return warnings;
+    }
+    int GetCheckedBlocks() const {
+        return checkedblocks;
+    }
+    int64 GetCheckedRecords() const {
+        return checkedrecords;
+    }
+    int64 GetCheckedBlobs() const {
+        return checkedblobs;
+    }
+    // One line for each problem
+    String GetReport(ParadoxSession &px) const;
+    String GetError() const {
+        return error;
+    }
+
+  private:
+
+    // Pointer to the blob file found in a record
+    struct BlobPointer : Moveable<BlobPointer, ParadoxBlobExtractor::Pointer> {
+        int block = 0;
+        int slot = 0;
+        int field = 0;
+    };
+
+    // Problems found by one thread, only the first ones are kept
+    struct Findings {
+        Vector<ParadoxProblem> problems;
+        int errors = 0;
+        int warnings = 0;
+        int limit = 0;
+
+        void Add(int severity, int block, int slot, int field, const String &text);
+    };
+
+    // Header and findings of one data block of the file
+    struct Block {
+        int next = 0;
+        int prev = 0;
+        int records = -1; // -1 for a broken addDataSize
+        int64 checked = 0;
+        Findings findings;
+        Vector<BlobPointer> blobs;
+    };
+
+    int threads = 0;
+    int maxproblems = 1000; // NOLINT: problems in the report
+    String error;
+    Vector<ParadoxProblem> problems;
+    int errors = 0;
+    int warnings = 0;
+    int checkedblocks = 0;
+    int64 checkedrecords = 0;
+    int64 checkedblobs = 0;
+
+    void Merge(const Findings &f);
+    static void CheckBlock(ParadoxSession &px, int number, const char *data, Block &b);
+    static void CheckChain(const ParadoxSession &px, Array<Block> &blocks, Findings &table);
+    void CheckBlobs(const ParadoxSession &px, const Vector<BlobPointer> &blobs);
+};
+
+} // namespace Upp
+#endif
+
+// vim: ts=4 sw=4 expandtab
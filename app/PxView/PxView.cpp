@@ -1,4 +1,10 @@
 #include "PxView.h"
+#include "PxImport.h"
+#include "PxCommand.h"
+
+extern "C" {
+#include "lib/paradox-mp.h"
+}
 
 using namespace Upp;
 
@@ -7,6 +13,22 @@ using namespace Upp;
 #include <Draw/iml_source.h>
 
 GUI_APP_MAIN {
+    const Vector<String> &args = CommandLine();
+    if (ParadoxCommand::IsMode(args)) {
+#ifdef PLATFORM_WIN32
+        // a GUI binary has no console of its own, the output goes to the one of
+        // the caller, which does not wait for the exit code (PxViewCli does)
+        if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+            HANDLE console = CreateFileW(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+            SetStdHandle(STD_OUTPUT_HANDLE, console);
+            SetStdHandle(STD_ERROR_HANDLE, console);
+            freopen("CONOUT$", "w", stderr); // NOLINT: memory profile of pxlib
+        }
+#endif
+        ParadoxCommand::Run(args);
+        return;
+    }
+
     PxView().Sizeable().Zoomable().Run();
 }
 
@@ -56,6 +78,8 @@ void PxView::MenuFile(Bar &menu) {
     menu.Add(t_("Open directory"), CtrlImg::open(), [=] { OpenDirectory(); })
         .Key(K_CTRL_D)
         .Help(t_("Open all DB files in the selected directory for view"));
+    menu.Add(t_("Import CSV/NDJSON file"), [=] { ImportFile(); })
+        .Help(t_("Create a new DB file or append the records to an existing one"));
     menu.Add(enable, t_("Close DB file"), CtrlImg::open(), [=] { RemoveTab(); })
         .Key(K_CTRL_Q)
         .Help(t_("Close the currently displayed DB file"));
@@ -64,6 +88,7 @@ void PxView::MenuFile(Bar &menu) {
 
 void PxView::MenuDB(Bar &menu) {
     bool enable = false;
+    bool compact = false;
 
     if (tab.GetCount() > 0) {
         int curTab = tab.Get();
@@ -71,14 +96,30 @@ void PxView::MenuDB(Bar &menu) {
         auto *px = dynamic_cast<PxRecordView *>(myTab.GetSlave());
         if (px != nullptr && px->IsDBOpen()) {
             enable = true;
+            compact = px->CanCompact();
         }
     }
 
     menu.Add(enable, t_("Show DB info"), [=] { ShowInfo(); });
+    menu.Add(enable, t_("Show I/O statistics"), [=] { ShowStatistics(); })
+        .Help(t_("Show the file access, decoding and time counters of the current DB file"));
     menu.Separator();
     menu.Add(enable, t_("Change characters encoding"), [=] { ChangeCharset(); });
     menu.Separator();
-    menu.Add(enable, t_("Delete current row"), [=] { DeleteRow(); });
+    menu.Add(enable, t_("Delete selected rows"), [=] { DeleteRow(); });
+    menu.Add(enable && compact, t_("Compact table"), [=] { CompactTable(); })
+        .Help(t_("Fill the data blocks completely and remove the empty ones from the DB file"));
+    menu.Add(t_("Journal the changes"), [=] { ToggleJournal(); })
+        .Check(journal)
+        .Help(t_("Write the changes to a journal file first, an interrupted write is finished when the DB file is opened"));
+    menu.Add(t_("Profile the memory"), [=] { ToggleMemoryProfile(); })
+        .Check(memprof)
+        .Help(t_("Track the memory allocated by pxlib for the DB files opened afterwards"));
+    menu.Add(memprof, t_("Show memory profile"), [=] { ShowMemoryProfile(); })
+        .Help(t_("Show the memory allocated by pxlib for each caller"));
+    menu.Separator();
+    menu.Add(enable, t_("Run SQL query"), [=] { RunQuery(); })
+        .Help(t_("Query the tables in the directory of the current DB file"));
     menu.Separator();
     menu.Add(enable, t_("Export current DB to CSV"), CtrlImg::save(), [=] { SaveAs(csv); })
         .Help(t_("Save current DB file in the CSV format to the directory..."));
@@ -89,6 +130,8 @@ void PxView::MenuDB(Bar &menu) {
         .Help(t_("Save current DB file in the JSON format to the directory..."));
     menu.Add(enable, t_("Export all DBs to JSON"), CtrlImg::save(), [=] { SaveAllAs(json); })
         .Help(t_("Save all opened DB files in the JSON format to the directory..."));
+    menu.Add(enable, t_("Extract all blobs"), CtrlImg::save(), [=] { ExtractBlobs(); })
+        .Help(t_("Save the data of all blob fields of current DB file to the directory..."));
     menu.Separator();
     menu.Add(enable, t_("Send current row using HTTPS (application/json)"), [=] { ExportJson(); });
     menu.Add(enable, t_("Send ALL rows using HTTPS (application/json)"), [=] { ExportAllJson(); });
@@ -124,6 +167,53 @@ void PxView::OpenDirectory() {
     }
 }
 
+void PxView::ImportFile() {
+    FileSel source;
+    source.Type(t_("CSV and NDJSON files (*.csv, *.ndjson, *.jsonl)"), "*.csv *.ndjson *.jsonl *.json")
+        .Type(t_("all files"), "*")
+        .ActiveDir(GetHomeDirectory());
+    if (!source.ExecuteOpen(t_("Select file to import"))) {
+        return;
+    }
+
+    fileSel.ClearFiles();
+    if (!fileSel.ExecuteSaveAs(t_("Select the DB file to create or to append the records to"))) {
+        return;
+    }
+    String filePath = fileSel.Get();
+    if (GetFileExt(filePath).IsEmpty()) {
+        filePath << ".db";
+    }
+
+    // the table is reopened with the imported records
+    for (int i = 0; i < tab.GetCount(); ++i) {
+        TabCtrl::Item &myTab = tab.GetItem(i);
+        auto *px = dynamic_cast<PxRecordView *>(myTab.GetSlave());
+        if (px != nullptr && px->GetFilePath().IsEqual(filePath)) {
+            RemovePxRecordView(filePath);
+            tab.Remove(i);
+            break;
+        }
+    }
+
+    Progress pi(t_("Importing records"));
+    ParadoxImporter importer;
+    int count = importer.Import(source.Get(), filePath, [&](int64 done, int64 total) {
+        pi.Set(int(done >> 10), int(total >> 10)); // NOLINT: progress in kB
+        return pi.Canceled();
+    });
+
+    if (count < 0) {
+        ErrorOK(Format("%s: %s", t_("Error importing the file"), DeQtf(importer.GetError())));
+    } else {
+        PromptOK(Format(t_("Imported records: %d"), count));
+    }
+
+    if (FileExists(filePath)) {
+        LoadFile(filePath);
+    }
+}
+
 void PxView::LoadFile(const String &filePath) {
     for (int i = 0; i < tab.GetCount(); ++i) {
         TabCtrl::Item &myTab = tab.GetItem(i);
@@ -152,6 +242,15 @@ void PxView::ShowInfo() {
     }
 }
 
+void PxView::ShowStatistics() {
+    int curTab = tab.Get();
+    TabCtrl::Item &myTab = tab.GetItem(curTab);
+    auto *px = dynamic_cast<PxRecordView *>(myTab.GetSlave());
+    if (px != nullptr) {
+        px->ShowStatistics();
+    }
+}
+
 void PxView::ChangeCharset() {
     int curTab = tab.Get();
     TabCtrl::Item &myTab = tab.GetItem(curTab);
@@ -170,6 +269,33 @@ void PxView::DeleteRow() {
     }
 }
 
+void PxView::CompactTable() {
+    int curTab = tab.Get();
+    TabCtrl::Item &myTab = tab.GetItem(curTab);
+    auto *px = dynamic_cast<PxRecordView *>(myTab.GetSlave());
+    if (px != nullptr) {
+        px->CompactTable();
+    }
+}
+
+void PxView::RunQuery() {
+    int curTab = tab.Get();
+    TabCtrl::Item &myTab = tab.GetItem(curTab);
+    auto *px = dynamic_cast<PxRecordView *>(myTab.GetSlave());
+    if (px != nullptr) {
+        px->RunQuery();
+    }
+}
+
+void PxView::ExtractBlobs() {
+    int curTab = tab.Get();
+    TabCtrl::Item &myTab = tab.GetItem(curTab);
+    auto *px = dynamic_cast<PxRecordView *>(myTab.GetSlave());
+    if (px != nullptr) {
+        px->ExtractBlobs();
+    }
+}
+
 void PxView::SaveAs(int fileType) {
     fileSel.ClearFiles();
     if (!fileSel.ExecuteSelectDir(t_("Select directory to save the file"))) {
@@ -225,6 +351,75 @@ void PxView::ExportAllJson() {
     }
 }
 
+void PxView::ToggleJournal() {
+    journal = !journal;
+    for (PxRecordView &view : pxArray) {
+        view.Journal(journal);
+    }
+}
+
+void PxView::ToggleMemoryProfile() {
+    // the sessions allocate by the profiler when their DB file is opened
+    memprof = !memprof;
+    ParadoxSession::MemoryProfile(memprof);
+    if (memprof) {
+        PX_mp_init();
+    } else {
+        PX_mp_done();
+    }
+}
+
+void PxView::ShowMemoryProfile() {
+    // the report of pxlib is written to a temporary file and shown in a table
+    FILE *fp = tmpfile(); // NOLINT: C code
+    if (fp == nullptr) {
+        return;
+    }
+    PX_mp_report(fp);
+    rewind(fp);
+    String report;
+    char buffer[1024];
+    size_t n = 0;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        report.Cat(buffer, int(n));
+    }
+    fclose(fp);
+
+    // the first line holds the column names, the last one the totals
+    Vector<String> lines = Split(report, '\n');
+    if (lines.GetCount() < 2) {
+        return;
+    }
+
+    TopWindow w;
+    ArrayCtrl callers;
+    Label total;
+
+    Vector<String> columns = Split(lines[0], '\t');
+    for (const String &column : columns) {
+        callers.AddColumn(column);
+    }
+    for (int i = 1; i < lines.GetCount() - 1; ++i) {
+        Vector<String> cells = Split(lines[i], '\t', false);
+        Vector<Value> row;
+        for (int c = 0; c < cells.GetCount(); ++c) {
+            // the counters are sorted as numbers, the caller as text
+            row.Add(c < columns.GetCount() - 1 ? Value(ScanInt64(cells[c])) : Value(cells[c]));
+        }
+        callers.Add(row);
+    }
+    callers.AutoHideSb().OddRowColor();
+    total.SetText(lines.Top());
+
+    w.Title(t_("Memory profile"));
+    w.SetRect(0, 0, ProfileSizeHorz, ProfileSizeVert);
+    w.Sizeable();
+    w.Add(callers.HSizePos().VSizePos(0, Draw::GetStdFontCy() + 4)); // NOLINT: status line
+    w.Add(total.HSizePos(4, 4).BottomPos(0, Draw::GetStdFontCy() + 4)); // NOLINT: status line
+
+    w.Run();
+}
+
 void PxView::ToggleLang() {
     Size langSize = lang.GetSize();
 
@@ -290,7 +485,9 @@ void PxView::RemovePxRecordView(const Upp::String &filePath) {
 PxRecordView *PxView::GetPxRecordView(const Upp::String &filePath) {
     int index = FindPxRecordView(filePath);
     if (index == -1) {
-        pxArray.Create<PxRecordView>().OpenDB(filePath);
+        PxRecordView &view = pxArray.Create<PxRecordView>();
+        view.Journal(journal);
+        view.OpenDB(filePath);
         index = FindPxRecordView(filePath);
     }
     if (index > -1 && index < pxArray.GetCount()) {
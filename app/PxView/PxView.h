@@ -24,10 +24,15 @@ class PxView : public Upp::WithPxViewLayout<Upp::TopWindow> {
     ~PxView() override {};
 
     void ShowInfo();
+    void ShowStatistics();
     void ChangeCharset();
     void DeleteRow();
+    void CompactTable();
     void ExportJson();
     void ExportAllJson();
+    void RunQuery();
+    void ExtractBlobs();
+    void ShowMemoryProfile();
 
   private:
     Upp::Array<PxRecordView> pxArray;
@@ -38,6 +43,11 @@ class PxView : public Upp::WithPxViewLayout<Upp::TopWindow> {
     Upp::MenuBar menuBar;
     Upp::StatusBar statusBar;
     int currentLang = Upp::GetCurrentLanguage();
+    bool journal = false;
+    bool memprof = false;
+
+    const int ProfileSizeHorz = 800;
+    const int ProfileSizeVert = 400;
 
     void Exit();
     void MakeMenu();
@@ -47,12 +57,15 @@ class PxView : public Upp::WithPxViewLayout<Upp::TopWindow> {
 
     void OpenFile();
     void OpenDirectory();
+    void ImportFile();
     void LoadFile(const Upp::String &filePath);
 
     void SaveAs(int fileType);
     void SaveAllAs(int fileType);
 
     void ToggleLang();
+    void ToggleJournal();
+    void ToggleMemoryProfile();
     void RemoveTab();
     void CountRows();
 
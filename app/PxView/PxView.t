@@ -49,8 +49,8 @@ csCZ("Zobrazit informace o DB")
 T_("Change characters encoding")
 csCZ("Zm\304\233na k\303\263dov\303\241n\303\255 znak\305\257")
 
-T_("Delete current row")
-csCZ("Smazat aktu\303\241ln\303\255 \305\231\303\241dek")
+T_("Delete selected rows")
+csCZ("Smazat vybran\303\251 \305\231\303\241dky")
 
 T_("Export current DB to CSV")
 csCZ("Exportovat aktu\303\241ln\303\255 datab\303\241zi do CSV")
@@ -102,6 +102,75 @@ csCZ("Vyberte adres\303\241\305\231 pro ulo\305\276en\303\255 soubor\305\257")
 T_("Visible rows:")
 csCZ("Zobrazen\303\251 \305\231\303\241dky:")
 
+T_("Run SQL query")
+csCZ("Spustit SQL dotaz")
+
+T_("Query the tables in the directory of the current DB file")
+csCZ("Dotaz nad tabulkami v adres\303\241\305\231i aktu\303\241ln\303\255ho datab\303\241zov\303\251ho souboru")
+
+T_("Extract all blobs")
+csCZ("Ulo\305\276it v\305\241echny bloby")
+
+T_("Save the data of all blob fields of current DB file to the directory...")
+csCZ("Ulo\305\276it data v\305\241ech blob pol\303\255 aktu\303\241ln\303\255ho DB souboru do adres\303\241\305\231e...")
+
+T_("Compact table")
+csCZ("Zhustit tabulku")
+
+T_("Fill the data blocks completely and remove the empty ones from the DB file")
+csCZ("Zcela zaplnit datov\303\251 bloky a odstranit pr\303\241zdn\303\251 bloky ze souboru DB")
+
+T_("Import CSV/NDJSON file")
+csCZ("Importovat soubor CSV/NDJSON")
+
+T_("Create a new DB file or append the records to an existing one")
+csCZ("Vytvo\305\231it nov\303\275 DB soubor nebo p\305\231ipojit z\303\241znamy k existuj\303\255c\303\255mu")
+
+T_("CSV and NDJSON files (*.csv, *.ndjson, *.jsonl)")
+csCZ("Soubory CSV a NDJSON (*.csv, *.ndjson, *.jsonl)")
+
+T_("Select file to import")
+csCZ("Vyberte soubor k importu")
+
+T_("Select the DB file to create or to append the records to")
+csCZ("Vyberte DB soubor, kter\303\275 se vytvo\305\231\303\255 nebo ke kter\303\251mu se p\305\231ipoj\303\255 z\303\241znamy")
+
+T_("Importing records")
+csCZ("Import z\303\241znam\305\257")
+
+T_("Error importing the file")
+csCZ("Chyba p\305\231i importu souboru")
+
+T_("Imported records: %d")
+csCZ("Importovan\303\251 z\303\241znamy: %d")
+
+T_("Show I/O statistics")
+csCZ("Zobrazit statistiku I/O")
+
+T_("Show the file access, decoding and time counters of the current DB file")
+csCZ("Zobrazit po\304\215\303\255tadla p\305\231\303\255stup\305\257 k souboru, dek\303\263dov\303\241n\303\255 a \304\215as\305\257 aktu\303\241ln\303\255ho DB souboru")
+
+T_("Journal the changes")
+csCZ("\305\275urn\303\241lovat zm\304\233ny")
+
+T_("Write the changes to a journal file first, an interrupted write is finished when the DB file is opened")
+csCZ("Zapisovat zm\304\233ny nejd\305\231\303\255ve do souboru \305\276urn\303\241lu, p\305\231eru\305\241en\303\275 z\303\241pis se dokon\304\215\303\255 p\305\231i otev\305\231en\303\255 souboru DB")
+
+T_("Profile the memory")
+csCZ("Profilovat pam\304\233\305\245")
+
+T_("Track the memory allocated by pxlib for the DB files opened afterwards")
+csCZ("Sledovat pam\304\233\305\245 alokovanou knihovnou pxlib pro pozd\304\233ji otev\305\231en\303\251 DB soubory")
+
+T_("Show memory profile")
+csCZ("Zobrazit profil pam\304\233ti")
+
+T_("Show the memory allocated by pxlib for each caller")
+csCZ("Zobrazit pam\304\233\305\245 alokovanou knihovnou pxlib pro ka\305\276d\303\251ho volaj\303\255c\303\255ho")
+
+T_("Memory profile")
+csCZ("Profil pam\304\233ti")
+
 
 // PxRecordView.cpp
 
@@ -141,6 +210,477 @@ csCZ("P\305\231enos dat HTTPS protokolem")
 T_("HTTPS data transfer: %d/%d")
 csCZ("P\305\231enos dat HTTPS protokolem: %d/%d")
 
+T_("Filter rows")
+csCZ("Filtrovat \305\231\303\241dky")
+
+T_("Show all rows")
+csCZ("Zobrazit v\305\241echny \305\231\303\241dky")
+
+T_("Invalid filter")
+csCZ("Neplatn\303\275 filtr")
+
+T_("equals")
+csCZ("rovn\303\241 se")
+
+T_("is between")
+csCZ("je mezi")
+
+T_("starts with")
+csCZ("za\304\215\303\255n\303\241 na")
+
+T_("contains")
+csCZ("obsahuje")
+
+T_("is empty")
+csCZ("je pr\303\241zdn\303\251")
+
+T_("is not empty")
+csCZ("nen\303\255 pr\303\241zdn\303\251")
+
+T_("SQL query")
+csCZ("SQL dotaz")
+
+T_("Number of rows: %d")
+csCZ("Po\304\215et \305\231\303\241dk\305\257: %d")
+
+T_("Select columns")
+csCZ("Vybrat sloupce")
+
+T_("Show")
+csCZ("Zobrazit")
+
+T_("Column")
+csCZ("Sloupec")
+
+T_("At least one column has to be selected")
+csCZ("Je nutn\303\251 vybrat alespo\305\210 jeden sloupec")
+
+T_("<%d bytes>")
+csCZ("<%d bajt\305\257>")
+
+T_("Select directory to save the blobs")
+csCZ("Vyberte adres\303\241\305\231 pro ulo\305\276en\303\255 blob\305\257")
+
+T_("Extracting blobs")
+csCZ("Ukl\303\241d\303\241n\303\255 blob\305\257")
+
+T_("Error extracting the blobs")
+csCZ("Chyba p\305\231i ukl\303\241d\303\241n\303\255 blob\305\257")
+
+T_("Extracted blobs: %d, failed: %d")
+csCZ("Ulo\305\276en\303\251 bloby: %d, chybn\303\251: %d")
+
+T_("Extracted blobs: %d")
+csCZ("Ulo\305\276en\303\251 bloby: %d")
+
+T_("Delete %d selected rows from the DB?")
+csCZ("Smazat %d vybran\303\275ch \305\231\303\241dk\305\257 z DB?")
+
+T_("Size of the table reduced from %s to %s")
+csCZ("Velikost tabulky zmen\305\241ena z %s na %s")
+
+T_("Compacting of the table has failed!")
+csCZ("Zhu\305\241t\304\233n\303\255 tabulky selhalo!")
+
+T_("I/O statistics")
+csCZ("Statistika I/O")
+
+T_("Sort rows by current column ascending")
+csCZ("Se\305\231adit \305\231\303\241dky podle aktu\303\241ln\303\255ho sloupce vzestupn\304\233")
+
+T_("Sort rows by current column descending")
+csCZ("Se\305\231adit \305\231\303\241dky podle aktu\303\241ln\303\255ho sloupce sestupn\304\233")
+
+T_("Sort rows by record number")
+csCZ("Se\305\231adit \305\231\303\241dky podle \304\215\303\255sla z\303\241znamu")
+
+T_("Show column statistics")
+csCZ("Zobrazit statistiku sloupc\305\257")
+
+T_("Computing column statistics")
+csCZ("V\303\275po\304\215et statistiky sloupc\305\257")
+
+T_("Error computing the column statistics")
+csCZ("Chyba v\303\275po\304\215tu statistiky sloupc\305\257")
+
+T_("Column statistics")
+csCZ("Statistika sloupc\305\257")
+
+T_("Field")
+csCZ("Pole")
+
+T_("Type")
+csCZ("Typ")
+
+T_("Values")
+csCZ("Hodnoty")
+
+T_("Empty")
+csCZ("Pr\303\241zdn\303\251")
+
+T_("Distinct (estimate)")
+csCZ("R\305\257zn\303\251 (odhad)")
+
+T_("Minimum")
+csCZ("Minimum")
+
+T_("Maximum")
+csCZ("Maximum")
+
+T_("Average length")
+csCZ("Pr\305\257m\304\233rn\303\241 d\303\251lka")
+
+T_("Maximum length")
+csCZ("Maxim\303\241ln\303\255 d\303\251lka")
+
+T_("From")
+csCZ("Od")
+
+T_("To")
+csCZ("Do")
+
+T_("Count")
+csCZ("Po\304\215et")
+
+T_("Recover deleted records")
+csCZ("Obnovit smazan\303\251 z\303\241znamy")
+
+T_("Recovering deleted records")
+csCZ("Obnovov\303\241n\303\255 smazan\303\275ch z\303\241znam\305\257")
+
+T_("Error recovering the deleted records")
+csCZ("Chyba obnovy smazan\303\275ch z\303\241znam\305\257")
+
+T_("No deleted records were found in %d data blocks")
+csCZ("V %d datov\303\275ch bloc\303\255ch nebyly nalezeny \305\276\303\241dn\303\251 smazan\303\251 z\303\241znamy")
+
+T_("Source")
+csCZ("Zdroj")
+
+T_("Block")
+csCZ("Blok")
+
+T_("Slot")
+csCZ("Pozice")
+
+T_("deleted")
+csCZ("smazan\303\275")
+
+T_("unlinked block")
+csCZ("odpojen\303\275 blok")
+
+T_("Export as CSV")
+csCZ("Exportovat jako CSV")
+
+T_("CSV files (*.csv)")
+csCZ("Soubory CSV (*.csv)")
+
+T_("Select file to save the recovered records")
+csCZ("Vyberte soubor pro ulo\305\276en\303\255 obnoven\303\275ch z\303\241znam\305\257")
+
+T_("Error saving the CSV file")
+csCZ("Chyba p\305\231i ukl\303\241d\303\241n\303\255 CSV souboru")
+
+T_("Recovered records: %d, rejected slots: %d, copies of records: %d")
+csCZ("Obnoven\303\251 z\303\241znamy: %d, odm\303\255tnut\303\251 pozice: %d, kopie z\303\241znam\305\257: %d")
+
+T_("Verify table")
+csCZ("Ov\304\233\305\231it tabulku")
+
+T_("Verifying the table")
+csCZ("Ov\304\233\305\231ov\303\241n\303\255 tabulky")
+
+T_("Error verifying the table")
+csCZ("Chyba p\305\231i ov\304\233\305\231ov\303\241n\303\255 tabulky")
+
+T_("No problems were found in %d data blocks, %d records and %d blobs")
+csCZ("V %d datov\303\275ch bloc\303\255ch, %d z\303\241znamech a %d blobech nebyly nalezeny \305\276\303\241dn\303\251 probl\303\251my")
+
+T_("Severity")
+csCZ("Z\303\241va\305\276nost")
+
+T_("Record")
+csCZ("Z\303\241znam")
+
+T_("Problem")
+csCZ("Probl\303\251m")
+
+T_("error")
+csCZ("chyba")
+
+T_("warning")
+csCZ("varov\303\241n\303\255")
+
+T_("Save report")
+csCZ("Ulo\305\276it zpr\303\241vu")
+
+T_("text files (*.txt)")
+csCZ("textov\303\251 soubory (*.txt)")
+
+T_("Select file to save the report")
+csCZ("Vyberte soubor pro ulo\305\276en\303\255 zpr\303\241vy")
+
+T_("Error saving the report")
+csCZ("Chyba p\305\231i ukl\303\241d\303\241n\303\255 zpr\303\241vy")
+
+T_("Errors: %d, warnings: %d, data blocks: %d, records: %d, blobs: %d")
+csCZ("Chyby: %d, varov\303\241n\303\255: %d, datov\303\251 bloky: %d, z\303\241znamy: %d, bloby: %d")
+
+T_("A table with a primary index cannot be compacted!")
+csCZ("Tabulku s prim\303\241rn\303\255m indexem nelze zhustit!")
+
+
+// PxFilter.cpp
+
+T_("Unknown field number %d")
+csCZ("Nezn\303\241m\303\251 \304\215\303\255slo sloupce %d")
+
+T_("Field '%s' can only be tested for an empty value")
+csCZ("U sloupce '%s' lze testovat pouze pr\303\241zdnou hodnotu")
+
+T_("Field '%s' is not a text field")
+csCZ("Sloupec '%s' nen\303\255 textov\303\275")
+
+T_("Value '%s' is not valid for field '%s'")
+csCZ("Hodnota '%s' nen\303\255 platn\303\241 pro pole '%s'")
+
+
+// PxSql.cpp
+
+T_("Missing ]")
+csCZ("Chyb\303\255 ]")
+
+T_("Unknown column '%s'")
+csCZ("Nezn\303\241m\303\275 sloupec '%s'")
+
+T_("Invalid date '%s'")
+csCZ("Neplatn\303\251 datum '%s'")
+
+T_("Invalid time '%s'")
+csCZ("Neplatn\303\275 \304\215as '%s'")
+
+T_("Missing constant")
+csCZ("Chyb\303\255 konstanta")
+
+T_("Table '%s' not found")
+csCZ("Tabulka '%s' nebyla nalezena")
+
+T_("Could not open table '%s'")
+csCZ("Nelze otev\305\231\303\255t tabulku '%s'")
+
+T_("Only SELECT statements are supported")
+csCZ("Podporov\303\241ny jsou pouze p\305\231\303\255kazy SELECT")
+
+T_("Missing FROM")
+csCZ("Chyb\303\255 FROM")
+
+T_("Missing NULL")
+csCZ("Chyb\303\255 NULL")
+
+T_("Missing AND")
+csCZ("Chyb\303\255 AND")
+
+T_("Unsupported LIKE pattern")
+csCZ("Nepodporovan\303\275 vzor LIKE")
+
+T_("Operator <> is not supported")
+csCZ("Oper\303\241tor <> nen\303\255 podporov\303\241n")
+
+T_("Unsupported condition")
+csCZ("Nepodporovan\303\241 podm\303\255nka")
+
+T_("Missing BY")
+csCZ("Chyb\303\255 BY")
+
+T_("ORDER BY position %d is out of range")
+csCZ("Pozice %d v ORDER BY je mimo rozsah")
+
+T_("Unexpected text at the end of the statement")
+csCZ("Neo\304\215ek\303\241van\303\275 text na konci p\305\231\303\255kazu")
+
+
+// PxBlob.cpp
+
+T_("The DB is not open")
+csCZ("DB nen\303\255 otev\305\231ena")
+
+T_("The blob file of the DB does not exist")
+csCZ("Soubor s bloby DB neexistuje")
+
+T_("Some blobs could not be read or written")
+csCZ("N\304\233kter\303\251 bloby nebylo mo\305\276n\303\251 p\305\231e\304\215\303\255st nebo zapsat")
+
+
+// PxSession.cpp
+
+T_("Writing of the modified records has failed")
+csCZ("Z\303\241pis zm\304\233n\304\233n\303\275ch z\303\241znam\305\257 selhal")
+
+
+// PxImport.cpp
+
+T_("The file %s could not be opened")
+csCZ("Soubor %s nelze otev\305\231\303\255t")
+
+T_("The file has no header line")
+csCZ("Soubor nem\303\241 \305\231\303\241dek z\303\241hlav\303\255")
+
+T_("The file contains a line which is not a JSON object")
+csCZ("Soubor obsahuje \305\231\303\241dek, kter\303\275 nen\303\255 objektem JSON")
+
+T_("There are no columns to import")
+csCZ("Nejsou \305\276\303\241dn\303\251 sloupce k importu")
+
+T_("The DB %s could not be opened")
+csCZ("DB %s nelze otev\305\231\303\255t")
+
+T_("The DB %s could not be created")
+csCZ("DB %s nelze vytvo\305\231it")
+
+T_("The records do not fit into the data block")
+csCZ("Z\303\241znamy se nevejdou do datov\303\251ho bloku")
+
+T_("Writing of the records has failed")
+csCZ("Z\303\241pis z\303\241znam\305\257 selhal")
+
+T_("Records cannot be appended to a table with a primary index")
+csCZ("Do tabulky s prim\303\241rn\303\255m indexem nelze p\305\231id\303\241vat z\303\241znamy")
+
+T_("%d records have been written before the error")
+csCZ("p\305\231ed chybou bylo zaps\303\241no %d z\303\241znam\305\257")
+
+
+// PxBench.cpp
+
+T_("The directory %s could not be created")
+csCZ("Adres\303\241\305\231 %s nelze vytvo\305\231it")
+
+
+// PxExport.cpp
+
+T_("The exported data could not be written")
+csCZ("Exportovan\303\241 data nebylo mo\305\276n\303\251 zapsat")
+
+T_("The field %d cannot be sorted")
+csCZ("Podle pole %d nelze \305\231adit")
+
+T_("The file %s could not be created")
+csCZ("Soubor %s nebylo mo\305\276n\303\251 vytvo\305\231it")
+
+T_("The file %s could not be read")
+csCZ("Soubor %s nebylo mo\305\276n\303\251 p\305\231e\304\215\303\255st")
+
+T_("The file %s could not be written")
+csCZ("Soubor %s nebylo mo\305\276n\303\251 zapsat")
+
+T_("The records could not be read")
+csCZ("Z\303\241znamy nebylo mo\305\276n\303\251 p\305\231e\304\215\303\255st")
+
+T_("The field %d does not exist")
+csCZ("Pole %d neexistuje")
+
+
+// PxProfile.cpp
+
+T_("The computation was canceled")
+csCZ("V\303\275po\304\215et byl zru\305\241en")
+
+T_("The data block %d could not be read")
+csCZ("Datov\303\275 blok %d nelze na\304\215\303\255st")
+
+
+// PxDiff.cpp
+
+T_("The tables have different fields")
+csCZ("Tabulky maj\303\255 r\305\257zn\303\241 pole")
+
+T_("The temporary files could not be written")
+csCZ("Do\304\215asn\303\251 soubory nelze zapsat")
+
+
+// PxVerify.cpp
+
+T_("The blob data are behind the end of the blob file")
+csCZ("Data blobu jsou za koncem souboru blob\305\257")
+
+T_("The blob data are behind the end of the suballocated block")
+csCZ("Data blobu jsou za koncem sd\303\255len\303\251ho bloku")
+
+T_("The blob file of the DB could not be opened")
+csCZ("Soubor blob\305\257 datab\303\241ze nelze otev\305\231\303\255t")
+
+T_("The blob has %d bytes, the blob file has %d")
+csCZ("Blob m\303\241 %d bajt\305\257, soubor blob\305\257 m\303\241 %d")
+
+T_("The blob has no place in the blob file")
+csCZ("Blob nem\303\241 m\303\255sto v souboru blob\305\257")
+
+T_("The blob has the index %d in a single blob block")
+csCZ("Blob m\303\241 index %d v bloku jednoho blobu")
+
+T_("The blob has the index %d in a suballocated block")
+csCZ("Blob m\303\241 index %d ve sd\303\255len\303\251m bloku")
+
+T_("The blob has the modification number %d, the blob file has %d")
+csCZ("Blob m\303\241 \304\215\303\255slo zm\304\233ny %d, soubor blob\305\257 m\303\241 %d")
+
+T_("The blob is used by another record too")
+csCZ("Blob pou\305\276\303\255v\303\241 i jin\303\275 z\303\241znam")
+
+T_("The blob points to %d, which is not a block of the blob file")
+csCZ("Blob ukazuje na %d, co\305\276 nen\303\255 blok souboru blob\305\257")
+
+T_("The blob points to a block of unknown type %d")
+csCZ("Blob ukazuje na blok nezn\303\241m\303\251ho typu %d")
+
+T_("The blob points to a free block")
+csCZ("Blob ukazuje na voln\303\275 blok")
+
+T_("The blob points to the header of the blob file")
+csCZ("Blob ukazuje na hlavi\304\215ku souboru blob\305\257")
+
+T_("The data block in the list has no records")
+csCZ("Datov\303\275 blok v seznamu nem\303\241 \305\276\303\241dn\303\251 z\303\241znamy")
+
+T_("The data block is not in the list")
+csCZ("Datov\303\275 blok nen\303\255 v seznamu")
+
+T_("The data of the field are not valid for its type")
+csCZ("Data pole nejsou platn\303\241 pro jeho typ")
+
+T_("The entry of the blob in the suballocated block is empty")
+csCZ("Polo\305\276ka blobu ve sd\303\255len\303\251m bloku je pr\303\241zdn\303\241")
+
+T_("The file has %d data blocks, the header has %d")
+csCZ("Soubor m\303\241 %d datov\303\275ch blok\305\257, hlavi\304\215ka m\303\241 %d")
+
+T_("The first data block %d is not in the file")
+csCZ("Prvn\303\255 datov\303\275 blok %d nen\303\255 v souboru")
+
+T_("The header has %d records, the data blocks in the list have %d")
+csCZ("Hlavi\304\215ka m\303\241 %d z\303\241znam\305\257, datov\303\251 bloky v seznamu maj\303\255 %d")
+
+T_("The last data block is %d, the header has %d")
+csCZ("Posledn\303\255 datov\303\275 blok je %d, hlavi\304\215ka m\303\241 %d")
+
+T_("The list has %d data blocks, the header has %d")
+csCZ("Seznam m\303\241 %d datov\303\275ch blok\305\257, hlavi\304\215ka m\303\241 %d")
+
+T_("The list of the data blocks returns to the data block %d")
+csCZ("Seznam datov\303\275ch blok\305\257 se vrac\303\255 k datov\303\251mu bloku %d")
+
+T_("The next data block %d is not in the file")
+csCZ("Dal\305\241\303\255 datov\303\275 blok %d nen\303\255 v souboru")
+
+T_("The previous data block is %d instead of %d")
+csCZ("P\305\231edchoz\303\255 datov\303\275 blok je %d m\303\255sto %d")
+
+T_("The record size is %d, the fields have %d bytes")
+csCZ("Velikost z\303\241znamu je %d, pole maj\303\255 %d bajt\305\257")
+
+T_("The size of the records in the data block is not valid")
+csCZ("Velikost z\303\241znam\305\257 v datov\303\251m bloku nen\303\255 platn\303\241")
+
 
 // PxView.lay
 
@@ -155,3 +695,24 @@ csCZ("Autoriza\304\215n\303\255 hlavi\304\215ka")
 
 T_("Don't ignore send errors")
 csCZ("Neignorovat chyby p\305\231i pos\303\255l\303\241n\303\255")
+
+T_("Column:")
+csCZ("Sloupec:")
+
+T_("Condition:")
+csCZ("Podm\303\255nka:")
+
+T_("Value:")
+csCZ("Hodnota:")
+
+T_("To value:")
+csCZ("Do hodnoty:")
+
+T_("Ignore case")
+csCZ("Ignorovat velikost p\303\255smen")
+
+T_("Execute")
+csCZ("Spustit")
+
+T_("Close")
+csCZ("Zav\305\231\303\255t")
@@ -6,6 +6,9 @@
 PXLIB_API void PXLIB_CALL
 PX_mp_init(void);
 
+PXLIB_API void PXLIB_CALL
+PX_mp_done(void);
+
 PXLIB_API void * PXLIB_CALL
 PX_mp_malloc(pxdoc_t *p, size_t size, const char *caller);
 
@@ -18,4 +21,7 @@ PX_mp_free(pxdoc_t *p, void *mem);
 PXLIB_API void PXLIB_CALL
 PX_mp_list_unfreed();
 
+PXLIB_API void PXLIB_CALL
+PX_mp_report(FILE *fp);
+
 #endif
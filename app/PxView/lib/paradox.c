@@ -38,6 +38,10 @@
 #ifdef WIN32
 #include <windows.h>
 #include <winbase.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include "pxversion.h"
@@ -328,7 +332,7 @@ static int build_primary_index(pxdoc_t *pxdoc) {
 		 * data yet. */
 		pindex[blockcount].data = NULL;
 		pindex[blockcount].blocknumber = blocknumber;
-		pindex[blockcount].numrecords = (get_short_le((char *) &datablockhead.addDataSize)/pxh->px_recordsize)+1;
+		pindex[blockcount].numrecords = (get_short_le_s((char *) &datablockhead.addDataSize)/pxh->px_recordsize)+1;
 
 		numrecords += pindex[blockcount].numrecords;
 		if(pindex[blockcount].numrecords == 0) {
@@ -349,10 +353,12 @@ static int build_primary_index(pxdoc_t *pxdoc) {
 	}
 
 	/* Read remaining blocks. This should not happen, but I've seen a database
-	 * where it does happen. So better check for it.
+	 * where it does happen. So better check for it. The list may return to
+	 * a block already read, so stop after the highest block number.
 	 */
 	if(blocknumber != 0) {
-		while(blocknumber > 0) {
+		int remaining = 0xffff;
+		while(blocknumber > 0 && remaining-- > 0) {
 			TDataBlock datablockhead;
 //			fprintf(stderr, "next blocknumber after creating primary index: %d\n", blocknumber);
 			if(get_datablock_head(pxdoc, pxs, blocknumber, &datablockhead) < 0) {
@@ -364,7 +370,7 @@ static int build_primary_index(pxdoc_t *pxdoc) {
 			 * data yet. */
 /*			pindex[blockcount].data = NULL;
 			pindex[blockcount].blocknumber = blocknumber;
-			pindex[blockcount].numrecords = (get_short_le((char *) &datablockhead.addDataSize)/pxh->px_recordsize)+1;
+			pindex[blockcount].numrecords = (get_short_le_s((char *) &datablockhead.addDataSize)/pxh->px_recordsize)+1;
 			pindex[blockcount].myblocknumber = 0;
 			pindex[blockcount].level = 1;
 */			blocknumber = get_short_le((const char *) &datablockhead.nextBlock);
@@ -766,6 +772,25 @@ PX_set_value(pxdoc_t *pxdoc, const char *name, float value) {
 		if(put_px_head(pxdoc, pxdoc->px_head, pxdoc->px_stream) < 0) {
 			return -1;
 		}
+	} else if(strcmp(name, "maxtablesize") == 0) {
+		/* The size of the data blocks in kB can only be changed as
+		 * long as the file has no data block.
+		 */
+		if(pxdoc->px_head->px_fileblocks > 0) {
+			px_error(pxdoc, PX_Warning, _("Block size cannot be changed when the file has data blocks."));
+			return -1;
+		}
+		/* Paradox only knows the block sizes of 1, 2, 3, 4, 8, 16 and 32 kB */
+		if((value != 1 && value != 2 && value != 3 && value != 4 &&
+		    value != 8 && value != 16 && value != 32) ||
+		   (int) value*0x400-(int)sizeof(TDataBlock) < pxdoc->px_head->px_recordsize) {
+			px_error(pxdoc, PX_Warning, _("Block size must be 1, 2, 3, 4, 8, 16 or 32 kB and hold at least one record."));
+			return -1;
+		}
+		pxdoc->px_head->px_maxtablesize = (int) value;
+		if(put_px_head(pxdoc, pxdoc->px_head, pxdoc->px_stream) < 0) {
+			return -1;
+		}
 	} else {
 		px_error(pxdoc, PX_Warning, _("There is no such value like '%s' to set."), name);
 		return -1;
@@ -838,6 +863,36 @@ PX_get_value(pxdoc_t *pxdoc, const char *name, float *value) {
 	} else if(strcmp(name, "encryption") == 0) {
 		*value = (float) pxdoc->px_head->px_encryption;
 		return(0);
+	} else if(strcmp(name, "bytesread") == 0) {
+		*value = (float) pxdoc->px_stats.bytesread;
+		return(0);
+	} else if(strcmp(name, "byteswritten") == 0) {
+		*value = (float) pxdoc->px_stats.byteswritten;
+		return(0);
+	} else if(strcmp(name, "seeks") == 0) {
+		*value = (float) pxdoc->px_stats.seeks;
+		return(0);
+	} else if(strcmp(name, "blocksread") == 0) {
+		*value = (float) pxdoc->px_stats.blocksread;
+		return(0);
+	} else if(strcmp(name, "blockswritten") == 0) {
+		*value = (float) pxdoc->px_stats.blockswritten;
+		return(0);
+	} else if(strcmp(name, "cachehits") == 0) {
+		*value = (float) pxdoc->px_stats.cachehits;
+		return(0);
+	} else if(strcmp(name, "cachemisses") == 0) {
+		*value = (float) pxdoc->px_stats.cachemisses;
+		return(0);
+	} else if(strcmp(name, "blocksdecrypted") == 0) {
+		*value = (float) pxdoc->px_stats.blocksdecrypted;
+		return(0);
+	} else if(strcmp(name, "allocations") == 0) {
+		*value = (float) pxdoc->px_stats.allocations;
+		return(0);
+	} else if(strcmp(name, "arenaallocations") == 0) {
+		*value = (float) pxdoc->px_stats.arenaallocations;
+		return(0);
 	}
 	px_error(pxdoc, PX_Warning, _("No such value name."));
 	return(-2);
@@ -1850,6 +1905,450 @@ PX_get_record2(pxdoc_t *pxdoc, int recno, char *data, int *deleted, pxdatablocki
 }
 /* }}} */
 
+/* PX_get_datablock() {{{
+ * Reads all records of one data block with a single read. The block
+ * is selected by its position in the internal primary index (level 1
+ * entries only). data must have room for at least
+ * maxtablesize*0x400-sizeof(TDataBlock) bytes. This is much faster
+ * than calling PX_get_record2() for each record when a whole table
+ * is scanned, because the block has to be located only once.
+ * Returns the number of records in the block or -1 in case of an error.
+ */
+PXLIB_API int PXLIB_CALL
+PX_get_datablock(pxdoc_t *pxdoc, int indexpos, char *data, pxdatablockinfo_t *pxdbinfo) {
+	pxhead_t *pxh = NULL;
+	pxpindex_t *pindex_data = NULL;
+	pxdatablockinfo_t tmppxdbinfo;
+	TDataBlock datablock;
+	int numrecords = 0;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(pxdoc->px_head == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("File has no header."));
+		return -1;
+	}
+	pxh = pxdoc->px_head;
+
+	pindex_data = pxdoc->px_indexdata;
+	if(!pindex_data) {
+		px_error(pxdoc, PX_RuntimeError, _("Cannot read data block without an index."));
+		return -1;
+	}
+
+	if(indexpos < 0 || indexpos >= pxdoc->px_indexdatalen || pindex_data[indexpos].level != 1) {
+		px_error(pxdoc, PX_RuntimeError, _("Data block number out of range."));
+		return -1;
+	}
+
+	tmppxdbinfo.number = pindex_data[indexpos].blocknumber;
+	tmppxdbinfo.recno = 0;
+	tmppxdbinfo.blockpos = pxh->px_headersize + (tmppxdbinfo.number-1)*pxh->px_maxtablesize*0x400;
+	tmppxdbinfo.recordpos = tmppxdbinfo.blockpos + sizeof(TDataBlock);
+
+	if(pxdoc->seek(pxdoc, pxdoc->px_stream, tmppxdbinfo.blockpos, SEEK_SET) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not fseek start of data block."));
+		return -1;
+	}
+
+	if((int)pxdoc->read(pxdoc, pxdoc->px_stream, sizeof(TDataBlock), &datablock) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not read datablock header."));
+		return -1;
+	}
+
+	tmppxdbinfo.prev = get_short_le((char *) &datablock.prevBlock);
+	tmppxdbinfo.next = get_short_le((char *) &datablock.nextBlock);
+	tmppxdbinfo.size = get_short_le_s((char *) &datablock.addDataSize)+pxh->px_recordsize;
+	numrecords = tmppxdbinfo.size/pxh->px_recordsize;
+
+	/* An empty block has addDataSize = -recordsize. Also make sure a
+	 * broken header does not let us read beyond the block. */
+	if(numrecords < 0 || numrecords > (int) ((pxh->px_maxtablesize*0x400-sizeof(TDataBlock)) / pxh->px_recordsize)) {
+		px_error(pxdoc, PX_RuntimeError, _("Number of records in data block is out of range."));
+		return -1;
+	}
+	tmppxdbinfo.numrecords = numrecords;
+
+	if(numrecords > 0) {
+		if((int)pxdoc->read(pxdoc, pxdoc->px_stream, numrecords*pxh->px_recordsize, data) < 0) {
+			px_error(pxdoc, PX_RuntimeError, _("Could not read data of data block."));
+			return -1;
+		}
+	}
+
+	if(pxdbinfo) {
+		memcpy(pxdbinfo, &tmppxdbinfo, sizeof(pxdatablockinfo_t));
+	}
+
+	return numrecords;
+}
+/* }}} */
+
+/* PX_get_rawdatablock() {{{
+ * Reads all record slots of the data block with the given number in the
+ * file (first block is 1), whether the block is in the list of data blocks
+ * or not. The slots behind the records of a block keep the data of deleted
+ * records. data must have room for maxtablesize*0x400-sizeof(TDataBlock)
+ * bytes. The header of the block is returned in pxdbinfo, its numrecords
+ * is -1 if addDataSize is out of range.
+ * Returns the number of slots in the block or -1 in case of an error.
+ */
+PXLIB_API int PXLIB_CALL
+PX_get_rawdatablock(pxdoc_t *pxdoc, int blocknumber, char *data, pxdatablockinfo_t *pxdbinfo) {
+	pxhead_t *pxh = NULL;
+	pxdatablockinfo_t tmppxdbinfo;
+	TDataBlock datablock;
+	int numslots = 0;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(pxdoc->px_head == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("File has no header."));
+		return -1;
+	}
+	pxh = pxdoc->px_head;
+
+	if(blocknumber < 1 || pxh->px_recordsize <= 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Data block number out of range."));
+		return -1;
+	}
+
+	numslots = (pxh->px_maxtablesize*0x400-sizeof(TDataBlock)) / pxh->px_recordsize;
+	tmppxdbinfo.number = blocknumber;
+	tmppxdbinfo.recno = 0;
+	tmppxdbinfo.blockpos = pxh->px_headersize + (blocknumber-1)*pxh->px_maxtablesize*0x400;
+	tmppxdbinfo.recordpos = tmppxdbinfo.blockpos + sizeof(TDataBlock);
+
+	if(pxdoc->seek(pxdoc, pxdoc->px_stream, tmppxdbinfo.blockpos, SEEK_SET) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not fseek start of data block."));
+		return -1;
+	}
+
+	if((int)pxdoc->read(pxdoc, pxdoc->px_stream, sizeof(TDataBlock), &datablock) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not read datablock header."));
+		return -1;
+	}
+
+	if((int)pxdoc->read(pxdoc, pxdoc->px_stream, numslots*pxh->px_recordsize, data) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not read data of data block."));
+		return -1;
+	}
+
+	tmppxdbinfo.prev = get_short_le((char *) &datablock.prevBlock);
+	tmppxdbinfo.next = get_short_le((char *) &datablock.nextBlock);
+	tmppxdbinfo.size = get_short_le_s((char *) &datablock.addDataSize)+pxh->px_recordsize;
+	tmppxdbinfo.numrecords = tmppxdbinfo.size/pxh->px_recordsize;
+	if(tmppxdbinfo.size < 0 || tmppxdbinfo.numrecords > numslots) {
+		tmppxdbinfo.numrecords = -1;
+	}
+
+	if(pxdbinfo) {
+		memcpy(pxdbinfo, &tmppxdbinfo, sizeof(pxdatablockinfo_t));
+	}
+
+	return numslots;
+}
+/* }}} */
+
+/* PX_put_datablock() {{{
+ * Writes the records of a data block as returned by PX_get_datablock()
+ * back into the file. indexpos is the position of the block in the
+ * primary index. numrecords must be the number of records in the block,
+ * records can be modified but not added or removed. The data is written
+ * into the block cache, the header of the file is not written. Call
+ * PX_write_header() when all modified blocks have been written.
+ * Returns the number of written records or -1 in case of an error.
+ */
+PXLIB_API int PXLIB_CALL
+PX_put_datablock(pxdoc_t *pxdoc, int indexpos, const char *data, int numrecords) {
+	pxhead_t *pxh = NULL;
+	pxpindex_t *pindex_data = NULL;
+	TDataBlock datablock;
+	long blockpos = 0;
+	int blockrecords = 0;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(pxdoc->px_head == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("File has no header."));
+		return -1;
+	}
+	pxh = pxdoc->px_head;
+
+	pindex_data = pxdoc->px_indexdata;
+	if(!pindex_data) {
+		px_error(pxdoc, PX_RuntimeError, _("Cannot write data block without an index."));
+		return -1;
+	}
+
+	if(indexpos < 0 || indexpos >= pxdoc->px_indexdatalen || pindex_data[indexpos].level != 1) {
+		px_error(pxdoc, PX_RuntimeError, _("Data block number out of range."));
+		return -1;
+	}
+
+	blockpos = pxh->px_headersize + (pindex_data[indexpos].blocknumber-1)*pxh->px_maxtablesize*0x400;
+	if(pxdoc->seek(pxdoc, pxdoc->px_stream, blockpos, SEEK_SET) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not fseek start of data block."));
+		return -1;
+	}
+
+	if((int)pxdoc->read(pxdoc, pxdoc->px_stream, sizeof(TDataBlock), &datablock) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not read datablock header."));
+		return -1;
+	}
+
+	blockrecords = (get_short_le_s((char *) &datablock.addDataSize)+pxh->px_recordsize)/pxh->px_recordsize;
+	if(blockrecords != numrecords) {
+		px_error(pxdoc, PX_RuntimeError, _("Number of records in data block has changed (%d != %d)."), numrecords, blockrecords);
+		return -1;
+	}
+
+	if(numrecords > 0) {
+		if(pxdoc->seek(pxdoc, pxdoc->px_stream, blockpos+sizeof(TDataBlock), SEEK_SET) < 0) {
+			px_error(pxdoc, PX_RuntimeError, _("Could not fseek start of records in data block."));
+			return -1;
+		}
+		if((int)pxdoc->write(pxdoc, pxdoc->px_stream, numrecords*pxh->px_recordsize, (void *) data) <= 0) {
+			px_error(pxdoc, PX_RuntimeError, _("Could not write data of data block."));
+			return -1;
+		}
+	}
+
+	return numrecords;
+}
+/* }}} */
+
+/* PX_write_header() {{{
+ * Writes the header of the file and the modified data block kept in
+ * the block cache.
+ */
+PXLIB_API int PXLIB_CALL
+PX_write_header(pxdoc_t *pxdoc) {
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(pxdoc->px_head == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("File has no header."));
+		return -1;
+	}
+
+	if(put_px_head(pxdoc, pxdoc->px_head, pxdoc->px_stream) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Unable to write file header."));
+		return -1;
+	}
+
+	return px_flush(pxdoc, pxdoc->px_stream);
+}
+/* }}} */
+
+/* px_append_autoinc() {{{
+ * Numbers the records with an empty autoincrement field like
+ * PX_put_record() does and keeps the counter in the header above the
+ * numbers given by the records.
+ */
+static void px_append_autoinc(pxdoc_t *pxdoc, char *records, int numrecords) {
+	pxhead_t *pxh = pxdoc->px_head;
+	pxfield_t *pxf = pxh->px_fields;
+	long value = 0;
+	int offset = 0;
+	int i, j;
+
+	for(i=0; i<pxh->px_numfields; i++, pxf++) {
+		if(pxf->px_ftype == pxfAutoInc) {
+			for(j=0; j<numrecords; j++) {
+				char *ptr = &records[j*pxh->px_recordsize + offset];
+				if(PX_get_data_long(pxdoc, ptr, 4, &value) > 0) {
+					if(value > pxh->px_autoinc) {
+						pxh->px_autoinc = (int) value;
+					}
+				} else {
+					pxh->px_autoinc++;
+					PX_put_data_long(pxdoc, ptr, 4, pxh->px_autoinc);
+				}
+			}
+		}
+		offset += pxf->px_flen;
+	}
+}
+/* }}} */
+
+/* PX_append_records() {{{
+ * Appends numrecords records to the end of the database. The free slots
+ * of the last data block are filled first. The remaining records are put
+ * into new data blocks, which are built in memory and written with one
+ * write each, bypassing the block cache. Empty autoincrement fields are
+ * numbered. The header of the file is not written, call PX_write_header()
+ * when all records have been appended.
+ * A database with a primary index is refused, the records would have to
+ * be sorted into the blocks by the key and the .PX file updated.
+ * Returns the number of appended records or -1 in case of an error.
+ */
+PXLIB_API int PXLIB_CALL
+PX_append_records(pxdoc_t *pxdoc, const char *data, int numrecords) {
+	pxhead_t *pxh = NULL;
+	pxstream_t *pxs = NULL;
+	pxpindex_t *pindex_data = NULL;
+	TDataBlock datablock;
+	char *block = NULL;
+	long blocksize = 0;
+	int recsperblock = 0;
+	int newblocks = 0;
+	int prevblock = 0;
+	int done = 0;
+	int n = 0;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(pxdoc->px_head == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("File has no header."));
+		return -1;
+	}
+	pxh = pxdoc->px_head;
+	pxs = pxdoc->px_stream;
+
+	if(pxdoc->px_pindex || pxh->px_filetype == pxfFileTypIndexDB) {
+		px_error(pxdoc, PX_RuntimeError, _("Records cannot be appended to a database with a primary index."));
+		return -1;
+	}
+
+	blocksize = pxh->px_maxtablesize*0x400;
+	recsperblock = (blocksize-sizeof(TDataBlock)) / pxh->px_recordsize;
+	pindex_data = pxdoc->px_indexdata;
+
+	if((block = (char *) pxdoc->malloc(pxdoc, blocksize, _("Allocate memory for data block."))) == NULL) {
+		px_error(pxdoc, PX_MemoryError, _("Could not allocate memory for data block."));
+		return -1;
+	}
+
+	/* Fill the free slots of the last block in the list */
+	if(pindex_data && pxdoc->px_indexdatalen > 0) {
+		pxpindex_t *last = &pindex_data[pxdoc->px_indexdatalen-1];
+		prevblock = last->blocknumber;
+		n = recsperblock - last->numrecords;
+		if(n > numrecords) {
+			n = numrecords;
+		}
+		if(n > 0) {
+			long recordpos = pxh->px_headersize + (prevblock-1)*blocksize + sizeof(TDataBlock) + last->numrecords*pxh->px_recordsize;
+			if(get_datablock_head(pxdoc, pxs, prevblock, &datablock) < 0) {
+				px_error(pxdoc, PX_RuntimeError, _("Could not read data block header."));
+				pxdoc->free(pxdoc, block);
+				return -1;
+			}
+			memcpy(block, data, n*pxh->px_recordsize);
+			px_append_autoinc(pxdoc, block, n);
+			put_short_le((char *) &datablock.addDataSize, (last->numrecords+n-1)*pxh->px_recordsize);
+			if(put_datablock_head(pxdoc, pxs, prevblock, &datablock) < 0 ||
+			   pxdoc->seek(pxdoc, pxs, recordpos, SEEK_SET) < 0 ||
+			   pxdoc->write(pxdoc, pxs, n*pxh->px_recordsize, block) < 1) {
+				px_error(pxdoc, PX_RuntimeError, _("Could not write records into the last data block."));
+				pxdoc->free(pxdoc, block);
+				return -1;
+			}
+			last->numrecords += n;
+			pxh->px_numrecords += n;
+			done = n;
+		}
+	}
+
+	if(done == numrecords) {
+		pxdoc->free(pxdoc, block);
+		return numrecords;
+	}
+
+	newblocks = (numrecords - done + recsperblock - 1) / recsperblock;
+	if((pindex_data = pxdoc->realloc(pxdoc, pindex_data, (pxdoc->px_indexdatalen+newblocks)*sizeof(pxpindex_t), _("Allocate memory for primary index data."))) == NULL) {
+		px_error(pxdoc, PX_MemoryError, _("Could not allocate memory for primary index data."));
+		pxdoc->free(pxdoc, block);
+		return -1;
+	}
+	pxdoc->px_indexdata = pindex_data;
+
+	/* Link the last block to the first new one */
+	if(prevblock != 0) {
+		if(get_datablock_head(pxdoc, pxs, prevblock, &datablock) < 0) {
+			px_error(pxdoc, PX_RuntimeError, _("Could not read data block header."));
+			pxdoc->free(pxdoc, block);
+			return -1;
+		}
+		put_short_le((char *) &datablock.nextBlock, pxh->px_fileblocks+1);
+		if(put_datablock_head(pxdoc, pxs, prevblock, &datablock) < 0) {
+			px_error(pxdoc, PX_RuntimeError, _("Could not update data block header before new block."));
+			pxdoc->free(pxdoc, block);
+			return -1;
+		}
+	}
+
+	while(done < numrecords) {
+		int blocknumber = pxh->px_fileblocks+1;
+		pxpindex_t *entry = &pindex_data[pxdoc->px_indexdatalen];
+
+		n = numrecords - done;
+		if(n > recsperblock) {
+			n = recsperblock;
+		}
+
+		put_short_le((char *) &datablock.nextBlock, done+n < numrecords ? blocknumber+1 : 0);
+		put_short_le((char *) &datablock.prevBlock, prevblock);
+		put_short_le((char *) &datablock.addDataSize, (n-1)*pxh->px_recordsize);
+		memset(block, 0, blocksize);
+		memcpy(block, &datablock, sizeof(TDataBlock));
+		memcpy(block+sizeof(TDataBlock), data+done*pxh->px_recordsize, n*pxh->px_recordsize);
+		px_append_autoinc(pxdoc, block+sizeof(TDataBlock), n);
+
+		/* Keep the block cache in line with the file */
+		if(pxdoc->curblock && pxdoc->curblocknr == blocknumber) {
+			memcpy(pxdoc->curblock, block, blocksize);
+			pxdoc->curblockdirty = px_false;
+		}
+		if(pxh->px_encryption != 0) {
+			px_encrypt_db_block((unsigned char *) block, (unsigned char *) block, pxh->px_encryption, blocksize, blocknumber);
+		}
+
+		if(pxs->seek(pxdoc, pxs, pxh->px_headersize + (blocknumber-1)*blocksize, SEEK_SET) < 0 ||
+		   pxs->write(pxdoc, pxs, blocksize, block) < 1) {
+			px_error(pxdoc, PX_RuntimeError, _("Could not write data block %d."), blocknumber);
+			pxdoc->free(pxdoc, block);
+			return -1;
+		}
+
+		entry->data = NULL;
+		entry->blocknumber = blocknumber;
+		entry->numrecords = n;
+		entry->dummy = 0;
+		entry->myblocknumber = 0;
+		entry->level = 1;
+		pxdoc->px_indexdatalen++;
+
+		pxh->px_fileblocks++;
+		pxh->px_lastblock = blocknumber;
+		if(pxh->px_firstblock == 0) {
+			pxh->px_firstblock = blocknumber;
+		}
+		pxh->px_numrecords += n;
+		prevblock = blocknumber;
+		done += n;
+	}
+	pxdoc->free(pxdoc, block);
+
+	return numrecords;
+}
+/* }}} */
+
 /* PX_put_recordn() {{{
  * Store a record into the paradox file. The record can be saved at
  * any position. If the position is beyond the last datablock, then
@@ -2511,78 +3010,1231 @@ PX_delete_record(pxdoc_t *pxdoc, int recno) {
 }
 /* }}} */
 
-/* PX_pack() {{{
- * Packs database into the smallest possible file size by filling
- * all datablocks to its maximum number of records and deleting
- * empty datablocks.
+/* PX_delete_datablock_records() {{{
+ * Deletes the records at the positions slots (sorted, starting at 0) of
+ * the data block at position indexpos of the primary index. The block is
+ * compacted once and the blobs of the records are deleted. The header of
+ * the file is not written, call PX_write_header() when all blocks are done.
+ * Returns the remaining number of records in the block or -1 in case of
+ * an error.
  */
 PXLIB_API int PXLIB_CALL
-PX_pack(pxdoc_t *pxdoc) {
+PX_delete_datablock_records(pxdoc_t *pxdoc, int indexpos, const int *slots, int numslots) {
 	pxhead_t *pxh = NULL;
-//	pxstream_t *pxs = NULL;
 	pxpindex_t *pindex_data = NULL;
+	TDataBlock datablock;
+	char *data = NULL;
 	long blockpos = 0;
-	long blockoutpos = 0;
-	long recordpos = 0;
-	long recordoutpos = 0;
-	long blocknumber = 0;
-	long blockoutnumber = 0;
+	int numrecords = 0;
+	int remaining = 0;
+	int i = 0;
+	int j = 0;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(pxdoc->px_head == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("File has no header."));
+		return -1;
+	}
+	pxh = pxdoc->px_head;
+
+	pindex_data = pxdoc->px_indexdata;
+	if(!pindex_data) {
+		px_error(pxdoc, PX_RuntimeError, _("Cannot delete records without an index."));
+		return -1;
+	}
+
+	if(indexpos < 0 || indexpos >= pxdoc->px_indexdatalen || pindex_data[indexpos].level != 1) {
+		px_error(pxdoc, PX_RuntimeError, _("Data block number out of range."));
+		return -1;
+	}
+
+	blockpos = pxh->px_headersize + (pindex_data[indexpos].blocknumber-1)*pxh->px_maxtablesize*0x400;
+	if(pxdoc->seek(pxdoc, pxdoc->px_stream, blockpos, SEEK_SET) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not fseek start of data block."));
+		return -1;
+	}
+
+	if((int)pxdoc->read(pxdoc, pxdoc->px_stream, sizeof(TDataBlock), &datablock) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not read datablock header."));
+		return -1;
+	}
+
+	numrecords = (get_short_le_s((char *) &datablock.addDataSize)+pxh->px_recordsize)/pxh->px_recordsize;
+	for(i=0; i<numslots; i++) {
+		if(slots[i] < 0 || slots[i] >= numrecords || (i > 0 && slots[i] <= slots[i-1])) {
+			px_error(pxdoc, PX_RuntimeError, _("Record position %d is not valid in data block with %d records."), slots[i], numrecords);
+			return -1;
+		}
+	}
+	if(numslots == 0) {
+		return numrecords;
+	}
+
+	/* Delete all blobs associated with the records */
+	for(i=0; i<numslots; i++) {
+		if(px_delete_blobs(pxdoc, blockpos+sizeof(TDataBlock)+slots[i]*pxh->px_recordsize) < 0) {
+			px_error(pxdoc, PX_RuntimeError, _("Could delete blobs of record."));
+			return -1;
+		}
+	}
+
+	if((data = (char *) pxdoc->malloc(pxdoc, numrecords*pxh->px_recordsize, _("Allocate memory for data block."))) == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not allocate memory for data block."));
+		return -1;
+	}
+
+	if(pxdoc->seek(pxdoc, pxdoc->px_stream, blockpos+sizeof(TDataBlock), SEEK_SET) < 0 ||
+	   (int)pxdoc->read(pxdoc, pxdoc->px_stream, numrecords*pxh->px_recordsize, data) < 0) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not read data of data block."));
+		pxdoc->free(pxdoc, data);
+		return -1;
+	}
+
+	/* Move the remaining records to the beginning of the block */
+	for(i=0, j=0; i<numrecords; i++) {
+		if(j < numslots && slots[j] == i) {
+			j++;
+			continue;
+		}
+		if(remaining != i) {
+			memcpy(&data[remaining*pxh->px_recordsize], &data[i*pxh->px_recordsize], pxh->px_recordsize);
+		}
+		remaining++;
+	}
+
+	if(remaining > 0) {
+		if(pxdoc->seek(pxdoc, pxdoc->px_stream, blockpos+sizeof(TDataBlock), SEEK_SET) < 0 ||
+		   pxdoc->write(pxdoc, pxdoc->px_stream, remaining*pxh->px_recordsize, data) < 1) {
+			px_error(pxdoc, PX_RuntimeError, _("Could not write data of data block."));
+			pxdoc->free(pxdoc, data);
+			return -1;
+		}
+	}
+	pxdoc->free(pxdoc, data);
+
+	/* An empty block has addDataSize = -recordsize */
+	put_short_le((char *) &datablock.addDataSize, (remaining-1)*pxh->px_recordsize);
+	if(pxdoc->seek(pxdoc, pxdoc->px_stream, blockpos, SEEK_SET) < 0 ||
+	   pxdoc->write(pxdoc, pxdoc->px_stream, sizeof(TDataBlock), &datablock) < 1) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not write updated data block header."));
+		return -1;
+	}
+
+	pindex_data[indexpos].numrecords = remaining;
+	pxh->px_numrecords -= numslots;
+
+	return remaining;
+}
+/* }}} */
+
+/* Defined with the journal below */
+static int px_truncate(pxdoc_t *pxdoc, pxstream_t *pxs, long size);
+
+/* px_pack_blocks() {{{
+ * Moves the numrecords records of all data blocks in the order of the
+ * index into the physical blocks 1 to numblocks. saved has an entry for each index
+ * entry and chainpos one for each physical block.
+ */
+static int px_pack_blocks(pxdoc_t *pxdoc, int numrecords, int numblocks, char *inbuf, char *outbuf, char **saved, int *chainpos) {
+	pxhead_t *pxh = pxdoc->px_head;
+	pxpindex_t *pindex_data = pxdoc->px_indexdata;
+	pxdatablockinfo_t pxdbinfo;
+	TDataBlock datablock;
 	int recsperblock = 0;
+	int blockout = 1;
+	int nout = 0;
+	int moved = 0;
 	int i = 0;
 	int j = 0;
+	int k = 0;
 	int n = 0;
-	int jout = 0;
-	int nout = 0;
+
+	recsperblock = (pxh->px_maxtablesize*0x400-sizeof(TDataBlock)) / pxh->px_recordsize;
+	for(j=0; j<pxdoc->px_indexdatalen; j++) {
+		char *data = inbuf;
+
+		if(saved[j]) {
+			data = saved[j];
+			n = pindex_data[j].numrecords;
+		} else if((n = PX_get_datablock(pxdoc, j, inbuf, &pxdbinfo)) != pindex_data[j].numrecords) {
+			px_error(pxdoc, PX_RuntimeError, _("Number of records of block stored in index (%d) is unequal to number of records stored in block header (%d)."), pindex_data[j].numrecords, n);
+			return -1;
+		}
+
+		for(i=0; i<n; i++) {
+			memcpy(&outbuf[nout*pxh->px_recordsize], &data[i*pxh->px_recordsize], pxh->px_recordsize);
+			nout++;
+			moved++;
+			/* The last block is written when all records are in */
+			if(nout < recsperblock && moved < numrecords) {
+				continue;
+			}
+
+			/* Keep the records of a block, which has not been read yet */
+			k = chainpos[blockout];
+			if(k > j && !saved[k]) {
+				if((saved[k] = (char *) pxdoc->malloc(pxdoc, pxh->px_maxtablesize*0x400, _("Allocate memory for saved data block."))) == NULL) {
+					px_error(pxdoc, PX_MemoryError, _("Could not allocate memory for saved data block."));
+					return -1;
+				}
+				if(PX_get_datablock(pxdoc, k, saved[k], &pxdbinfo) < 0) {
+					return -1;
+				}
+			}
+
+			put_short_le((char *) &datablock.prevBlock, blockout-1);
+			put_short_le((char *) &datablock.nextBlock, blockout < numblocks ? blockout+1 : 0);
+			put_short_le((char *) &datablock.addDataSize, (nout-1)*pxh->px_recordsize);
+			if(put_datablock_head(pxdoc, pxdoc->px_stream, blockout, &datablock) < 0 ||
+			   pxdoc->write(pxdoc, pxdoc->px_stream, nout*pxh->px_recordsize, outbuf) < 1) {
+				px_error(pxdoc, PX_RuntimeError, _("Could not write data block %d."), blockout);
+				return -1;
+			}
+			blockout++;
+			nout = 0;
+		}
+	}
+
+	return 0;
+}
+/* }}} */
+
+/* PX_pack() {{{
+ * Packs database into the smallest possible file size by filling
+ * all datablocks to its maximum number of records and deleting
+ * empty datablocks.
+ * The records are streamed block by block in the order of the block
+ * list into the physical blocks 1, 2, ... which are linked in this
+ * order. A block which would be overwritten before it was read is kept
+ * in memory until its records are moved. The file is truncated behind
+ * the last used block and the internal primary index is rebuild.
+ * A table with a primary index is not packed. Its .PX file points to the
+ * old blocks and is not rebuild here.
+ * Returns the number of data blocks or -1 in case of an error.
+ */
+PXLIB_API int PXLIB_CALL
+PX_pack(pxdoc_t *pxdoc) {
+	pxhead_t *pxh = NULL;
+	pxpindex_t *pindex_data = NULL;
+	char **saved = NULL;
+	char *inbuf = NULL;
+	char *outbuf = NULL;
+	int *chainpos = NULL;
+	long blocksize = 0;
+	int recsperblock = 0;
+	int numblocks = 0;
+	int numrecords = 0;
+	int numentries = 0;
+	int ret = -1;
+	int i = 0;
+	int j = 0;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(pxdoc->px_head == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("File has no header."));
+		return -1;
+	}
+	pxh = pxdoc->px_head;
+
+	pindex_data = pxdoc->px_indexdata;
+	if(!pindex_data) {
+		px_error(pxdoc, PX_RuntimeError, _("Cannot pack database without an index."));
+		return -1;
+	}
+
+	if(pxdoc->px_pindex || pxh->px_filetype == pxfFileTypIndexDB) {
+		px_error(pxdoc, PX_RuntimeError, _("Packing of a database with a primary index is not supported, its .PX file would be out of date."));
+		return -1;
+	}
+
+	blocksize = pxh->px_maxtablesize*0x400;
+	recsperblock = (blocksize-sizeof(TDataBlock)) / pxh->px_recordsize;
+
+	numentries = pxdoc->px_indexdatalen;
+	for(j=0; j<numentries; j++) {
+		if(pindex_data[j].level != 1 || pindex_data[j].blocknumber < 1 || pindex_data[j].blocknumber > pxh->px_fileblocks) {
+			px_error(pxdoc, PX_RuntimeError, _("Index entry %d does not point to a data block."), j);
+			return -1;
+		}
+		numrecords += pindex_data[j].numrecords;
+	}
+	numblocks = (numrecords + recsperblock - 1) / recsperblock;
+
+	inbuf = (char *) pxdoc->malloc(pxdoc, blocksize, _("Allocate memory for data block."));
+	outbuf = (char *) pxdoc->malloc(pxdoc, blocksize, _("Allocate memory for data block."));
+	saved = (char **) pxdoc->malloc(pxdoc, (numentries+1)*sizeof(char *), _("Allocate memory for saved data blocks."));
+	chainpos = (int *) pxdoc->malloc(pxdoc, (pxh->px_fileblocks+1)*sizeof(int), _("Allocate memory for list of data blocks."));
+	if(inbuf && outbuf && saved && chainpos) {
+		memset(saved, 0, (numentries+1)*sizeof(char *));
+		for(i=0; i<=pxh->px_fileblocks; i++) {
+			chainpos[i] = -1;
+		}
+		for(j=0; j<numentries; j++) {
+			chainpos[pindex_data[j].blocknumber] = j;
+		}
+		ret = px_pack_blocks(pxdoc, numrecords, numblocks, inbuf, outbuf, saved, chainpos);
+	} else {
+		px_error(pxdoc, PX_MemoryError, _("Could not allocate memory for packing the database."));
+	}
+
+	if(saved) {
+		for(j=0; j<numentries; j++) {
+			if(saved[j]) {
+				pxdoc->free(pxdoc, saved[j]);
+			}
+		}
+		pxdoc->free(pxdoc, saved);
+	}
+	if(chainpos) {
+		pxdoc->free(pxdoc, chainpos);
+	}
+	if(inbuf) {
+		pxdoc->free(pxdoc, inbuf);
+	}
+	if(outbuf) {
+		pxdoc->free(pxdoc, outbuf);
+	}
+	if(ret < 0) {
+		return -1;
+	}
+
+	/* Update the header and cut off the unused blocks */
+	pxh->px_fileblocks = numblocks;
+	pxh->px_firstblock = numblocks > 0 ? 1 : 0;
+	pxh->px_lastblock = numblocks;
+	if(PX_write_header(pxdoc) < 0) {
+		return -1;
+	}
+
+	if(px_truncate(pxdoc, pxdoc->px_stream, pxh->px_headersize + numblocks*blocksize) < 0) {
+		px_error(pxdoc, PX_Warning, _("Could not truncate the file behind the last data block."));
+	}
+
+	/* An empty index cannot be allocated */
+	if(numblocks == 0) {
+		pxdoc->px_indexdatalen = 0;
+	} else if(build_primary_index(pxdoc) < 0) {
+		return -1;
+	}
+
+	return numblocks;
+}
+/* }}} */
+
+/* Write-ahead journal {{{
+ * While the journal is in use, the data written to the .DB file and to
+ * its .MB file is kept in memory. PX_commit_journal() writes it to the
+ * journal file, syncs the journal and its directory and only then writes
+ * the data to the files. If the program stops in between,
+ * PX_replay_journal() finishes the writing before the file is opened
+ * again. An incomplete journal is ignored, the files have not been
+ * touched yet.
+ *
+ * The journal file starts with "PXJ2", the number of files and their
+ * names. The first file is the .DB file and has no name, the other ones
+ * are in the directory of the .DB file. The changes follow as (file,
+ * kind, offset, length, data), a change is either a write of the data
+ * or the truncation of the file at offset. The journal ends with "PXJC",
+ * the number of changes and the checksum of all bytes before "PXJC".
+ * File and kind are stored as 2 byte, offsets as 8 byte and the other
+ * numbers as 4 byte little endian values.
+ */
+#define PX_JOURNAL_MAGIC "PXJ2"
+#define PX_JOURNAL_COMMIT "PXJC"
+#define PX_JOURNAL_TRAILER 12
+#define PX_JOURNAL_ENTRYHEAD 16
+#define PX_JOURNAL_MAXFILES 4
+
+#define pxjWrite 0
+#define pxjTruncate 1
+
+typedef struct px_journal_entry {
+	int file;
+	int kind;
+	long offset;
+	long len;
+	char *data;
+} pxjournalentry_t;
+
+typedef struct px_journal_file {
+	char *filename;       /* NULL for the .DB file */
+	pxstream_t *stream;   /* NULL if the file is not open */
+	/* stream functions of the file */
+	ssize_t (*read)(pxdoc_t *p, pxstream_t *stream, size_t numbytes, void *buffer);
+	int (*seek)(pxdoc_t *p, pxstream_t *stream, long offset, int whence);
+	long (*tell)(pxdoc_t *p, pxstream_t *stream);
+	ssize_t (*write)(pxdoc_t *p, pxstream_t *stream, size_t numbytes, void *buffer);
+	long pos;      /* position in the file with the pending writes */
+	long size;     /* size of the file with the pending writes */
+	long base;     /* size of the file without the truncated data */
+} pxjournalfile_t;
+
+typedef struct px_journal {
+	char *filename;
+	pxjournalfile_t files[PX_JOURNAL_MAXFILES];
+	int numfiles;
+	pxjournalentry_t *entries;
+	int numentries;
+	int maxentries;
+} pxjournal_t;
+
+/* px_journal_checksum() {{{
+ * FNV-1a hash of the journal data.
+ */
+static unsigned long px_journal_checksum(unsigned long sum, const char *data, long len) {
+	long i;
+
+	for(i=0; i<len; i++) {
+		sum = ((sum ^ (unsigned char) data[i]) * 16777619UL) & 0xffffffffUL;
+	}
+	return sum;
+}
+/* }}} */
+
+/* px_put_offset() {{{
+ * Stores an offset as 8 byte little endian value.
+ */
+static void px_put_offset(char *cp, long offset) {
+	unsigned long long value = (unsigned long long) offset;
+
+	put_long_le(cp, (long) (value & 0xffffffffULL));
+	put_long_le(cp+4, (long) (value >> 32));
+}
+/* }}} */
+
+/* px_get_offset() {{{
+ */
+static long long px_get_offset(const char *cp) {
+	unsigned long long value = (unsigned long) get_long_le(cp+4) & 0xffffffffUL;
+
+	return (long long) ((value << 32) | ((unsigned long) get_long_le(cp) & 0xffffffffUL));
+}
+/* }}} */
+
+/* px_fsync() {{{
+ * Writes the buffered data of the file to the disk.
+ */
+static int px_fsync(FILE *fp) {
+	if(fflush(fp) != 0) {
+		return -1;
+	}
+#ifdef WIN32
+	return _commit(_fileno(fp));
+#else
+	return fsync(fileno(fp));
+#endif
+}
+/* }}} */
+
+/* px_fsync_dir() {{{
+ * Writes the directory entries of the directory of filename to the
+ * disk, e.g. after a file has been created or removed. Windows has no
+ * such call, the file system keeps its metadata in its own journal.
+ */
+static int px_fsync_dir(pxdoc_t *pxdoc, const char *filename) {
+#ifdef WIN32
+	(void)pxdoc;
+	(void)filename;
+	return 0;
+#else
+	const char *sep = strrchr(filename, '/');
+	long len = sep == NULL ? 1 : (sep == filename ? 1 : sep - filename);
+	char *dir = NULL;
+	int fd = -1;
+	int ret = -1;
+
+	if(NULL == (dir = pxdoc->malloc(pxdoc, len+1, _("Allocate memory for directory name.")))) {
+		return -1;
+	}
+	memcpy(dir, sep == NULL ? "." : filename, len);
+	dir[len] = '\0';
+	if((fd = open(dir, O_RDONLY)) >= 0) {
+		ret = fsync(fd);
+		close(fd);
+	}
+	pxdoc->free(pxdoc, dir);
+	return ret;
+#endif
+}
+/* }}} */
+
+/* px_truncate_fp() {{{
+ * Cuts off the file behind size bytes.
+ */
+static int px_truncate_fp(FILE *fp, long size) {
+	if(fflush(fp) != 0) {
+		return -1;
+	}
+#ifdef WIN32
+	return _chsize(_fileno(fp), size);
+#else
+	return ftruncate(fileno(fp), size);
+#endif
+}
+/* }}} */
+
+/* px_basename() {{{
+ */
+static const char *px_basename(const char *filename) {
+	const char *name = filename;
+
+	for(; *filename; filename++) {
+		if(*filename == '/' || *filename == '\\') {
+			name = filename+1;
+		}
+	}
+	return name;
+}
+/* }}} */
+
+/* px_journal_find() {{{
+ * Returns the journaled file of the stream or NULL.
+ */
+static pxjournalfile_t *px_journal_find(pxjournal_t *pxj, pxstream_t *stream) {
+	int i;
+
+	for(i=0; i<pxj->numfiles; i++) {
+		if(pxj->files[i].stream == stream) {
+			return &pxj->files[i];
+		}
+	}
+	return NULL;
+}
+/* }}} */
+
+/* px_journal_add() {{{
+ * Appends a change to the pending changes. The journal takes the
+ * ownership of data.
+ */
+static int px_journal_add(pxdoc_t *p, pxjournal_t *pxj, int file, int kind, long offset, long len, char *data) {
+	pxjournalentry_t *e = NULL;
+
+	if(pxj->numentries == pxj->maxentries) {
+		int maxentries = pxj->maxentries > 0 ? 2*pxj->maxentries : 16;
+		pxjournalentry_t *entries = p->realloc(p, pxj->entries, maxentries*sizeof(pxjournalentry_t), _("Allocate memory for journal entries."));
+		if(entries == NULL) {
+			return -1;
+		}
+		pxj->entries = entries;
+		pxj->maxentries = maxentries;
+	}
+
+	e = &pxj->entries[pxj->numentries++];
+	e->file = file;
+	e->kind = kind;
+	e->offset = offset;
+	e->len = len;
+	e->data = data;
+	return 0;
+}
+/* }}} */
+
+/* px_journal_read() {{{
+ * Reads the file and puts the pending writes over the read data.
+ */
+static ssize_t px_journal_read(pxdoc_t *p, pxstream_t *stream, size_t numbytes, void *buffer) {
+	pxjournal_t *pxj = p->px_journal;
+	pxjournalfile_t *f = px_journal_find(pxj, stream);
+	long len = 0;
+	long got = 0;
+	long from = 0;
+	long to = 0;
+	int file = 0;
+	int i;
+
+	if(f == NULL) {
+		return -1;
+	}
+	file = f - pxj->files;
+	if(f->pos >= f->size) {
+		return 0;
+	}
+	len = (long) numbytes;
+	if(f->pos + len > f->size) {
+		len = f->size - f->pos;
+	}
+
+	/* The truncated data is not read, a later write may extend the file again */
+	if(f->pos < f->base) {
+		f->seek(p, stream, f->pos, SEEK_SET);
+		got = (long) f->read(p, stream, f->base - f->pos < len ? f->base - f->pos : len, buffer);
+		if(got < 0) {
+			got = 0;
+		}
+	}
+	if(got < len) {
+		memset((char *) buffer + got, 0, len - got);
+	}
+
+	/* The entries are in the order of writing */
+	for(i=0; i<pxj->numentries; i++) {
+		pxjournalentry_t *e = &pxj->entries[i];
+		if(e->file != file || e->kind != pxjWrite) {
+			continue;
+		}
+		from = e->offset > f->pos ? e->offset : f->pos;
+		to = e->offset + e->len < f->pos + len ? e->offset + e->len : f->pos + len;
+		if(from < to) {
+			memcpy((char *) buffer + (from - f->pos), e->data + (from - e->offset), to - from);
+		}
+	}
+	f->pos += len;
+	return len;
+}
+/* }}} */
+
+/* px_journal_write() {{{
+ * Keeps the written data in memory.
+ */
+static ssize_t px_journal_write(pxdoc_t *p, pxstream_t *stream, size_t numbytes, void *buffer) {
+	pxjournal_t *pxj = p->px_journal;
+	pxjournalfile_t *f = px_journal_find(pxj, stream);
+	pxjournalentry_t *e = NULL;
+	char *data = NULL;
+	long len = (long) numbytes;
+	int file = 0;
+	int i, j;
+
+	if(f == NULL) {
+		return -1;
+	}
+	file = f - pxj->files;
+
+	/* Entries overwritten completely are dropped, usually a block which
+	 * has been written before. Its memory is reused.
+	 */
+	for(i=0, j=0; i<pxj->numentries; i++) {
+		e = &pxj->entries[i];
+		if(e->file == file && e->kind == pxjWrite && e->offset >= f->pos && e->offset + e->len <= f->pos + len) {
+			if(data == NULL && e->len == len) {
+				data = e->data;
+			} else {
+				p->free(p, e->data);
+			}
+		} else {
+			pxj->entries[j++] = *e;
+		}
+	}
+	pxj->numentries = j;
+
+	if(data == NULL && NULL == (data = p->malloc(p, len > 0 ? len : 1, _("Allocate memory for journal entry.")))) {
+		return 0;
+	}
+	memcpy(data, buffer, len);
+	if(px_journal_add(p, pxj, file, pxjWrite, f->pos, len, data) < 0) {
+		p->free(p, data);
+		return 0;
+	}
+
+	f->pos += len;
+	if(f->pos > f->size) {
+		f->size = f->pos;
+	}
+	return len;
+}
+/* }}} */
+
+/* px_journal_seek() {{{
+ */
+static int px_journal_seek(pxdoc_t *p, pxstream_t *stream, long offset, int whence) {
+	pxjournalfile_t *f = px_journal_find(p->px_journal, stream);
+
+	if(f == NULL) {
+		return -1;
+	}
+	switch(whence) {
+		case SEEK_SET:
+			f->pos = offset;
+			break;
+		case SEEK_CUR:
+			f->pos += offset;
+			break;
+		case SEEK_END:
+			f->pos = f->size + offset;
+			break;
+	}
+	return 0;
+}
+/* }}} */
+
+/* px_journal_tell() {{{
+ */
+static long px_journal_tell(pxdoc_t *p, pxstream_t *stream) {
+	pxjournalfile_t *f = px_journal_find(p->px_journal, stream);
+
+	return f == NULL ? -1 : f->pos;
+}
+/* }}} */
+
+/* px_journal_truncate() {{{
+ * Cuts off the file of the journal at size. The pending writes behind
+ * the new end are dropped.
+ */
+static int px_journal_truncate(pxdoc_t *p, pxjournal_t *pxj, int file, long size) {
+	pxjournalfile_t *f = &pxj->files[file];
+	int i, j;
+
+	for(i=0, j=0; i<pxj->numentries; i++) {
+		pxjournalentry_t *e = &pxj->entries[i];
+		if(e->file == file && e->kind == pxjWrite && e->offset + e->len > size) {
+			if(e->offset >= size) {
+				p->free(p, e->data);
+				continue;
+			}
+			e->len = size - e->offset;
+		}
+		pxj->entries[j++] = *e;
+	}
+	pxj->numentries = j;
+
+	if(px_journal_add(p, pxj, file, pxjTruncate, size, 0, NULL) < 0) {
+		return -1;
+	}
+	f->size = size;
+	if(f->base > size) {
+		f->base = size;
+	}
+	return 0;
+}
+/* }}} */
+
+/* px_journal_attach() {{{
+ * Adds a file to the journal and returns its number. The writes to the
+ * stream of the file are kept in memory from now on. A file without a
+ * stream is written by its name.
+ */
+static int px_journal_attach(pxdoc_t *pxdoc, pxjournal_t *pxj, const char *filename, pxstream_t *pxs) {
+	pxjournalfile_t *f = NULL;
+	int i;
+
+	for(i=0; i<pxj->numfiles; i++) {
+		if(filename && pxj->files[i].filename && strcmp(pxj->files[i].filename, filename) == 0) {
+			break;
+		}
+	}
+	if(i == pxj->numfiles) {
+		if(pxj->numfiles == PX_JOURNAL_MAXFILES) {
+			px_error(pxdoc, PX_RuntimeError, _("Too many files in the journal."));
+			return -1;
+		}
+		f = &pxj->files[i];
+		memset(f, 0, sizeof(pxjournalfile_t));
+		if(filename && NULL == (f->filename = px_strdup(pxdoc, filename))) {
+			return -1;
+		}
+		pxj->numfiles++;
+	}
+
+	f = &pxj->files[i];
+	if(pxs && f->stream == NULL) {
+		f->stream = pxs;
+		f->read = pxs->read;
+		f->seek = pxs->seek;
+		f->tell = pxs->tell;
+		f->write = pxs->write;
+		f->pos = pxs->tell(pxdoc, pxs);
+		pxs->seek(pxdoc, pxs, 0, SEEK_END);
+		f->size = pxs->tell(pxdoc, pxs);
+		f->base = f->size;
+		pxs->seek(pxdoc, pxs, f->pos, SEEK_SET);
+
+		pxs->read = px_journal_read;
+		pxs->seek = px_journal_seek;
+		pxs->tell = px_journal_tell;
+		pxs->write = px_journal_write;
+	}
+	return i;
+}
+/* }}} */
+
+/* px_journal_detach() {{{
+ * Gives the stream of the file its own functions back.
+ */
+static void px_journal_detach(pxdoc_t *pxdoc, pxjournalfile_t *f) {
+	pxstream_t *pxs = f->stream;
+
+	if(pxs == NULL) {
+		return;
+	}
+	pxs->read = f->read;
+	pxs->seek = f->seek;
+	pxs->tell = f->tell;
+	pxs->write = f->write;
+	pxs->seek(pxdoc, pxs, f->pos, SEEK_SET);
+	f->stream = NULL;
+}
+/* }}} */
+
+/* px_journal_release() {{{
+ * Writes the pending changes before the stream is closed and removes
+ * the stream from the journal.
+ */
+static void px_journal_release(pxdoc_t *pxdoc, pxstream_t *pxs) {
+	pxjournal_t *pxj = pxdoc->px_journal;
+	pxjournalfile_t *f = NULL;
+
+	if(pxj && NULL != (f = px_journal_find(pxj, pxs))) {
+		PX_commit_journal(pxdoc);
+		px_journal_detach(pxdoc, f);
+	}
+}
+/* }}} */
+
+/* px_truncate() {{{
+ * Cuts off the file of the stream behind size bytes. The truncation
+ * of a journaled file is a pending change.
+ */
+static int px_truncate(pxdoc_t *pxdoc, pxstream_t *pxs, long size) {
+	pxjournal_t *pxj = pxdoc->px_journal;
+	pxjournalfile_t *f = NULL;
+
+	if(pxj && NULL != (f = px_journal_find(pxj, pxs))) {
+		return px_journal_truncate(pxdoc, pxj, f - pxj->files, size);
+	}
+	if(pxs->type != pxfIOFile || pxs->s.fp == NULL) {
+		return -1;
+	}
+	return px_truncate_fp(pxs->s.fp, size);
+}
+/* }}} */
+
+/* px_journal_clear() {{{
+ * Frees the pending writes.
+ */
+static void px_journal_clear(pxdoc_t *pxdoc, pxjournal_t *pxj) {
+	int i;
+
+	for(i=0; i<pxj->numentries; i++) {
+		if(pxj->entries[i].data) {
+			pxdoc->free(pxdoc, pxj->entries[i].data);
+		}
+	}
+	pxj->numentries = 0;
+}
+/* }}} */
+
+/* px_journal_put() {{{
+ * Writes data to the journal file and adds it to the checksum.
+ */
+static int px_journal_put(FILE *fp, const char *data, long len, unsigned long *sum) {
+	if(len > 0 && fwrite(data, 1, len, fp) != (size_t) len) {
+		return 0;
+	}
+	*sum = px_journal_checksum(*sum, data, len);
+	return 1;
+}
+/* }}} */
+
+/* px_journal_save() {{{
+ * Writes the pending writes to the journal file and syncs it.
+ */
+static int px_journal_save(pxdoc_t *pxdoc, pxjournal_t *pxj) {
+	FILE *fp = NULL;
+	char head[PX_JOURNAL_ENTRYHEAD];
+	unsigned long sum = 2166136261UL;
+	const char *name = NULL;
+	int ok = 1;
+	int i;
+
+	if(NULL == (fp = fopen(pxj->filename, "wb"))) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not create journal file '%s'."), pxj->filename);
+		return -1;
+	}
+
+	put_long_le(head, pxj->numfiles);
+	ok = px_journal_put(fp, PX_JOURNAL_MAGIC, 4, &sum) && px_journal_put(fp, head, 4, &sum);
+	for(i=0; ok && i<pxj->numfiles; i++) {
+		name = pxj->files[i].filename ? px_basename(pxj->files[i].filename) : "";
+		put_long_le(head, (long) strlen(name));
+		ok = px_journal_put(fp, head, 4, &sum) && px_journal_put(fp, name, (long) strlen(name), &sum);
+	}
+	for(i=0; ok && i<pxj->numentries; i++) {
+		pxjournalentry_t *e = &pxj->entries[i];
+		put_short_le(head, (short int) e->file);
+		put_short_le(head+2, (short int) e->kind);
+		px_put_offset(head+4, e->offset);
+		put_long_le(head+12, e->len);
+		ok = px_journal_put(fp, head, PX_JOURNAL_ENTRYHEAD, &sum) && px_journal_put(fp, e->data, e->len, &sum);
+	}
+
+	/* The journal is valid only when the trailer is on the disk */
+	put_long_le(head, pxj->numentries);
+	put_long_le(head+4, (long) sum);
+	ok = ok && fwrite(PX_JOURNAL_COMMIT, 1, 4, fp) == 4 && fwrite(head, 1, 8, fp) == 8;
+	ok = ok && px_fsync(fp) == 0;
+	fclose(fp);
+
+	/* The new journal file must be found after a crash as well */
+	ok = ok && px_fsync_dir(pxdoc, pxj->filename) == 0;
+
+	if(!ok) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not write journal file '%s'."), pxj->filename);
+		remove(pxj->filename);
+		return -1;
+	}
+	return 0;
+}
+/* }}} */
+
+/* px_journal_check() {{{
+ * Returns the number of entries of a complete journal or -1. The names
+ * of the files and the first entry are returned as well.
+ */
+static int px_journal_check(const char *buf, long size, int *numfiles, const char **names, long *namelens, const char **entries) {
+	const char *ptr = buf + 8;
+	const char *end = buf + size - PX_JOURNAL_TRAILER;
+	unsigned long sum = 0;
+	long long offset = 0;
+	long len = 0;
+	int numentries = 0;
+	int i;
+
+	if(size < 8 + PX_JOURNAL_TRAILER || memcmp(buf, PX_JOURNAL_MAGIC, 4) != 0 || memcmp(end, PX_JOURNAL_COMMIT, 4) != 0) {
+		return -1;
+	}
+
+	*numfiles = get_long_le(buf+4);
+	if(*numfiles < 1 || *numfiles > PX_JOURNAL_MAXFILES) {
+		return -1;
+	}
+	for(i=0; i<*numfiles; i++) {
+		if(end - ptr < 4) {
+			return -1;
+		}
+		len = get_long_le(ptr);
+		if(len < 0 || len > end - ptr - 4) {
+			return -1;
+		}
+		names[i] = ptr+4;
+		namelens[i] = len;
+		ptr += 4 + len;
+	}
+	/* Only the .DB file has no name */
+	if(namelens[0] != 0) {
+		return -1;
+	}
+
+	*entries = ptr;
+	while(ptr < end) {
+		if(end - ptr < PX_JOURNAL_ENTRYHEAD) {
+			return -1;
+		}
+		offset = px_get_offset(ptr+4);
+		len = get_long_le(ptr+12);
+		if(get_short_le(ptr) >= *numfiles || get_short_le(ptr+2) > pxjTruncate ||
+		   offset < 0 || (long long) (long) offset != offset || len < 0 || len > end - ptr - PX_JOURNAL_ENTRYHEAD) {
+			return -1;
+		}
+		ptr += PX_JOURNAL_ENTRYHEAD + len;
+		numentries++;
+	}
+
+	sum = px_journal_checksum(2166136261UL, buf, size - PX_JOURNAL_TRAILER);
+	if(get_long_le(end+4) != numentries || ((unsigned long) get_long_le(end+8) & 0xffffffffUL) != sum) {
+		return -1;
+	}
+	return numentries;
+}
+/* }}} */
+
+/* px_journal_open() {{{
+ * Opens a file of the journal for writing. The files other than the
+ * .DB file are created if they do not exist.
+ */
+static FILE *px_journal_open(pxdoc_t *pxdoc, const char *filename, const char *name, long namelen) {
+	const char *dirend = px_basename(filename);
+	char *path = NULL;
+	FILE *fp = NULL;
+
+	if(namelen == 0) {
+		return fopen(filename, "r+b");
+	}
+
+	if(NULL == (path = pxdoc->malloc(pxdoc, (dirend - filename) + namelen + 1, _("Allocate memory for file name.")))) {
+		return NULL;
+	}
+	memcpy(path, filename, dirend - filename);
+	memcpy(path + (dirend - filename), name, namelen);
+	path[(dirend - filename) + namelen] = '\0';
+	if(NULL == (fp = fopen(path, "r+b"))) {
+		fp = fopen(path, "w+b");
+	}
+	pxdoc->free(pxdoc, path);
+	return fp;
+}
+/* }}} */
+
+/* px_journal_apply() {{{
+ * Makes a change of the journal to the file.
+ */
+static int px_journal_apply(FILE *fp, int kind, long offset, long len, const char *data) {
+	if(kind == pxjTruncate) {
+		return px_truncate_fp(fp, offset);
+	}
+	if(fseek(fp, offset, SEEK_SET) != 0 || fwrite(data, 1, len, fp) != (size_t) len) {
+		return -1;
+	}
+	return 0;
+}
+/* }}} */
+
+/* PX_replay_journal() {{{
+ * Writes the data of a complete journal to the .DB file and its other
+ * files and removes the journal. Call it before the file is opened.
+ * Returns 1 if the journal has been replayed, 0 if there was none or it
+ * was incomplete and -1 in case of an error.
+ */
+PXLIB_API int PXLIB_CALL
+PX_replay_journal(pxdoc_t *pxdoc, const char *filename, const char *journal) {
+	FILE *fp = NULL;
+	FILE *fps[PX_JOURNAL_MAXFILES];
+	const char *names[PX_JOURNAL_MAXFILES];
+	long namelens[PX_JOURNAL_MAXFILES];
+	char *buf = NULL;
+	const char *ptr = NULL;
+	long size = 0;
+	long len = 0;
+	int numfiles = 0;
+	int numentries = 0;
+	int file = 0;
+	int ok = 1;
+	int i;
 
 	if(pxdoc == NULL) {
 		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
 		return -1;
 	}
 
-	if(pxdoc->px_head == NULL) {
+	if(NULL == (fp = fopen(journal, "rb"))) {
+		return 0;
+	}
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if(size <= 0 || NULL == (buf = pxdoc->malloc(pxdoc, size, _("Allocate memory for journal.")))) {
+		fclose(fp);
+		if(size <= 0) {
+			remove(journal);
+			return 0;
+		}
+		return -1;
+	}
+	ok = fread(buf, 1, size, fp) == (size_t) size;
+	fclose(fp);
+
+	/* A journal without the trailer has not been committed */
+	if(!ok || (numentries = px_journal_check(buf, size, &numfiles, names, namelens, &ptr)) < 0) {
+		pxdoc->free(pxdoc, buf);
+		remove(journal);
+		return 0;
+	}
+
+	memset(fps, 0, sizeof(fps));
+	for(i=0; ok && i<numentries; i++) {
+		file = get_short_le(ptr);
+		len = get_long_le(ptr+12);
+		if(fps[file] == NULL && NULL == (fps[file] = px_journal_open(pxdoc, filename, names[file], namelens[file]))) {
+			px_error(pxdoc, PX_RuntimeError, _("Could not open file '%s' to replay the journal."), filename);
+			ok = 0;
+			break;
+		}
+		ok = px_journal_apply(fps[file], get_short_le(ptr+2), (long) px_get_offset(ptr+4), len, ptr+PX_JOURNAL_ENTRYHEAD) == 0;
+		ptr += PX_JOURNAL_ENTRYHEAD + len;
+	}
+	for(i=0; i<numfiles; i++) {
+		if(fps[i]) {
+			ok = px_fsync(fps[i]) == 0 && ok;
+			fclose(fps[i]);
+		}
+	}
+	pxdoc->free(pxdoc, buf);
+
+	if(!ok) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not replay the journal of file '%s'."), filename);
+		return -1;
+	}
+	remove(journal);
+	px_fsync_dir(pxdoc, journal);
+	return 1;
+}
+/* }}} */
+
+/* PX_begin_journal() {{{
+ * Starts keeping the writes to the .DB file and its blob file in memory
+ * until PX_commit_journal() is called. A blob file set later is added
+ * to the journal as well.
+ */
+PXLIB_API int PXLIB_CALL
+PX_begin_journal(pxdoc_t *pxdoc, const char *journal) {
+	pxjournal_t *pxj = NULL;
+	pxblob_t *pxblob = NULL;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(pxdoc->px_stream == NULL || pxdoc->px_head == NULL) {
 		px_error(pxdoc, PX_RuntimeError, _("File has no header."));
 		return -1;
 	}
-	pxh = pxdoc->px_head;
-//	pxs = pxdoc->px_stream;
-	pindex_data = pxdoc->px_indexdata;
-	recsperblock = (pxh->px_maxtablesize*0x400-sizeof(TDataBlock)) / pxh->px_recordsize;
 
-	blockoutnumber = pindex_data[jout].blocknumber;
-	blockoutpos = pxh->px_headersize + (blockoutnumber-1)*pxh->px_maxtablesize*0x400;
-	for(j=0; j<pxdoc->px_indexdatalen; j++) {
-		if(pindex_data[j].level == 1) {
-			blocknumber = pindex_data[j].blocknumber;
-			blockpos = pxh->px_headersize + (blocknumber-1)*pxh->px_maxtablesize*0x400;
-			n = pindex_data[j].numrecords;
-			for(i=0; i<n; i++) {
-				recordpos = blockpos + sizeof(TDataBlock) + i*pxh->px_recordsize;
-				recordoutpos = blockoutpos + sizeof(TDataBlock) + nout*pxh->px_recordsize;
-				if(recordpos != recordoutpos) {
-					fprintf(stdout, "copy record from 0x%lX (block %d) to 0x%lX (block %d)\n", recordpos, j, recordoutpos, jout);
-				}
-				nout++;
-				if(nout > recsperblock) {
-					jout++;
-					nout = 0;
-					blockoutnumber = pindex_data[jout].blocknumber;
-					blockoutpos = pxh->px_headersize + (blockoutnumber-1)*pxh->px_maxtablesize*0x400;
-				}
-			}
+	if(pxdoc->px_journal) {
+		px_error(pxdoc, PX_RuntimeError, _("Journal is already in use."));
+		return -1;
+	}
+
+	if(NULL == (pxj = pxdoc->malloc(pxdoc, sizeof(pxjournal_t), _("Allocate memory for journal.")))) {
+		return -1;
+	}
+	memset(pxj, 0, sizeof(pxjournal_t));
+	if(NULL == (pxj->filename = px_strdup(pxdoc, journal))) {
+		pxdoc->free(pxdoc, pxj);
+		return -1;
+	}
+
+	px_journal_attach(pxdoc, pxj, NULL, pxdoc->px_stream);
+	pxblob = pxdoc->px_blob;
+	if(pxblob && pxblob->mb_stream && pxblob->mb_name) {
+		px_journal_attach(pxdoc, pxj, pxblob->mb_name, pxblob->mb_stream);
+	}
+	pxdoc->px_journal = pxj;
+
+	return 0;
+}
+/* }}} */
+
+/* PX_commit_journal() {{{
+ * Writes the pending data to the journal, syncs it, writes the data to
+ * the files, syncs them and removes the journal. The journal stays in
+ * use for the next writes.
+ */
+PXLIB_API int PXLIB_CALL
+PX_commit_journal(pxdoc_t *pxdoc) {
+	pxjournal_t *pxj = NULL;
+	FILE *fps[PX_JOURNAL_MAXFILES];
+	int ok = 1;
+	int i;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(NULL == (pxj = pxdoc->px_journal)) {
+		return 0;
+	}
+
+	/* The modified block in the cache is a pending write as well */
+	px_flush(pxdoc, pxdoc->px_stream);
+	if(pxj->numentries == 0) {
+		return 0;
+	}
+
+	if(px_journal_save(pxdoc, pxj) < 0) {
+		return -1;
+	}
+
+	/* The files without a stream are opened by their name */
+	memset(fps, 0, sizeof(fps));
+	for(i=0; i<pxj->numfiles; i++) {
+		pxstream_t *pxs = pxj->files[i].stream;
+		if(pxs && pxs->type == pxfIOFile) {
+			fps[i] = pxs->s.fp;
 		}
 	}
-	if(nout == 0) {
-		jout--;
+
+	for(i=0; ok && i<pxj->numentries; i++) {
+		pxjournalentry_t *e = &pxj->entries[i];
+		pxjournalfile_t *f = &pxj->files[e->file];
+		if(f->stream && e->kind == pxjWrite) {
+			ok = f->seek(pxdoc, f->stream, e->offset, SEEK_SET) == 0 && f->write(pxdoc, f->stream, e->len, e->data) == e->len;
+			continue;
+		}
+		if(fps[e->file] == NULL && f->stream == NULL) {
+			fps[e->file] = fopen(f->filename, "r+b");
+			if(fps[e->file] == NULL) {
+				fps[e->file] = fopen(f->filename, "w+b");
+			}
+		}
+		/* Streams other than files cannot be truncated */
+		if(fps[e->file]) {
+			ok = px_journal_apply(fps[e->file], e->kind, e->offset, e->len, e->data) == 0;
+		} else {
+			ok = f->stream != NULL;
+		}
 	}
-	if(pxdoc->px_indexdatalen > jout+1) {
-		for(i=jout; i<pxdoc->px_indexdatalen; i++) {
-			fprintf(stdout, "Block %d is empty\n", i);
+	for(i=0; i<pxj->numfiles; i++) {
+		pxjournalfile_t *f = &pxj->files[i];
+		if(fps[i]) {
+			ok = px_fsync(fps[i]) == 0 && ok;
+			if(f->stream == NULL) {
+				fclose(fps[i]);
+			}
 		}
+		f->base = f->size;
+	}
+
+	/* The journal is replayed with the next opening of the file */
+	if(!ok) {
+		px_error(pxdoc, PX_RuntimeError, _("Could not write the journal to the file."));
+		return -1;
 	}
+
+	remove(pxj->filename);
+	px_fsync_dir(pxdoc, pxj->filename);
+	px_journal_clear(pxdoc, pxj);
 	return 0;
 }
 /* }}} */
 
+/* PX_end_journal() {{{
+ * Commits the pending writes and stops the use of the journal.
+ */
+PXLIB_API int PXLIB_CALL
+PX_end_journal(pxdoc_t *pxdoc) {
+	pxjournal_t *pxj = NULL;
+	int ret = 0;
+	int i;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(NULL == (pxj = pxdoc->px_journal)) {
+		return 0;
+	}
+
+	ret = PX_commit_journal(pxdoc);
+
+	for(i=0; i<pxj->numfiles; i++) {
+		px_journal_detach(pxdoc, &pxj->files[i]);
+		if(pxj->files[i].filename) {
+			pxdoc->free(pxdoc, pxj->files[i].filename);
+		}
+	}
+	px_journal_clear(pxdoc, pxj);
+	if(pxj->entries) {
+		pxdoc->free(pxdoc, pxj->entries);
+	}
+	pxdoc->free(pxdoc, pxj->filename);
+	pxdoc->free(pxdoc, pxj);
+	pxdoc->px_journal = NULL;
+
+	return ret;
+}
+/* }}} */
+/* }}} */
+
 /* PX_close() {{{
  * Close a Paradox file, but only if it was opened with PX_open_file().
  * This function will not free any memory.
@@ -2594,6 +4246,9 @@ PX_close(pxdoc_t *pxdoc) {
 		return;
 	}
 
+	/* Write the pending data of the journal */
+	PX_end_journal(pxdoc);
+
 	/* Write modified cache block */
 	px_flush(pxdoc, pxdoc->px_stream);
 
@@ -2707,6 +4362,9 @@ PX_delete(pxdoc_t *pxdoc) {
 		pxdoc->free(pxdoc, pxdoc->curblock);
 	}
 
+	/* All memory is returned, the arena can go */
+	px_arena_delete(pxdoc);
+
 	pxdoc->free(pxdoc, pxdoc);
 }
 /* }}} */
@@ -2933,16 +4591,23 @@ PX_set_tablename(pxdoc_t *pxdoc, const char *tablename) {
 /******* Function to access Blob files *******/
 
 /* build_mb_block_list() {{{
- * Build a primary index.
+ * Build a list of all blocks in the blob file.
+ * The file is read sequentially in chunks of MBBLOCKLISTCHUNK blocks
+ * and the block headers are taken from the chunk in memory. The chunks
+ * are read from the stream directly, the block cache of px_mb_read()
+ * would grow to the size of a chunk and copy the data once more.
  */
+#define MBBLOCKLISTCHUNK 64 /* Number of 4kB blocks read at once */
 static int build_mb_block_list(pxblob_t *pxblob) {
 	pxdoc_t *pxdoc = NULL;
 	pxstream_t *pxs = NULL;
 	int i = 0;
+	int j = 0;
 	size_t filesize = 0;
 	int numblocks = 0;
+	int chunkblocks = 0;
 	pxmbblockinfo_t *blocklist = NULL;
-	TMbBlockHeader3 mbblockhead;
+	unsigned char *chunk = NULL;
 
 	pxdoc = pxblob->pxdoc;
 	pxs = pxblob->mb_stream;
@@ -2967,47 +4632,54 @@ static int build_mb_block_list(pxblob_t *pxblob) {
 		return -1;
 	}
 
-	for(i=0; i<numblocks; i++) {
-		if(pxblob->seek(pxblob, pxs, i*4096, SEEK_SET) < 0) {
-			px_error(pxdoc, PX_RuntimeError, _("Could not go to start of block in blob file."));
-			pxdoc->free(pxdoc, blocklist);
-			return -1;
-		}
+	if(NULL == (chunk = pxdoc->malloc(pxdoc, MBBLOCKLISTCHUNK*4096, _("Allocate memory for blocks of blob file.")))) {
+		pxdoc->free(pxdoc, blocklist);
+		return -1;
+	}
 
-		if(pxblob->read(pxblob, pxs, sizeof(TMbBlockHeader3), &mbblockhead) < 0) {
+	for(i=0; i<numblocks; i+=chunkblocks) {
+		chunkblocks = numblocks-i < MBBLOCKLISTCHUNK ? numblocks-i : MBBLOCKLISTCHUNK;
+		if(pxs->read(pxdoc, pxs, chunkblocks*4096, chunk) < chunkblocks*4096) {
 			px_error(pxdoc, PX_RuntimeError, _("Could not read header of block in blob file."));
+			pxdoc->free(pxdoc, chunk);
 			pxdoc->free(pxdoc, blocklist);
 			return -1;
 		}
-		blocklist[i].number = i;
-		blocklist[i].type = mbblockhead.type;
-		blocklist[i].numblocks = (int) (get_short_le((char *) &mbblockhead.numBlocks));
-//		fprintf(stderr, "Block %d is of type %d\n", i, blocklist[i].type);
-		if(blocklist[i].type == 3) {
-			int j = 0;
-			blocklist[i].numblobs = 0;
-			blocklist[i].allocspace = 0;
-
-			for(j=0; j<64; j++) {
-				TMbBlockHeader3Table mbbhtab;
-				if(pxblob->read(pxblob, pxs, sizeof(TMbBlockHeader3Table), &mbbhtab) < 0) {
-					px_error(pxdoc, PX_RuntimeError, _("Could not read blob pointer."));
-					pxdoc->free(pxdoc, blocklist);
-					return -1;
-				}
-				if(mbbhtab.offset != 0) {
-//					fprintf(stderr, "  %d. Found blob with %d x 16 bytes\n", j, mbbhtab.length);
-					blocklist[i].numblobs++;
-					blocklist[i].allocspace += mbbhtab.length;
+		if(pxdoc->px_head != NULL && pxdoc->px_head->px_encryption != 0) {
+			px_decrypt_mb_block(chunk, chunk, pxdoc->px_head->px_encryption, chunkblocks*4096);
+		}
+
+		for(j=0; j<chunkblocks; j++) {
+			unsigned char *block = chunk + j*4096;
+			TMbBlockHeader3 *mbblockhead = (TMbBlockHeader3 *) block;
+			pxmbblockinfo_t *blockinfo = &blocklist[i+j];
+
+			blockinfo->number = i+j;
+			blockinfo->type = mbblockhead->type;
+			blockinfo->numblocks = (int) (get_short_le((char *) &mbblockhead->numBlocks));
+//			fprintf(stderr, "Block %d is of type %d\n", i+j, blockinfo->type);
+			if(blockinfo->type == 3) {
+				int k = 0;
+				TMbBlockHeader3Table *mbbhtab = (TMbBlockHeader3Table *) (block + sizeof(TMbBlockHeader3));
+				blockinfo->numblobs = 0;
+				blockinfo->allocspace = 0;
+
+				for(k=0; k<64; k++) {
+					if(mbbhtab[k].offset != 0) {
+//						fprintf(stderr, "  %d. Found blob with %d x 16 bytes\n", k, mbbhtab[k].length);
+						blockinfo->numblobs++;
+						blockinfo->allocspace += mbbhtab[k].length;
+					}
 				}
+//				fprintf(stderr, "  Block of type 3 had %d blobs using %d from 235 x 16 bytes\n", blockinfo->numblobs, blockinfo->allocspace);
+			} else {
+				blockinfo->numblobs = 1;
+				blockinfo->allocspace = 0;
 			}
-//			fprintf(stderr, "  Block of type 3 had %d blobs using %d from 235 x 16 bytes\n", blocklist[i].numblobs, blocklist[i].allocspace);
-		} else {
-			blocklist[i].numblobs = 1;
-			blocklist[i].allocspace = 0;
 		}
-
 	}
+	pxdoc->free(pxdoc, chunk);
+
 	if(NULL != pxblob->blocklist) {
 		pxdoc->free(pxdoc, pxblob->blocklist);
 	}
@@ -3186,6 +4858,11 @@ PX_close_blob(pxblob_t *pxblob) {
 		px_error(pxdoc, PX_RuntimeError, _("No paradox document associated with blob file."));
 	}
 
+	/* The pending writes of the journal are written before */
+	if(pxdoc && pxblob->mb_stream) {
+		px_journal_release(pxdoc, pxblob->mb_stream);
+	}
+
 	if(pxdoc && pxblob->mb_stream && pxblob->mb_stream->close && (pxblob->mb_stream->s.fp != NULL)){
 		fclose(pxblob->mb_stream->s.fp);
 		pxdoc->free(pxdoc, pxblob->mb_stream);
@@ -3256,6 +4933,9 @@ PX_set_blob_file(pxdoc_t *pxdoc, const char *filename) {
 	}
 
 	pxdoc->px_blob = pxblob;
+	if(pxdoc->px_journal) {
+		px_journal_attach(pxdoc, pxdoc->px_journal, pxblob->mb_name, pxblob->mb_stream);
+	}
 
 	return 0;
 }
@@ -4202,7 +5882,11 @@ _px_put_data_blob(pxdoc_t *pxdoc, const char *data, int len, char *value, int va
 		pxs = pxblob->mb_stream;
 		if(valuelen > 2048) { /* Block of type 2 */
 			TMbBlockHeader2 mbbh;
+			char zero[256];
 			int used_blocks = 0;
+			int fill = 0;
+
+			memset(zero, 0, sizeof(zero));
 
 			/* FIXME: need to add code which reuses free blocks for blocks of type 2*/
 //			fprintf(stderr, "Blob goes into type 2 block\n");
@@ -4229,6 +5913,16 @@ _px_put_data_blob(pxdoc_t *pxdoc, const char *data, int len, char *value, int va
 				px_error(pxdoc, PX_RuntimeError, _("Could not write blob data to file."));
 				return -1;
 			}
+			/* Fill up the last block, the file must consist of whole blocks */
+			fill = used_blocks*4096 - (int) sizeof(TMbBlockHeader2) - valuelen;
+			while(fill > 0) {
+				int chunk = fill > (int) sizeof(zero) ? (int) sizeof(zero) : fill;
+				if(pxblob->write(pxblob, pxs, chunk, zero) < 1) {
+					px_error(pxdoc, PX_RuntimeError, _("Could not write remaining of a type 2 block."));
+					return -1;
+				}
+				fill -= chunk;
+			}
 			put_long_le((char *) &data[leader], (pxblob->used_datablocks+1)*4096 + 0xff);
 			put_short_le((char *) &data[leader+8], pxblob->mb_head->modcount);
 			pxblob->used_datablocks += used_blocks;
@@ -146,6 +146,7 @@ typedef struct px_field pxfield_t;
 typedef struct px_pindex pxpindex_t;
 typedef struct px_stream pxstream_t;
 typedef struct px_val pxval_t;
+typedef struct px_stats pxstats_t;
 typedef struct mb_head mbhead_t;
 
 struct px_stream {
@@ -166,6 +167,20 @@ struct px_stream {
 	ssize_t (*write)(pxdoc_t *p, pxstream_t *stream, size_t numbytes, void *buffer);
 };
 
+/* Counters of the file access, read by PX_get_value() */
+struct px_stats {
+	long long bytesread;        /* Bytes read from the .DB and .MB file */
+	long long byteswritten;     /* Bytes written to the .DB and .MB file */
+	long long seeks;            /* Seeks in the .DB and .MB file */
+	long long blocksread;       /* Data blocks read into the block cache */
+	long long blockswritten;    /* Data blocks written from the block cache */
+	long long cachehits;        /* Reads of data in the cached block */
+	long long cachemisses;      /* Reads of data in another block */
+	long long blocksdecrypted;  /* Data blocks decrypted */
+	long long allocations;      /* Calls of malloc and realloc, also of the memory profiler */
+	long long arenaallocations; /* Allocations served by the arena of PX_arena_begin() */
+};
+
 struct px_doc {
 	/* database file */
 //	FILE *px_fp;       /* File pointer of file */
@@ -229,11 +244,17 @@ struct px_doc {
 	long curblocknr;      /* Number of current block in cache (0-n) */
 	int curblockdirty;    /* Set to px_true if the block needs to be written */
 	unsigned char *curblock;       /* Data of block in read cache */
+
+	void *px_journal;     /* Write-ahead journal, see PX_begin_journal() */
+	void *px_arena;       /* Temporary memory, see PX_arena_begin() */
+
+	pxstats_t px_stats;   /* Counters of the file access */
 };
 
 struct px_blockcache {
 	long start;
 	size_t size;
+	size_t allocated;
 	unsigned char *data;
 };
 typedef struct px_blockcache pxblockcache_t;
@@ -374,6 +395,21 @@ PX_get_record(pxdoc_t *pxdoc, int recno, char *data);
 PXLIB_API char * PXLIB_CALL
 PX_get_record2(pxdoc_t *pxdoc, int recno, char *data, int *deleted, pxdatablockinfo_t *pxdbinfo);
 
+PXLIB_API int PXLIB_CALL
+PX_get_datablock(pxdoc_t *pxdoc, int indexpos, char *data, pxdatablockinfo_t *pxdbinfo);
+
+PXLIB_API int PXLIB_CALL
+PX_get_rawdatablock(pxdoc_t *pxdoc, int blocknumber, char *data, pxdatablockinfo_t *pxdbinfo);
+
+PXLIB_API int PXLIB_CALL
+PX_put_datablock(pxdoc_t *pxdoc, int indexpos, const char *data, int numrecords);
+
+PXLIB_API int PXLIB_CALL
+PX_write_header(pxdoc_t *pxdoc);
+
+PXLIB_API int PXLIB_CALL
+PX_append_records(pxdoc_t *pxdoc, const char *data, int numrecords);
+
 PXLIB_API int PXLIB_CALL
 PX_put_recordn(pxdoc_t *pxdoc, char *data, int recpos);
 
@@ -389,6 +425,9 @@ PX_update_record(pxdoc_t *pxdoc, pxval_t **dataptr, int recno);
 PXLIB_API int PXLIB_CALL
 PX_delete_record(pxdoc_t *pxdoc, int recno);
 
+PXLIB_API int PXLIB_CALL
+PX_delete_datablock_records(pxdoc_t *pxdoc, int indexpos, const int *slots, int numslots);
+
 PXLIB_API pxval_t ** PXLIB_CALL
 PX_retrieve_record(pxdoc_t *pxdoc, int recno);
 
@@ -401,6 +440,36 @@ PX_delete(pxdoc_t *pxdoc);
 PXLIB_API int PXLIB_CALL
 PX_pack(pxdoc_t *pxdoc);
 
+PXLIB_API int PXLIB_CALL
+PX_replay_journal(pxdoc_t *pxdoc, const char *filename, const char *journal);
+
+PXLIB_API int PXLIB_CALL
+PX_begin_journal(pxdoc_t *pxdoc, const char *journal);
+
+PXLIB_API int PXLIB_CALL
+PX_commit_journal(pxdoc_t *pxdoc);
+
+PXLIB_API int PXLIB_CALL
+PX_end_journal(pxdoc_t *pxdoc);
+
+PXLIB_API void * PXLIB_CALL
+PX_arena_malloc(pxdoc_t *p, size_t size, const char *caller);
+
+PXLIB_API void * PXLIB_CALL
+PX_arena_realloc(pxdoc_t *p, void *mem, size_t size, const char *caller);
+
+PXLIB_API void PXLIB_CALL
+PX_arena_free(pxdoc_t *p, void *mem);
+
+PXLIB_API int PXLIB_CALL
+PX_arena_begin(pxdoc_t *pxdoc);
+
+PXLIB_API void PXLIB_CALL
+PX_arena_reset(pxdoc_t *pxdoc);
+
+PXLIB_API void PXLIB_CALL
+PX_arena_end(pxdoc_t *pxdoc);
+
 PXLIB_API pxfield_t* PXLIB_CALL
 PX_get_fields(pxdoc_t *pxdoc);
 
@@ -121,6 +121,7 @@ ssize_t px_read(pxdoc_t *p, pxstream_t *dummy, size_t len, void *buffer) {
 		}
 		if(p->curblocknr != blocknr) {
 //			fprintf(stderr, "Read block %d into cache.\n", blocknr);
+			p->px_stats.cachemisses++;
 			if(p->curblockdirty == px_true) {
 				pxs->seek(p, pxs, pxh->px_headersize + ((p->curblocknr-1)*blocksize), SEEK_SET);
 				if(pxh->px_encryption != 0) {
@@ -128,17 +129,21 @@ ssize_t px_read(pxdoc_t *p, pxstream_t *dummy, size_t len, void *buffer) {
 					px_encrypt_db_block(p->curblock, p->curblock, pxh->px_encryption, blocksize, p->curblocknr);
 				}
 				pxs->write(p, pxs, blocksize, p->curblock);
+				p->px_stats.blockswritten++;
 			}
 			memset(p->curblock, 0, blocksize);
 			pxs->seek(p, pxs, pxh->px_headersize + ((blocknr-1)*blocksize), SEEK_SET);
 			pxs->read(p, pxs, blocksize, p->curblock);
+			p->px_stats.blocksread++;
 			p->curblocknr = blocknr;
 			if(pxh->px_encryption != 0) {
 //				fprintf(stderr, "Decrypting block %d\n", blocknr);
 				px_decrypt_db_block(p->curblock, p->curblock, pxh->px_encryption, blocksize, blocknr);
+				p->px_stats.blocksdecrypted++;
 			}
 		} else {
 //			fprintf(stderr, "block %d already in cache.\n", blocknr);
+			p->px_stats.cachehits++;
 		}
 		memcpy(buffer, p->curblock+blockpos, len);
 		pxs->seek(p, pxs, curpos + (long)len, SEEK_SET);
@@ -212,13 +217,16 @@ ssize_t px_write(pxdoc_t *p, pxstream_t *dummy, size_t len, void *buffer) {
 					px_encrypt_db_block(p->curblock, p->curblock, pxh->px_encryption, blocksize, p->curblocknr);
 				}
 				pxs->write(p, pxs, blocksize, p->curblock);
+				p->px_stats.blockswritten++;
 			}
 			memset(p->curblock, 0, blocksize);
 			/* Read the new block, just in case it has been in the file already */
 			pxs->seek(p, pxs, pxh->px_headersize + ((blocknr-1)*blocksize), SEEK_SET);
 			pxs->read(p, pxs, blocksize, p->curblock);
+			p->px_stats.blocksread++;
 			if(pxh->px_encryption != 0) {
 				px_decrypt_db_block(p->curblock, p->curblock, pxh->px_encryption, blocksize, blocknr);
+				p->px_stats.blocksdecrypted++;
 			}
 		} else {
 //			fprintf(stderr, "block %d already in cache.\n", blocknr);
@@ -255,6 +263,11 @@ int px_flush(pxdoc_t *p, pxstream_t *dummy) {
 				px_encrypt_db_block(p->curblock, p->curblock, pxh->px_encryption, blocksize, p->curblocknr);
 			}
 			pxs->write(p, pxs, blocksize, p->curblock);
+			p->px_stats.blockswritten++;
+			/* The block stays in the cache */
+			if(pxh->px_encryption != 0) {
+				px_decrypt_db_block(p->curblock, p->curblock, pxh->px_encryption, blocksize, p->curblocknr);
+			}
 			p->curblockdirty = px_false;
 		}
 	}
@@ -268,8 +281,13 @@ int px_flush(pxdoc_t *p, pxstream_t *dummy) {
  * Generic read function doing decryption if needed.
  * It calls the read function from px_stream_t to actually get the
  * file data.
+ * The data is read in whole blocks of 2^MBBLOCKSIZEEXP bytes which are
+ * kept in the block cache of the blob. The head of a blob, its pointer
+ * in a suballocated block and the blob data itself are usually within
+ * one block, so reading a blob takes only one access to the file.
  */
 #define BLOCKSIZEEXP 8 /* Each encrypted block has 2^BLOCKSIZEEXP bytes */
+#define MBBLOCKSIZEEXP 12 /* Each block of the .mb file has 2^MBBLOCKSIZEEXP bytes */
 ssize_t px_mb_read(pxblob_t *p, pxstream_t *dummy, size_t len, void *buffer) {
 	(void)dummy;
 	pxdoc_t *pxdoc = NULL;
@@ -285,32 +303,41 @@ ssize_t px_mb_read(pxblob_t *p, pxstream_t *dummy, size_t len, void *buffer) {
 	pxh = pxdoc->px_head;
 	pxs = p->mb_stream;
 
-	if (pxh->px_encryption == 0) {
-		return pxs->read(pxdoc, pxs, len, buffer);
-	}
-
 	pos = pxs->tell(pxdoc, pxs);
 	if (pos < 0) {
 		return pos;
 	}
 
-	/* pos can be in the middle of a 2^BLOCKSIZEEXP bytes block.
+	/* The requested data is completely within the cached blocks */
+	if(p->blockcache.data != NULL && pos >= p->blockcache.start &&
+	   (size_t) pos + len <= (size_t) p->blockcache.start + p->blockcache.size) {
+//		fprintf(stderr, "Reading block at position 0x%X from cache.\n", pos);
+		memcpy(buffer, p->blockcache.data + (pos - p->blockcache.start), len);
+		ret = pxs->seek(pxdoc, pxs, pos + (long)len, SEEK_SET);
+		if (ret < 0) {
+			return ret;
+		}
+		return len;
+	}
+
+	/* pos can be in the middle of a 2^MBBLOCKSIZEEXP bytes block.
 	 * Make sure we start reading at the beginning of the block.
 	 */
-	blockoffset = (pos >> BLOCKSIZEEXP) << BLOCKSIZEEXP;
+	blockoffset = (pos >> MBBLOCKSIZEEXP) << MBBLOCKSIZEEXP;
 	/* We need to read at least chunk from the blockoffset till the
 	 * desired postion and the data itself which has len bytes.
-	 * e.g. if we want to read 20 bytes starting at position 300 in the
-	 * file, we will need to read 44+20 bytes starting at position 256. 
+	 * e.g. if we want to read 20 bytes starting at position 4100 in the
+	 * file, we will need to read 4+20 bytes starting at position 4096.
 	 */
 	blockslen = (unsigned)len + pos - blockoffset;
-	/* Check if the end of the data is within a 2^BLOCKSIZEEXP bytes block.
+	/* Check if the end of the data is within a 2^MBBLOCKSIZEEXP bytes block.
 	 * If that is the case, we will need to read the remainder of the
-	 * 2^BLOCKSIZEEXP bytes block as well. In the above example, we
-	 * will have to read 256 bytes instead of just 64.
+	 * 2^MBBLOCKSIZEEXP bytes block as well. In the above example, we
+	 * will have to read 4096 bytes instead of just 24. Whole blocks are
+	 * also a multiple of the 2^BLOCKSIZEEXP bytes decryption chunks.
 	 */
-	if(blockslen & 0xff) {
-		blockslen = ((blockslen >> BLOCKSIZEEXP) + 1) << BLOCKSIZEEXP;
+	if(blockslen & ((1 << MBBLOCKSIZEEXP) - 1)) {
+		blockslen = ((blockslen >> MBBLOCKSIZEEXP) + 1) << MBBLOCKSIZEEXP;
 	}
 
 	assert(blockslen >= len);
@@ -322,37 +349,37 @@ ssize_t px_mb_read(pxblob_t *p, pxstream_t *dummy, size_t len, void *buffer) {
 		return ret;
 	}
 
-	if(NULL == p->blockcache.data) {
-		p->blockcache.data = (unsigned char *) malloc(blockslen);
-	} else {
-		if(blockoffset == p->blockcache.start && blockslen <= p->blockcache.size) {
-//			fprintf(stderr, "Reading block at position 0x%X from cache.\n", blockoffset);
-			memcpy(buffer, p->blockcache.data + (pos - blockoffset), len);
-			ret = pxs->seek(pxdoc, pxs, pos + (long)len, SEEK_SET);
-			if (ret < 0) {
-				return ret;
-			}
-			return len;
+	if(NULL == p->blockcache.data || p->blockcache.allocated < blockslen) {
+		tmpbuf = (unsigned char *) pxdoc->realloc(pxdoc, p->blockcache.data, blockslen, _("Allocate memory for blob block cache."));
+		if (tmpbuf == NULL) {
+			return -ENOMEM;
 		}
-		p->blockcache.data = (unsigned char *) realloc(p->blockcache.data, blockslen);
-	}
-	if (p->blockcache.data == NULL) {
-		return -ENOMEM;
+		p->blockcache.data = tmpbuf;
+		p->blockcache.allocated = blockslen;
 	}
 //	fprintf(stderr, "Reading block at position 0x%X from file.\n", blockoffset);
 	tmpbuf = p->blockcache.data;
+	/* The cache is invalid until the new blocks are read completely */
+	p->blockcache.size = 0;
 
 	ret = (int)pxs->read(pxdoc, pxs, blockslen, tmpbuf);
 	if (ret <= 0) {
-		free(tmpbuf);
-		p->blockcache.data = NULL;
 		return ret;
 	}
-	px_decrypt_mb_block(tmpbuf, tmpbuf, pxh->px_encryption, blockslen);
-	memcpy(buffer, tmpbuf + (pos - blockoffset), len);
+	if (pxh->px_encryption != 0) {
+		px_decrypt_mb_block(tmpbuf, tmpbuf, pxh->px_encryption, blockslen);
+	}
 	p->blockcache.start = blockoffset;
-	p->blockcache.size = blockslen;
-//	free(tmpbuf);
+	p->blockcache.size = (size_t)ret;
+
+	/* The last block of the file may be shorter */
+	if ((size_t)ret < pos - blockoffset + len) {
+		if ((size_t)ret <= (size_t)(pos - blockoffset)) {
+			return 0;
+		}
+		len = (size_t)ret - (pos - blockoffset);
+	}
+	memcpy(buffer, tmpbuf + (pos - blockoffset), len);
 
 	ret = pxs->seek(pxdoc, pxs, pos + (long)len, SEEK_SET);
 	if (ret < 0) {
@@ -384,6 +411,8 @@ long px_mb_tell(pxblob_t *p, pxstream_t *dummy) {
  */
 ssize_t px_mb_write(pxblob_t *p, pxstream_t *dummy, size_t len, void *buffer) {
 	(void)dummy;
+	/* The cached blocks may be overwritten */
+	p->blockcache.size = 0;
 	return(p->mb_stream->write(p->pxdoc, p->mb_stream, len, buffer));
 }
 /* }}} */
@@ -392,15 +421,20 @@ ssize_t px_mb_write(pxblob_t *p, pxstream_t *dummy, size_t len, void *buffer) {
 /* px_fread() {{{
  */
 ssize_t px_fread(pxdoc_t *p, pxstream_t *stream, size_t len, void *buffer) {
-	(void)p;
-	return(fread(buffer, 1, len, stream->s.fp));
+	size_t ret = fread(buffer, 1, len, stream->s.fp);
+	if(p) {
+		p->px_stats.bytesread += ret;
+	}
+	return(ret);
 }
 /* }}} */
 
 /* px_fseek() {{{
  */
 int px_fseek(pxdoc_t *p, pxstream_t *stream, long offset, int whence) {
-	(void)p;
+	if(p) {
+		p->px_stats.seeks++;
+	}
 	return(fseek(stream->s.fp, offset, whence));
 }
 /* }}} */
@@ -416,8 +450,11 @@ long px_ftell(pxdoc_t *p, pxstream_t *stream) {
 /* px_fwrite() {{{
  */
 ssize_t px_fwrite(pxdoc_t *p, pxstream_t *stream, size_t len, void *buffer) {
-	(void)p;
-	return(fwrite(buffer, 1, len, stream->s.fp));
+	size_t ret = fwrite(buffer, 1, len, stream->s.fp);
+	if(p) {
+		p->px_stats.byteswritten += ret;
+	}
+	return(ret);
 }
 /* }}} */
 
@@ -7,16 +7,21 @@
 #include "px_intern.h"
 #include "paradox-gsf.h"
 #include "px_error.h"
+#include "px_memory.h"
 
 void *_px_malloc(pxdoc_t *p, size_t len, const char *caller) {
-	(void)p;
 	(void)caller;
+	if(p) {
+		p->px_stats.allocations++;
+	}
 	return((void *) malloc(len));
 }
 
 void *_px_realloc(pxdoc_t *p, void *mem, size_t len, const char *caller) {
-	(void)p;
 	(void)caller;
+	if(p) {
+		p->px_stats.allocations++;
+	}
 	return((void *) realloc(mem, len));
 }
 
@@ -48,6 +53,269 @@ char *px_strdup(pxdoc_t *p, const char *str) {
 	return(buf);
 }
 
+/* Arena for temporary memory {{{
+ * Between PX_arena_begin() and PX_arena_end() the arena functions take
+ * small allocations from chunks of memory kept by the document instead
+ * of the heap. Freeing such memory does not return it, the chunks are
+ * rewound by PX_arena_reset() or by the last PX_arena_end(), so a scan
+ * which resets the arena after each block reuses the same chunks and
+ * makes no heap allocations once they are large enough.
+ * Memory which is still used at a reset, e.g. the blob file opened by
+ * the first blob read, is kept and only the memory allocated after it
+ * is reused. Outside of the arena the functions use the heap.
+ */
+#define PX_ARENA_ALIGN 16
+#define PX_ARENA_CHUNK 65536
+#define PX_ARENA_MAXALLOC 32768
+#define PX_ARENA_ROUND(n) (((n) + PX_ARENA_ALIGN - 1) & ~((size_t) PX_ARENA_ALIGN - 1))
+
+struct px_arenachunk {
+	struct px_arenachunk *next;
+	size_t used;
+};
+
+struct px_arenahead {
+	size_t size;
+	unsigned long epoch;
+};
+
+struct px_arena {
+	struct px_arenachunk *first;
+	struct px_arenachunk *cur;
+	struct px_arenachunk *basechunk; /* memory below base is still used */
+	size_t baseused;
+	int depth;
+	unsigned long epoch;
+	long live;      /* allocations not freed yet */
+	long epochlive; /* of them allocated since the last reset */
+};
+
+#define PX_ARENA_CHUNKHEAD PX_ARENA_ROUND(sizeof(struct px_arenachunk))
+#define PX_ARENA_HEAD PX_ARENA_ROUND(sizeof(struct px_arenahead))
+#define PX_ARENA_DATA(c) ((char *) (c) + PX_ARENA_CHUNKHEAD)
+
+/* px_arena_owns() {{{
+ */
+static struct px_arenachunk *px_arena_owns(struct px_arena *arena, const void *mem) {
+	struct px_arenachunk *chunk;
+	for(chunk = arena->first; chunk != NULL; chunk = chunk->next) {
+		if((const char *) mem >= PX_ARENA_DATA(chunk) && (const char *) mem < PX_ARENA_DATA(chunk) + PX_ARENA_CHUNK) {
+			return(chunk);
+		}
+	}
+	return(NULL);
+}
+/* }}} */
+
+/* px_arena_alloc() {{{
+ * Chunks behind the current one are always empty.
+ */
+static void *px_arena_alloc(pxdoc_t *p, struct px_arena *arena, size_t size) {
+	size_t need = PX_ARENA_HEAD + PX_ARENA_ROUND(size);
+	struct px_arenahead *head;
+
+	if(arena->cur == NULL || arena->cur->used + need > PX_ARENA_CHUNK) {
+		if(arena->cur == NULL || arena->cur->next == NULL) {
+			struct px_arenachunk *chunk;
+			if(NULL == (chunk = (struct px_arenachunk *) malloc(PX_ARENA_CHUNKHEAD + PX_ARENA_CHUNK))) {
+				return(NULL);
+			}
+			p->px_stats.allocations++;
+			chunk->next = NULL;
+			chunk->used = 0;
+			if(arena->cur == NULL) {
+				arena->first = arena->basechunk = chunk;
+			} else {
+				arena->cur->next = chunk;
+			}
+			arena->cur = chunk;
+		} else {
+			arena->cur = arena->cur->next;
+		}
+	}
+
+	head = (struct px_arenahead *) (PX_ARENA_DATA(arena->cur) + arena->cur->used);
+	head->size = size;
+	head->epoch = arena->epoch;
+	arena->cur->used += need;
+	arena->live++;
+	arena->epochlive++;
+	p->px_stats.arenaallocations++;
+	return((char *) head + PX_ARENA_HEAD);
+}
+/* }}} */
+
+/* px_arena_release() {{{
+ * The last allocation is taken back at once, the other memory with the
+ * next reset.
+ */
+static void px_arena_release(struct px_arena *arena, struct px_arenachunk *chunk, void *mem) {
+	struct px_arenahead *head = (struct px_arenahead *) ((char *) mem - PX_ARENA_HEAD);
+	size_t need = PX_ARENA_HEAD + PX_ARENA_ROUND(head->size);
+
+	arena->live--;
+	if(head->epoch == arena->epoch) {
+		arena->epochlive--;
+		if(chunk == arena->cur && (char *) head + need == PX_ARENA_DATA(chunk) + chunk->used) {
+			chunk->used -= need;
+		}
+	}
+}
+/* }}} */
+
+/* PX_arena_malloc() {{{
+ * Memory management function for PX_new3().
+ */
+PXLIB_API void * PXLIB_CALL
+PX_arena_malloc(pxdoc_t *p, size_t size, const char *caller) {
+	struct px_arena *arena = p ? (struct px_arena *) p->px_arena : NULL;
+	void *mem;
+
+	if(arena != NULL && arena->depth > 0 && size <= PX_ARENA_MAXALLOC) {
+		if(NULL != (mem = px_arena_alloc(p, arena, size))) {
+			return(mem);
+		}
+	}
+	return(_px_malloc(p, size, caller));
+}
+/* }}} */
+
+/* PX_arena_realloc() {{{
+ * Memory management function for PX_new3(). Heap memory stays on the heap.
+ */
+PXLIB_API void * PXLIB_CALL
+PX_arena_realloc(pxdoc_t *p, void *mem, size_t size, const char *caller) {
+	struct px_arena *arena = p ? (struct px_arena *) p->px_arena : NULL;
+	struct px_arenachunk *chunk;
+	void *a;
+
+	if(mem == NULL) {
+		return(PX_arena_malloc(p, size, caller));
+	}
+	if(arena == NULL || NULL == (chunk = px_arena_owns(arena, mem))) {
+		return(_px_realloc(p, mem, size, caller));
+	}
+
+	if(NULL == (a = PX_arena_malloc(p, size, caller))) {
+		return(NULL);
+	}
+	if(a != mem) {
+		size_t oldsize = ((struct px_arenahead *) ((char *) mem - PX_ARENA_HEAD))->size;
+		memcpy(a, mem, oldsize < size ? oldsize : size);
+	}
+	px_arena_release(arena, chunk, mem);
+	return(a);
+}
+/* }}} */
+
+/* PX_arena_free() {{{
+ * Memory management function for PX_new3().
+ */
+PXLIB_API void PXLIB_CALL
+PX_arena_free(pxdoc_t *p, void *mem) {
+	struct px_arena *arena = p ? (struct px_arena *) p->px_arena : NULL;
+	struct px_arenachunk *chunk;
+
+	if(mem != NULL && arena != NULL && NULL != (chunk = px_arena_owns(arena, mem))) {
+		px_arena_release(arena, chunk, mem);
+		return;
+	}
+	_px_free(p, mem);
+}
+/* }}} */
+
+/* PX_arena_begin() {{{
+ * Starts to take the allocations from the arena, calls can be nested.
+ */
+PXLIB_API int PXLIB_CALL
+PX_arena_begin(pxdoc_t *pxdoc) {
+	struct px_arena *arena;
+
+	if(pxdoc == NULL) {
+		px_error(pxdoc, PX_RuntimeError, _("Did not pass a paradox database."));
+		return -1;
+	}
+
+	if(NULL == (arena = (struct px_arena *) pxdoc->px_arena)) {
+		if(NULL == (arena = (struct px_arena *) malloc(sizeof(struct px_arena)))) {
+			px_error(pxdoc, PX_MemoryError, _("Could not allocate memory for arena."));
+			return -1;
+		}
+		memset(arena, 0, sizeof(struct px_arena));
+		pxdoc->px_arena = arena;
+	}
+	arena->depth++;
+	return 0;
+}
+/* }}} */
+
+/* PX_arena_reset() {{{
+ * Makes the freed memory of the arena available again.
+ */
+PXLIB_API void PXLIB_CALL
+PX_arena_reset(pxdoc_t *pxdoc) {
+	struct px_arena *arena;
+	struct px_arenachunk *chunk;
+
+	if(pxdoc == NULL || NULL == (arena = (struct px_arena *) pxdoc->px_arena) || arena->cur == NULL) {
+		return;
+	}
+
+	if(arena->live == 0) {
+		arena->basechunk = arena->first;
+		arena->baseused = 0;
+	} else if(arena->epochlive > 0) {
+		/* memory allocated since the last reset is still used */
+		arena->basechunk = arena->cur;
+		arena->baseused = arena->cur->used;
+	}
+
+	arena->cur = arena->basechunk;
+	arena->cur->used = arena->baseused;
+	for(chunk = arena->cur->next; chunk != NULL; chunk = chunk->next) {
+		chunk->used = 0;
+	}
+	arena->epoch++;
+	arena->epochlive = 0;
+}
+/* }}} */
+
+/* PX_arena_end() {{{
+ * Ends the arena started by PX_arena_begin(), the last call resets it.
+ */
+PXLIB_API void PXLIB_CALL
+PX_arena_end(pxdoc_t *pxdoc) {
+	struct px_arena *arena;
+
+	if(pxdoc == NULL || NULL == (arena = (struct px_arena *) pxdoc->px_arena) || arena->depth == 0) {
+		return;
+	}
+	if(--arena->depth == 0) {
+		PX_arena_reset(pxdoc);
+	}
+}
+/* }}} */
+
+/* px_arena_delete() {{{
+ * Frees the chunks of the arena when the document is deleted.
+ */
+void px_arena_delete(pxdoc_t *p) {
+	struct px_arena *arena = (struct px_arena *) p->px_arena;
+	struct px_arenachunk *chunk;
+
+	if(arena == NULL) {
+		return;
+	}
+	while(NULL != (chunk = arena->first)) {
+		arena->first = chunk->next;
+		free(chunk);
+	}
+	free(arena);
+	p->px_arena = NULL;
+}
+/* }}} */
+/* }}} */
+
 /*
  * Local variables:
  * tab-width: 4
@@ -5,4 +5,5 @@ void *_px_realloc(pxdoc_t *p, void *mem, size_t len, const char *caller);
 void _px_free(pxdoc_t *p, void *ptr);
 size_t px_strlen(const char *str);
 char *px_strdup(pxdoc_t *p, const char *str);
+void px_arena_delete(pxdoc_t *p);
 #endif
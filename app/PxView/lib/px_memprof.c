@@ -8,63 +8,325 @@
 #include "paradox-mp.h"
 #include "px_error.h"
 
-#define MAXMEM 10000
+/* Live memory blocks are kept in an open addressing hash table keyed by
+ * their address, the statistics of the callers in a second one keyed by
+ * the caller string. Both tables double their size when they are half
+ * full, so each call takes constant time on any number of blocks.
+ * Nothing is tracked before PX_mp_init(), the functions only pass the
+ * calls to malloc(), realloc() and free() then.
+ */
+#define MPMINBLOCKS 1024
+#define MPMINCALLERS 256
 
-struct mem {
+struct mpblock {
 	void *ptr;
-	int size;
-	char *caller;
+	size_t size;
+	int caller;
+};
+
+struct mpcaller {
+	char *name;
+	long long calls;
+	long long reallocs;
+	long long frees;
+	long long live;
+	long long peak;
+	long long total;
 };
 
-static struct mem memlist[MAXMEM];
-static int peakmem = 0;
-static int summem = 0;
+static int mp_enabled = 0;
+static struct mpblock *blocks = NULL;
+static size_t blockcap = 0;
+static size_t blockcount = 0;
+static struct mpcaller *callers = NULL;
+static int callercount = 0;
+static int callermax = 0;
+static int *callerhash = NULL;
+static size_t callercap = 0;
+static long long peakmem = 0;
+static long long summem = 0;
+
+/* mp_hash_ptr() {{{
+ */
+static size_t mp_hash_ptr(const void *ptr) {
+	size_t h = (size_t) ptr;
+	h ^= h >> 4;
+	h *= (size_t) 0x9E3779B97F4A7C15ULL;
+	h ^= h >> 16;
+	return(h);
+}
+/* }}} */
+
+/* mp_hash_str() {{{
+ */
+static size_t mp_hash_str(const char *str) {
+	size_t h = 2166136261U;
+	while(*str) {
+		h = (h ^ (unsigned char) *str++) * 16777619U;
+	}
+	return(h);
+}
+/* }}} */
+
+/* mp_resize_blocks() {{{
+ * Moves the live blocks to a table of the new size.
+ */
+static int mp_resize_blocks(size_t cap) {
+	struct mpblock *old = blocks;
+	size_t oldcap = blockcap;
+	size_t i, j;
+
+	if(NULL == (blocks = (struct mpblock *) calloc(cap, sizeof(struct mpblock)))) {
+		blocks = old;
+		return(-1);
+	}
+	blockcap = cap;
+	for(i=0; i<oldcap; i++) {
+		if(old[i].ptr == NULL)
+			continue;
+		j = mp_hash_ptr(old[i].ptr) & (blockcap-1);
+		while(blocks[j].ptr != NULL) {
+			j = (j+1) & (blockcap-1);
+		}
+		blocks[j] = old[i];
+	}
+	free(old);
+	return(0);
+}
+/* }}} */
+
+/* mp_find_block() {{{
+ * Returns the slot of the block or -1 if it is not tracked.
+ */
+static long mp_find_block(const void *ptr) {
+	size_t i;
+
+	if(blockcap == 0)
+		return(-1);
+	i = mp_hash_ptr(ptr) & (blockcap-1);
+	while(blocks[i].ptr != NULL) {
+		if(blocks[i].ptr == ptr)
+			return((long) i);
+		i = (i+1) & (blockcap-1);
+	}
+	return(-1);
+}
+/* }}} */
+
+/* mp_remove_block() {{{
+ * Empties the slot and moves the following blocks of the probe sequence
+ * back, so no deleted marks are needed.
+ */
+static void mp_remove_block(size_t i) {
+	size_t j = i;
+	size_t k;
+
+	for(;;) {
+		j = (j+1) & (blockcap-1);
+		if(blocks[j].ptr == NULL)
+			break;
+		k = mp_hash_ptr(blocks[j].ptr) & (blockcap-1);
+		/* the block stays when its home slot lies cyclically in (i, j] */
+		if((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		blocks[i] = blocks[j];
+		i = j;
+	}
+	blocks[i].ptr = NULL;
+	blocks[i].size = 0;
+	blockcount--;
+}
+/* }}} */
+
+/* mp_get_caller() {{{
+ * Returns the index of the caller, a new one is added with the first
+ * call.
+ */
+static int mp_get_caller(const char *caller) {
+	size_t i;
+	int k;
+
+	if(caller == NULL)
+		caller = "";
+
+	if(2*(size_t)(callercount+1) > callercap) {
+		size_t cap = callercap ? 2*callercap : MPMINCALLERS;
+		int *hash;
+		if(NULL == (hash = (int *) malloc(cap*sizeof(int))))
+			return(-1);
+		memset(hash, 0xff, cap*sizeof(int));
+		for(k=0; k<callercount; k++) {
+			i = mp_hash_str(callers[k].name) & (cap-1);
+			while(hash[i] >= 0) {
+				i = (i+1) & (cap-1);
+			}
+			hash[i] = k;
+		}
+		free(callerhash);
+		callerhash = hash;
+		callercap = cap;
+	}
+
+	i = mp_hash_str(caller) & (callercap-1);
+	while(callerhash[i] >= 0) {
+		if(strcmp(callers[callerhash[i]].name, caller) == 0)
+			return(callerhash[i]);
+		i = (i+1) & (callercap-1);
+	}
+
+	if(callercount == callermax) {
+		int max = callermax ? 2*callermax : MPMINCALLERS;
+		struct mpcaller *tmp;
+		if(NULL == (tmp = (struct mpcaller *) realloc(callers, max*sizeof(struct mpcaller))))
+			return(-1);
+		callers = tmp;
+		callermax = max;
+	}
+	memset(&callers[callercount], 0, sizeof(struct mpcaller));
+	if(NULL == (callers[callercount].name = strdup(caller)))
+		return(-1);
+	callerhash[i] = callercount;
+	return(callercount++);
+}
+/* }}} */
+
+/* mp_add_block() {{{
+ * Returns the index of the caller or -1 if the block is not tracked.
+ */
+static int mp_add_block(void *ptr, size_t size, const char *caller) {
+	struct mpcaller *c;
+	size_t i;
+	int k;
+
+	if(2*(blockcount+1) > blockcap) {
+		if(mp_resize_blocks(blockcap ? 2*blockcap : MPMINBLOCKS) < 0) {
+			fprintf(stderr, _("Aiii, no more space for new memory block."));
+			fprintf(stderr, "\n");
+			return(-1);
+		}
+	}
+	if((k = mp_get_caller(caller)) < 0) {
+		fprintf(stderr, _("Aiii, no more space for new memory block."));
+		fprintf(stderr, "\n");
+		return(-1);
+	}
+
+	i = mp_hash_ptr(ptr) & (blockcap-1);
+	while(blocks[i].ptr != NULL) {
+		i = (i+1) & (blockcap-1);
+	}
+	blocks[i].ptr = ptr;
+	blocks[i].size = size;
+	blocks[i].caller = k;
+	blockcount++;
+
+	c = &callers[k];
+	c->live += (long long) size;
+	c->total += (long long) size;
+	c->peak = (c->live > c->peak) ? c->live : c->peak;
+	summem += (long long) size;
+	peakmem = (summem > peakmem) ? summem : peakmem;
+	return(k);
+}
+/* }}} */
+
+/* mp_release_block() {{{
+ * Removes the block and returns its caller or -1 if it is not tracked.
+ */
+static int mp_release_block(void *ptr) {
+	long i;
+	int k;
+
+	if((i = mp_find_block(ptr)) < 0)
+		return(-1);
+	k = blocks[i].caller;
+	callers[k].live -= (long long) blocks[i].size;
+	summem -= (long long) blocks[i].size;
+	mp_remove_block((size_t) i);
+	return(k);
+}
+/* }}} */
 
+/* PX_mp_init() {{{
+ * Starts the tracking, previous statistics are dropped.
+ */
 PXLIB_API void PXLIB_CALL
 PX_mp_init() {
-	memset(memlist, 0, MAXMEM*sizeof(struct mem));
+	PX_mp_done();
+	mp_enabled = 1;
 }
+/* }}} */
+
+/* PX_mp_done() {{{
+ * Stops the tracking and frees the tables.
+ */
+PXLIB_API void PXLIB_CALL
+PX_mp_done() {
+	int k;
+
+	for(k=0; k<callercount; k++) {
+		free(callers[k].name);
+	}
+	free(callers);
+	free(callerhash);
+	free(blocks);
+	callers = NULL;
+	callerhash = NULL;
+	blocks = NULL;
+	callercount = callermax = 0;
+	callercap = blockcap = blockcount = 0;
+	summem = peakmem = 0;
+	mp_enabled = 0;
+}
+/* }}} */
 
 PXLIB_API void * PXLIB_CALL
 PX_mp_malloc(pxdoc_t *p, size_t size, const char *caller) {
-	(void)p;
 	void *a = NULL;
-	int i = 0;
-	a = (void *) malloc(size);
-	while((i < MAXMEM) && (memlist[i].ptr != NULL)) {
-		i++;
+	int k;
+	if(p) {
+		p->px_stats.allocations++;
 	}
-	if(i == MAXMEM) {
-		fprintf(stderr, _("Aiii, no more space for new memory block."));
-		fprintf(stderr, "\n");
+	a = (void *) malloc(size);
+	if(mp_enabled && a != NULL && (k = mp_add_block(a, size, caller)) >= 0) {
+		callers[k].calls++;
 	}
-	memlist[i].ptr = a;
-	memlist[i].size = (int)size;
-	summem += (int)size;
-	peakmem = (summem > peakmem) ? summem : peakmem;
-	memlist[i].caller = strdup(caller);
 	return(a);
 }
 
 PXLIB_API void * PXLIB_CALL
 PX_mp_realloc(pxdoc_t *p, void *mem, size_t size, const char *caller) {
-	(void)p;
 	void *a = NULL;
-	int i = 0;
+	size_t oldsize = 0;
+	long i;
+	int k = -1;
+	if(p) {
+		p->px_stats.allocations++;
+	}
+	if(!mp_enabled) {
+		return(realloc(mem, size));
+	}
+	/* the old block is released before realloc() frees it and added
+	 * again when realloc() fails and leaves it allocated
+	 */
+	if(mem != NULL) {
+		if((i = mp_find_block(mem)) >= 0) {
+			oldsize = blocks[i].size;
+		}
+		if((k = mp_release_block(mem)) < 0) {
+			fprintf(stderr, _("Aiii, did not find memory block at 0x%p to enlarge."), mem);
+			fprintf(stderr, "\n");
+		}
+	}
 	a = realloc(mem, size);
-	for(i=0; i<MAXMEM; i++) {
-		if(memlist[i].ptr == mem) {
-			memlist[i].ptr = a;
-			summem -= memlist[i].size;
-			summem += (int)size;
-			memlist[i].size = (int)size;
-			free(memlist[i].caller);
-			memlist[i].caller = strdup(caller);
+	if(a == NULL && size > 0) {
+		if(k >= 0 && mp_add_block(mem, oldsize, callers[k].name) >= 0) {
+			callers[k].total -= (long long) oldsize;
 		}
+		return(a);
 	}
-	if(i == MAXMEM) {
-		fprintf(stderr, _("Aiii, did not find memory block at 0x%p to enlarge."), mem);
-		fprintf(stderr, "\n");
+	if(a != NULL && (k = mp_add_block(a, size, caller)) >= 0) {
+		callers[k].reallocs++;
 	}
 	return(a);
 }
@@ -72,40 +334,75 @@ PX_mp_realloc(pxdoc_t *p, void *mem, size_t size, const char *caller) {
 PXLIB_API void PXLIB_CALL
 PX_mp_free(pxdoc_t *p, void *mem) {
 	(void)p;
-	int i = 0;
-	while((i < MAXMEM) && (memlist[i].ptr != mem)) {
-		i++;
-	}
-	if(i == MAXMEM) {
-		fprintf(stderr, _("Aiii, did not find memory block at 0x%p to free."), mem);
-		fprintf(stderr, "\n");
-	} else {
-		memlist[i].ptr = NULL;
-		summem -= memlist[i].size;
-		memlist[i].size = 0;
-		free(memlist[i].caller);
+	int k;
+	if(mp_enabled && mem != NULL) {
+		if((k = mp_release_block(mem)) < 0) {
+			fprintf(stderr, _("Aiii, did not find memory block at 0x%p to free."), mem);
+			fprintf(stderr, "\n");
+		} else {
+			callers[k].frees++;
+		}
 	}
 	free(mem);
 }
 
 PXLIB_API void PXLIB_CALL
 PX_mp_list_unfreed() {
-	int i = 0;
+	size_t i = 0;
 	int j = 0;
-	while(i < MAXMEM) {
-		if(memlist[i].ptr) {
-			fprintf(stderr, _("%d. Memory at address 0x%p (%d) not freed: '%s'."), j, memlist[i].ptr, memlist[i].size, memlist[i].caller);
+	for(i=0; i<blockcap; i++) {
+		if(blocks[i].ptr) {
+			fprintf(stderr, _("%d. Memory at address 0x%p (%d) not freed: '%s'."), j, blocks[i].ptr, (int) blocks[i].size, callers[blocks[i].caller].name);
 			fprintf(stderr, "\n");
 			j++;
 		}
-		i++;
 	}
-	fprintf(stderr, _("Remaining unfreed memory: %d Bytes."), summem);
+	fprintf(stderr, _("Remaining unfreed memory: %lld Bytes."), summem);
 	fprintf(stderr, "\n");
-	fprintf(stderr, _("Max. amount of memory used: %d Bytes."), peakmem);
+	fprintf(stderr, _("Max. amount of memory used: %lld Bytes."), peakmem);
 	fprintf(stderr, "\n");
 }
 
+/* mp_compare_peak() {{{
+ */
+static int mp_compare_peak(const void *a, const void *b) {
+	const struct mpcaller *ca = &callers[*(const int *) a];
+	const struct mpcaller *cb = &callers[*(const int *) b];
+	if(ca->peak != cb->peak)
+		return((ca->peak < cb->peak) ? 1 : -1);
+	return(strcmp(ca->name, cb->name));
+}
+/* }}} */
+
+/* PX_mp_report() {{{
+ * Writes the statistics of each caller, ordered by the peak of its live
+ * memory, one tab separated line per caller.
+ */
+PXLIB_API void PXLIB_CALL
+PX_mp_report(FILE *fp) {
+	int *order;
+	int k;
+
+	if(fp == NULL)
+		fp = stderr;
+
+	fprintf(fp, "calls\treallocs\tfrees\tlive\tpeak\ttotal\tcaller\n");
+	if(NULL == (order = (int *) malloc((callercount+1)*sizeof(int))))
+		return;
+	for(k=0; k<callercount; k++) {
+		order[k] = k;
+	}
+	qsort(order, callercount, sizeof(int), mp_compare_peak);
+	for(k=0; k<callercount; k++) {
+		const struct mpcaller *c = &callers[order[k]];
+		fprintf(fp, "%lld\t%lld\t%lld\t%lld\t%lld\t%lld\t%s\n", c->calls, c->reallocs, c->frees, c->live, c->peak, c->total, c->name);
+	}
+	free(order);
+	fprintf(fp, _("Live blocks: %lu, live memory: %lld Bytes, peak: %lld Bytes."), (unsigned long) blockcount, summem, peakmem);
+	fprintf(fp, "\n");
+}
+/* }}} */
+
 /*
  * Local variables:
  * tab-width: 4
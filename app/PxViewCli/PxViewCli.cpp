@@ -0,0 +1,13 @@
+#include <PxView/PxCommand.h>
+
+using namespace Upp;
+
+CONSOLE_APP_MAIN {
+    const Vector<String> &args = CommandLine();
+    if (!ParadoxCommand::Run(args)) {
+        Cerr() << "Usage:\n" << ParadoxCommand::GetUsage();
+        SetExitCode(1);
+    }
+}
+
+// vim: ts=4 sw=4 expandtab